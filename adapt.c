@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "adapt.h"
+
+ /**
+  * Initialize the controller, the interval starts at max_ns
+  */
+ void adapt_init(struct adaptive *ad, uint64_t min_ns, uint64_t max_ns, double threshold) {
+     ad->min_ns = min_ns;
+     ad->max_ns = max_ns;
+     ad->threshold = threshold;
+     ad->volatility = 0.0;
+     ad->have_prev = 0;
+ }
+
+ static double change(unsigned long long a, unsigned long long b) {
+     return a > b ? (double)(a - b) : (double)(b - a);
+ }
+
+ /**
+  * Interval to the next sample, given the interval that led to this one
+  * A sample that cannot be derived leaves the interval and the baseline alone
+  */
+ uint64_t adapt_next(struct adaptive *ad, const struct mem_sample *sample, uint64_t interval_ns) {
+     struct mem_values mv;
+     struct mem_rates mr;
+
+     if (!(sample->valid & SAMPLE_VM) || sample_derive(&sample->counters, &mv) != DERIVE_OK || mv.total == 0) {
+         return interval_ns;
+     }
+     if (!ad->have_prev || sample->tick.actual_ns <= ad->prev.tick.actual_ns) {
+         ad->prev = *sample;
+         ad->prev_values = mv;
+         ad->have_prev = 1;
+         return interval_ns;
+     }
+
+     double seconds = (double)(sample->tick.actual_ns - ad->prev.tick.actual_ns) / NSEC_PER_SEC;
+     double bytes = change(mv.used, ad->prev_values.used);
+     if (change(mv.free, ad->prev_values.free) > bytes) bytes = change(mv.free, ad->prev_values.free);
+     if (change(mv.swap_used, ad->prev_values.swap_used) > bytes) bytes = change(mv.swap_used, ad->prev_values.swap_used);
+
+     /* Paging shows pressure even when the totals end up where they started */
+     if (sample_rates(&ad->prev, sample, &mr) == DERIVE_OK) {
+         double paged = (mr.pageins + mr.pageouts + mr.swapins + mr.swapouts) *
+                        (double)sample->counters.event_page_size * seconds;
+         if (paged > bytes) bytes = paged;
+     }
+
+     ad->volatility = bytes * 100.0 / (double)mv.total / seconds;
+     ad->prev = *sample;
+     ad->prev_values = mv;
+
+     if (ad->volatility > ad->threshold) {
+         return ad->min_ns;
+     }
+     return interval_ns >= ad->max_ns / 2 ? ad->max_ns : interval_ns * 2;
+ }
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_ADAPT_H
+ #define FREE_ADAPT_H
+
+ #include <stdint.h>
+
+ #include "sample.h"
+
+ /*
+  * Adaptive sampling interval
+  *
+  * Volatility is the fastest change among used, free and used swap memory,
+  * or the bytes paged and swapped in and out, as a percentage of physical
+  * memory per second since the previous sample. Above the threshold the
+  * interval drops straight to the minimum, below it the interval doubles
+  * per sample back up to the maximum.
+  */
+
+ #define ADAPT_DEFAULT_THRESHOLD 1.0     /* Percent of physical memory per second */
+
+ struct adaptive {
+     uint64_t min_ns;
+     uint64_t max_ns;
+     double threshold;
+     double volatility;              /* Of the last sample, percent per second */
+     int have_prev;
+     struct mem_sample prev;
+     struct mem_values prev_values;
+ };
+
+ void adapt_init(struct adaptive *ad, uint64_t min_ns, uint64_t max_ns, double threshold);
+ uint64_t adapt_next(struct adaptive *ad, const struct mem_sample *sample, uint64_t interval_ns);
+
+ #endif /* FREE_ADAPT_H */
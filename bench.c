@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /*
+  * Benchmark harness for the portable parts of free: formatting, memory
+  * math, frame rendering and the -s sampling loop. Counters come from a
+  * synthetic source, so it builds and runs without Mach. Results are
+  * printed as one JSON object per line.
+  */
+
+ #include <fcntl.h>
+ #include <getopt.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <unistd.h>
+
+ #include "freemem.h"
+ #include "render.h"
+ #include "sample.h"
+ #include "sched.h"
+
+ #define PROGRAM_VERSION FREEMEM_VERSION
+ #define SYNTHETIC_PAGE_SIZE 16384ULL
+ #define SYNTHETIC_MEM_TOTAL (16ULL * 1024 * 1024 * 1024)
+ #define SYNTHETIC_PAGES (SYNTHETIC_MEM_TOTAL / SYNTHETIC_PAGE_SIZE)
+
+ /* Minimum wall time per benchmark, adjustable with -t */
+ static double g_min_seconds = 0.25;
+ static const char *g_filter = NULL;
+
+ /* Results land here so the compiler cannot drop the work */
+ static volatile unsigned long long g_sink;
+
+ /* xorshift64 state of the synthetic source */
+ static uint64_t g_rng = 0x9E3779B97F4A7C15ULL;
+
+ static uint64_t next_random(void) {
+     g_rng ^= g_rng << 13;
+     g_rng ^= g_rng >> 7;
+     g_rng ^= g_rng << 17;
+     return g_rng;
+ }
+
+ /**
+  * Synthetic counter source: a plausible 16 GiB host whose page counts
+  * wander a little on every sample
+  */
+ static void synthetic_sample(struct mem_sample *sample) {
+     struct mem_counters *c = &sample->counters;
+     uint64_t r = next_random();
+
+     memset(c, 0, sizeof(*c));
+     c->page_size = SYNTHETIC_PAGE_SIZE;
+     c->mem_total = SYNTHETIC_MEM_TOTAL;
+     c->free_count = 20000 + (r & 0x3fff);
+     c->speculative_count = 3000 + ((r >> 14) & 0x3ff);
+     c->wire_count = 180000 + ((r >> 24) & 0xfff);
+     c->internal_page_count = 500000 + ((r >> 36) & 0xffff);
+     c->purgeable_count = 4000 + ((r >> 52) & 0x3ff);
+     c->external_page_count = SYNTHETIC_PAGES - c->free_count - c->wire_count - c->internal_page_count;
+     c->swap_total = 2ULL * 1024 * 1024 * 1024;
+     c->swap_used = 377421824ULL + (r & 0xfffff) * 4096;
+     c->swap_avail = c->swap_total - c->swap_used;
+     sample->valid = SAMPLE_VM | SAMPLE_SWAP;
+ }
+
+ /**
+  * Print one result line
+  */
+ static void report(const char *name, unsigned long long ops, uint64_t elapsed_ns, const char *extra) {
+     double ns_per_op = ops ? (double)elapsed_ns / (double)ops : 0.0;
+     double ops_per_sec = elapsed_ns ? (double)ops * NSEC_PER_SEC / (double)elapsed_ns : 0.0;
+
+     printf("{\"bench\":\"%s\",\"ops\":%llu,\"elapsed_ns\":%llu,\"ns_per_op\":%.2f,\"ops_per_sec\":%.0f%s}\n",
+            name, ops, (unsigned long long)elapsed_ns, ns_per_op, ops_per_sec, extra ? extra : "");
+     fflush(stdout);
+ }
+
+ static int selected(const char *name) {
+     return g_filter == NULL || strstr(name, g_filter) != NULL;
+ }
+
+ /* Byte values spanning every unit, cycled through by the formatter benchmarks */
+ #define VALUE_COUNT 64
+ static unsigned long long g_values[VALUE_COUNT];
+
+ static void bench_format(const char *name, int human, int si, int unit) {
+     char buffer[MEMORY_STRING_BUFFER_SIZE];
+     unsigned long long ops = 0;
+     uint64_t start = sched_now_ns(), elapsed;
+
+     if (!selected(name)) return;
+     do {
+         for (int i = 0; i < 1024; i++) {
+             formatBytes(g_values[i % VALUE_COUNT], buffer, sizeof(buffer), human, si, unit);
+             g_sink += (unsigned char)buffer[0];
+         }
+         ops += 1024;
+         elapsed = sched_now_ns() - start;
+     } while (elapsed < g_min_seconds * NSEC_PER_SEC);
+     report(name, ops, elapsed, NULL);
+ }
+
+ static void bench_derive(const char *name) {
+     struct mem_sample samples[VALUE_COUNT];
+     struct mem_values mv;
+     unsigned long long ops = 0;
+     uint64_t start, elapsed;
+
+     if (!selected(name)) return;
+     for (int i = 0; i < VALUE_COUNT; i++) {
+         synthetic_sample(&samples[i]);
+     }
+     start = sched_now_ns();
+     do {
+         for (int i = 0; i < 1024; i++) {
+             sample_derive(&samples[i % VALUE_COUNT].counters, &mv);
+             g_sink += mv.used;
+         }
+         ops += 1024;
+         elapsed = sched_now_ns() - start;
+     } while (elapsed < g_min_seconds * NSEC_PER_SEC);
+     report(name, ops, elapsed, NULL);
+ }
+
+ static void bench_render(const char *name, const struct render_opts *opts) {
+     static struct outbuf frame;
+     struct mem_values mv[VALUE_COUNT];
+     struct mem_sample sample;
+     unsigned long long ops = 0, bytes = 0;
+     uint64_t start, elapsed;
+     char extra[64];
+
+     if (!selected(name)) return;
+     for (int i = 0; i < VALUE_COUNT; i++) {
+         synthetic_sample(&sample);
+         sample_derive(&sample.counters, &mv[i]);
+     }
+     start = sched_now_ns();
+     do {
+         for (int i = 0; i < 256; i++) {
+             outbuf_reset(&frame);
+             render_sample(&frame, opts, &sample, &mv[i % VALUE_COUNT]);
+             bytes += frame.len;
+         }
+         ops += 256;
+         elapsed = sched_now_ns() - start;
+     } while (elapsed < g_min_seconds * NSEC_PER_SEC);
+     g_sink += bytes;
+     snprintf(extra, sizeof(extra), ",\"bytes_per_frame\":%.1f", (double)bytes / (double)ops);
+     report(name, ops, elapsed, extra);
+ }
+
+ /**
+  * The -s loop end to end: scheduler, synthetic collection, derivation,
+  * rendering and one write() per frame to /dev/null
+  * An interval of 0 runs as fast as the loop allows
+  */
+ static void bench_loop(const char *name, uint64_t interval_ns, const struct render_opts *opts) {
+     static struct outbuf frame;
+     struct scheduler sched;
+     struct mem_sample sample;
+     struct mem_values mv;
+     unsigned long long ops = 0;
+     uint64_t elapsed = 0;
+     char extra[160];
+
+     if (!selected(name)) return;
+     int fd = open("/dev/null", O_WRONLY);
+     if (fd < 0) {
+         perror("free-bench: /dev/null");
+         return;
+     }
+
+     sched_init(&sched, interval_ns, interval_ns ? SCHED_MISSED_SKIP : SCHED_MISSED_CATCHUP);
+     do {
+         /* An interrupted wait still counts against the run time */
+         if (sched_wait(&sched, &sample.tick) == 0) {
+             synthetic_sample(&sample);
+             sample_derive(&sample.counters, &mv);
+             outbuf_reset(&frame);
+             render_frame(&frame, opts, &mv);
+             outbuf_write(&frame, fd);
+             ops++;
+         }
+         elapsed = sched_now_ns() - sched.start_ns;
+     } while (elapsed < g_min_seconds * NSEC_PER_SEC * (interval_ns ? 4 : 1));
+     close(fd);
+
+     /* Jitter only means something when the loop actually sleeps */
+     if (interval_ns == 0) {
+         snprintf(extra, sizeof(extra), ",\"interval_ns\":0");
+     } else {
+         snprintf(extra, sizeof(extra),
+                  ",\"interval_ns\":%llu,\"jitter_mean_ns\":%.0f,\"jitter_max_ns\":%llu,\"missed\":%llu",
+                  (unsigned long long)interval_ns, sched.stats.mean_ns,
+                  (unsigned long long)sched.stats.max_ns, (unsigned long long)sched.stats.missed);
+     }
+     report(name, ops, elapsed, extra);
+ }
+
+ static void print_usage(const char *program_name) {
+     printf("Usage: %s [OPTIONS]\n", program_name);
+     printf("Options:\n");
+     printf("  -t, --time seconds  Minimum run time of each benchmark (default 0.25).\n");
+     printf("  -f, --filter text   Only run benchmarks whose name contains text.\n");
+     printf("  --help              Print help.\n");
+ }
+
+ int main(int argc, char *argv[]) {
+     static struct option long_options[] = {
+         {"time", required_argument, 0, 't'},
+         {"filter", required_argument, 0, 'f'},
+         {"help", no_argument, 0, '?'},
+         {0, 0, 0, 0}
+     };
+
+     int opt;
+     while ((opt = getopt_long(argc, argv, "t:f:?", long_options, NULL)) != -1) {
+         switch (opt) {
+             case 't':
+                 {
+                     char *endptr;
+                     double value = strtod(optarg, &endptr);
+                     if (*endptr != '\0' || value <= 0 || value > 60) {
+                         fprintf(stderr, "free-bench: invalid time value\n");
+                         return EXIT_FAILURE;
+                     }
+                     g_min_seconds = value;
+                 }
+                 break;
+             case 'f': g_filter = optarg; break;
+             default:
+                 print_usage(argv[0]);
+                 return opt == '?' ? EXIT_SUCCESS : EXIT_FAILURE;
+         }
+     }
+
+     /* Values from a few bytes up to 16 TiB */
+     for (int i = 0; i < VALUE_COUNT; i++) {
+         g_values[i] = next_random() >> (20 + i % 40);
+     }
+
+     printf("{\"suite\":\"free-bench\",\"version\":\"%s\",\"min_seconds\":%.2f}\n",
+            PROGRAM_VERSION, g_min_seconds);
+
+     bench_format("format/kibi", 0, 0, 1);
+     bench_format("format/bytes", 0, 0, 0);
+     bench_format("format/mega-si", 0, 1, 2);
+     bench_format("format/human", 1, 0, 0);
+     bench_format("format/human-si", 1, 1, 0);
+
+     bench_derive("derive/vm_statistics64");
+
+     struct render_opts standard = {0, 0, 1, 0, 0, 0, 0, RENDER_FORMAT_TEXT};
+     struct render_opts human = {1, 0, 1, 0, 0, 0, 0, RENDER_FORMAT_TEXT};
+     struct render_opts wide_all = {1, 0, 1, 1, 0, 1, 1, RENDER_FORMAT_TEXT};
+     struct render_opts line = {1, 0, 1, 0, 1, 0, 0, RENDER_FORMAT_TEXT};
+     struct render_opts json = {0, 0, 1, 0, 0, 0, 0, RENDER_FORMAT_JSON};
+     struct render_opts csv = {0, 0, 1, 0, 0, 0, 0, RENDER_FORMAT_CSV};
+     bench_render("render/standard", &standard);
+     bench_render("render/human", &human);
+     bench_render("render/wide-total-committed", &wide_all);
+     bench_render("render/line", &line);
+     bench_render("render/json", &json);
+     bench_render("render/csv", &csv);
+
+     bench_loop("loop/unthrottled", 0, &line);
+     bench_loop("loop/100hz", NSEC_PER_SEC / 100, &line);
+
+     return EXIT_SUCCESS;
+ }
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "cgroup.h"
+
+ #include <dirent.h>
+ #include <fcntl.h>
+ #include <limits.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+
+ #include "collect.h"
+
+ /* The memory.stat fields shown for the winners */
+ struct cgroup_split {
+     uint64_t anon;
+     uint64_t file;
+ };
+
+ static const struct proc_key split_keys[] = {
+     {"anon", 4, offsetof(struct cgroup_split, anon)},
+     {"file", 4, offsetof(struct cgroup_split, file)}
+ };
+
+ /**
+  * Heap order: less memory first, the later directory losing ties
+  */
+ static int cgroup_less(const void *a, const void *b) {
+     const struct cgroup_info *x = a, *y = b;
+     return x->current < y->current || (x->current == y->current && x->node > y->node);
+ }
+
+ /**
+  * Append "parent/name", or name alone below the root, to an arena
+  * Returns 0, or -1 when the arena could not grow
+  */
+ static int arena_add(struct cgroup_arena *a, const char *parent, const char *name) {
+     size_t plen = strlen(parent), nlen = strlen(name);
+     size_t need = plen + (plen > 0) + nlen + 1;
+
+     if (a->len + need > a->size) {
+         size_t size = a->size ? a->size : 4096;
+         while (a->len + need > size) size *= 2;
+         char *data = realloc(a->data, size);
+         if (data == NULL) {
+             return -1;
+         }
+         a->data = data;
+         a->size = size;
+     }
+     if (a->count == a->offset_size) {
+         size_t size = a->offset_size ? a->offset_size * 2 : 256;
+         size_t *offset = realloc(a->offset, size * sizeof(*offset));
+         if (offset == NULL) {
+             return -1;
+         }
+         a->offset = offset;
+         a->offset_size = size;
+     }
+
+     char *p = a->data + a->len;
+     a->offset[a->count++] = a->len;
+     memcpy(p, parent, plen);
+     if (plen > 0) p[plen++] = '/';
+     memcpy(p + plen, name, nlen + 1);
+     a->len += need;
+     return 0;
+ }
+
+ static void arena_free(struct cgroup_arena *a) {
+     free(a->data);
+     free(a->offset);
+     memset(a, 0, sizeof(*a));
+ }
+
+ /**
+  * Read a file of the directory dfd into buf, NUL-terminated
+  * Returns the length, or -1 when it is gone
+  */
+ static ssize_t read_file(int dfd, const char *name, char *buf, size_t size) {
+     int fd = openat(dfd, name, O_RDONLY | O_CLOEXEC);
+     if (fd < 0) {
+         return -1;
+     }
+     ssize_t n = read(fd, buf, size - 1);
+     close(fd);
+     if (n < 0) {
+         return -1;
+     }
+     buf[n] = '\0';
+     return n;
+ }
+
+ /**
+  * Offer one directory's memory.current, unless it is the root, and list
+  * its subdirectories, the child cgroups, into the worker's arena
+  */
+ static void scan_dir(struct cgroup_scan *cs, struct cgroup_worker *w, size_t node) {
+     const char *path = cs->nodes.data + cs->nodes.offset[node];
+     struct dirent *de;
+
+     int fd = openat(cs->dir_fd, *path ? path : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+     if (fd < 0) {
+         return;
+     }
+     if (node > 0 && read_file(fd, "memory.current", w->buf, sizeof(w->buf)) > 0) {
+         struct cgroup_info e = {node, NULL, strtoull(w->buf, NULL, 10), UINT64_MAX, 0, 0};
+         top_offer(&w->heap, &e);
+     }
+
+     DIR *dir = fdopendir(fd);
+     if (dir == NULL) {
+         close(fd);
+         return;
+     }
+     size_t plen = strlen(path);
+     while ((de = readdir(dir)) != NULL) {
+         struct stat st;
+         if (de->d_name[0] == '.' || (de->d_type != DT_DIR && de->d_type != DT_UNKNOWN)) {
+             continue;
+         }
+         if (de->d_type == DT_UNKNOWN &&
+             (fstatat(dirfd(dir), de->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 || !S_ISDIR(st.st_mode))) {
+             continue;
+         }
+         if (plen + 1 + strlen(de->d_name) >= PATH_MAX) {
+             continue;
+         }
+         if (arena_add(&w->children, path, de->d_name) != 0) {
+             w->failed = 1;
+         }
+     }
+     closedir(dir);
+ }
+
+ /**
+  * Pool job: claim chunks of the current level until none are left
+  */
+ static void scan_chunks(void *ctx, unsigned worker) {
+     struct cgroup_scan *cs = ctx;
+     size_t begin, end;
+
+     while (pool_claim(&cs->pool, &begin, &end)) {
+         for (size_t i = begin; i < end; i++) {
+             scan_dir(cs, &cs->worker[worker], i);
+         }
+     }
+ }
+
+ /**
+  * Limit and anonymous/file split of a winner
+  */
+ static void read_details(struct cgroup_scan *cs, struct cgroup_info *e) {
+     struct cgroup_split split = {0, 0};
+
+     int fd = openat(cs->dir_fd, e->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+     if (fd < 0) {
+         return;
+     }
+     if (read_file(fd, "memory.max", cs->buf, sizeof(cs->buf)) > 0 && strncmp(cs->buf, "max", 3) != 0) {
+         e->max = strtoull(cs->buf, NULL, 10);
+     }
+     ssize_t len = read_file(fd, "memory.stat", cs->buf, sizeof(cs->buf));
+     if (len > 0) {
+         proc_parse(cs->buf, (size_t)len, split_keys, KEY_COUNT(split_keys), &split);
+     }
+     close(fd);
+     e->anon = split.anon;
+     e->file = split.file;
+ }
+
+ /**
+  * Prepare to report the top largest cgroups below dir with up to workers
+  * threads, the caller's included
+  * The node list and arenas grow with the tree, everything else is
+  * allocated here
+  */
+ int cgroup_open(struct cgroup_scan *cs, unsigned top, unsigned workers, const char *dir) {
+     memset(cs, 0, sizeof(*cs));
+     cs->top = top;
+     pool_init(&cs->pool, workers, CGROUP_CHUNK, scan_chunks, cs);
+
+     cs->dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+     if (cs->dir_fd < 0) {
+         return CGROUP_ERR_OPEN;
+     }
+
+     cs->worker = calloc(cs->pool.workers, sizeof(*cs->worker));
+     if (cs->worker == NULL || top_init(&cs->best, top, sizeof(struct cgroup_info), cgroup_less) != 0) {
+         return CGROUP_ERR_NOMEM;
+     }
+     cs->result = (struct cgroup_info *)cs->best.data;
+     for (unsigned i = 0; i < cs->pool.workers; i++) {
+         if (top_init(&cs->worker[i].heap, top, sizeof(struct cgroup_info), cgroup_less) != 0) {
+             return CGROUP_ERR_NOMEM;
+         }
+     }
+     return pool_start(&cs->pool) == 0 ? CGROUP_OK : CGROUP_ERR_THREAD;
+ }
+
+ /**
+  * Walk the tree and select the largest cgroups into cs->result, largest
+  * first
+  * Returns CGROUP_OK or a CGROUP_ERR_* code
+  */
+ int cgroup_scan(struct cgroup_scan *cs) {
+     cs->nodes.len = 0;
+     cs->nodes.count = 0;
+     if (arena_add(&cs->nodes, "", "") != 0) {
+         return CGROUP_ERR_NOMEM;
+     }
+     for (unsigned i = 0; i < cs->pool.workers; i++) {
+         cs->worker[i].heap.count = 0;
+     }
+
+     for (size_t begin = 0; begin < cs->nodes.count;) {
+         size_t level_end = cs->nodes.count;
+         pool_run(&cs->pool, begin, level_end);
+         begin = level_end;
+
+         /* The next level is every child found in this one */
+         for (unsigned i = 0; i < cs->pool.workers; i++) {
+             struct cgroup_worker *w = &cs->worker[i];
+             for (size_t j = 0; j < w->children.count; j++) {
+                 if (arena_add(&cs->nodes, "", w->children.data + w->children.offset[j]) != 0) {
+                     w->failed = 1;
+                 }
+             }
+             w->children.len = 0;
+             w->children.count = 0;
+             if (w->failed) {
+                 w->failed = 0;
+                 return CGROUP_ERR_NOMEM;
+             }
+         }
+     }
+
+     /* Merge the workers' heaps; only the winners are sorted and detailed */
+     cs->best.count = 0;
+     for (unsigned i = 0; i < cs->pool.workers; i++) {
+         const struct cgroup_info *heap = (const struct cgroup_info *)cs->worker[i].heap.data;
+         for (size_t j = 0; j < cs->worker[i].heap.count; j++) {
+             top_offer(&cs->best, &heap[j]);
+         }
+     }
+     top_sort(&cs->best);
+     cs->nresult = cs->best.count;
+     for (size_t i = 0; i < cs->nresult; i++) {
+         cs->result[i].path = cs->nodes.data + cs->nodes.offset[cs->result[i].node];
+         read_details(cs, &cs->result[i]);
+     }
+     return CGROUP_OK;
+ }
+
+ /**
+  * Render the --cgroup-top list from entry first on, as a table below the
+  * frame or as one "Cgroups:" line after it
+  * Stops while the buffer still has room for another entry; returns the
+  * index of the next entry, nresult once the list is complete
+  */
+ size_t cgroup_render(struct outbuf *ob, const struct render_opts *opts, const struct cgroup_scan *cs, size_t first) {
+     static const char *const header[] = {"current", "max", "anon", "file"};
+     size_t i = first;
+
+     for (; i < cs->nresult && sizeof(ob->data) - ob->len > 320; i++) {
+         const struct cgroup_info *e = &cs->result[i];
+         const uint64_t values[] = {e->current, e->max, e->anon, e->file};
+         char cells[4][MEMORY_STRING_BUFFER_SIZE];
+
+         if (i == 0) {
+             if (opts->line) {
+                 outbuf_puts(ob, "Cgroups:");
+             } else {
+                 for (int k = 0; k < 4; k++) {
+                     outbuf_pad(ob, header[k], 11);
+                     outbuf_append(ob, " ", 1);
+                 }
+                 outbuf_puts(ob, " cgroup\n");
+             }
+         }
+         for (int k = 0; k < 4; k++) {
+             if (values[k] == UINT64_MAX) {
+                 snprintf(cells[k], sizeof(cells[k]), "max");
+             } else if (formatBytes(values[k], cells[k], sizeof(cells[k]), opts->human, opts->si, opts->unit) < 0) {
+                 snprintf(cells[k], sizeof(cells[k]), "?");
+             }
+         }
+
+         /* Deep paths keep their tail, the part that tells siblings apart */
+         size_t len = strlen(e->path);
+         const char *path = len > 160 ? e->path + len - 157 : e->path;
+         if (opts->line) {
+             outbuf_puts(ob, i == 0 ? " " : ", ");
+             if (path != e->path) outbuf_puts(ob, "...");
+             outbuf_puts(ob, path);
+             outbuf_append(ob, " ", 1);
+             outbuf_puts(ob, cells[0]);
+         } else {
+             for (int k = 0; k < 4; k++) {
+                 outbuf_pad(ob, cells[k], 11);
+                 outbuf_append(ob, " ", 1);
+             }
+             outbuf_append(ob, " ", 1);
+             if (path != e->path) outbuf_puts(ob, "...");
+             outbuf_puts(ob, path);
+             outbuf_append(ob, "\n", 1);
+         }
+     }
+     if (i == cs->nresult && opts->line && cs->nresult > 0) {
+         outbuf_append(ob, "\n", 1);
+     }
+     return i;
+ }
+
+ void cgroup_close(struct cgroup_scan *cs) {
+     pool_close(&cs->pool);
+     if (cs->worker != NULL) {
+         for (unsigned i = 0; i < cs->pool.workers; i++) {
+             top_free(&cs->worker[i].heap);
+             arena_free(&cs->worker[i].children);
+         }
+         free(cs->worker);
+         cs->worker = NULL;
+     }
+     top_free(&cs->best);
+     cs->result = NULL;
+     arena_free(&cs->nodes);
+     if (cs->dir_fd >= 0) {
+         close(cs->dir_fd);
+         cs->dir_fd = -1;
+     }
+ }
+
+ /**
+  * Message for a CGROUP_* status
+  */
+ const char *cgroup_strerror(int status) {
+     switch (status) {
+         case CGROUP_OK: return "success";
+         case CGROUP_ERR_OPEN: return "cannot open the cgroup directory";
+         case CGROUP_ERR_NOMEM: return "cannot allocate the cgroup list";
+         case CGROUP_ERR_THREAD: return "cannot start the cgroup scan workers";
+         default: return "unknown cgroup scan error";
+     }
+ }
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_CGROUP_H
+ #define FREE_CGROUP_H
+
+ #include <stddef.h>
+ #include <stdint.h>
+
+ #include "pool.h"
+ #include "render.h"
+
+ /*
+  * Largest child cgroups by memory.current for --cgroup-top
+  *
+  * The tree below the --cgroup directory is walked one level at a time. A
+  * small pool of workers claims the directories of a level in chunks,
+  * reads each one's memory.current into its own top-n min-heap and lists
+  * its subdirectories into its own arena; the arenas are merged into the
+  * next level between passes. Only memory.max and memory.stat of the n
+  * winners are read.
+  */
+
+ #define CGROUP_MAX_TOP 1000
+ #define CGROUP_MAX_WORKERS POOL_MAX_WORKERS
+ #define CGROUP_CHUNK 16             /* Directories a worker claims at a time */
+ #define CGROUP_READ_SIZE 8192
+
+ /* Status codes of the cgroup tree scanner */
+ typedef enum {
+     CGROUP_OK = 0,
+     CGROUP_ERR_OPEN,        /* The --cgroup directory could not be opened */
+     CGROUP_ERR_NOMEM,       /* Could not allocate the node list, arenas or heaps */
+     CGROUP_ERR_THREAD       /* Could not start a worker */
+ } CgroupStatus;
+
+ struct cgroup_info {
+     size_t node;                    /* Index into the scan's node list */
+     const char *path;               /* Below the --cgroup directory, set for the winners */
+     uint64_t current;               /* Bytes */
+     uint64_t max;                   /* UINT64_MAX for no limit */
+     uint64_t anon;
+     uint64_t file;
+ };
+
+ /* Growable string arena, names are addressed by offset */
+ struct cgroup_arena {
+     char *data;
+     size_t len;
+     size_t size;
+     size_t *offset;                 /* Start of each name */
+     size_t count;
+     size_t offset_size;
+ };
+
+ struct cgroup_worker {
+     struct top_heap heap;           /* The largest, top entries this worker saw */
+     struct cgroup_arena children;   /* Subdirectories found in this pass */
+     int failed;                     /* An arena could not grow */
+     char buf[64];
+ };
+
+ struct cgroup_scan {
+     unsigned top;
+     int dir_fd;                     /* The --cgroup directory */
+
+     /* Every directory of the current scan, level by level; node 0 is the root */
+     struct cgroup_arena nodes;
+
+     struct pool pool;               /* Claims a level CGROUP_CHUNK directories at a time */
+     struct cgroup_worker *worker;   /* One per pool worker */
+     struct top_heap best;           /* The workers' heaps merged */
+     struct cgroup_info *result;     /* Largest first after cgroup_scan() */
+     size_t nresult;
+     char buf[CGROUP_READ_SIZE];     /* memory.stat of a winner */
+ };
+
+ int cgroup_open(struct cgroup_scan *cs, unsigned top, unsigned workers, const char *dir);
+ int cgroup_scan(struct cgroup_scan *cs);
+ size_t cgroup_render(struct outbuf *ob, const struct render_opts *opts, const struct cgroup_scan *cs, size_t first);
+ void cgroup_close(struct cgroup_scan *cs);
+ const char *cgroup_strerror(int status);
+
+ #endif /* FREE_CGROUP_H */
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "collect.h"
+
+ #include <stdio.h>
+ #include <string.h>
+
+ /**
+  * Build the per-run collection plan from the enabled output options
+  * The Mem line and -t need the page counts; the Swap line, -t and -v all
+  * read the same swap figures, so one query per sample covers them;
+  * --rates needs the cumulative event counters
+  */
+ unsigned collect_plan(int mem_line, int swap_line, int total, int committed, int events) {
+     unsigned plan = 0;
+
+     if (mem_line || total) {
+         plan |= SAMPLE_VM;
+     }
+     if (swap_line || total || committed) {
+         plan |= SAMPLE_SWAP;
+     }
+     if (events) {
+         plan |= SAMPLE_EVENTS;
+     }
+     return plan;
+ }
+
+ /**
+  * Pick the backend and fetch the static host facts once
+  * A fixture root selects the meminfo backend on any platform; otherwise
+  * Mach is used on macOS and /proc/meminfo elsewhere
+  * Returns COLLECT_OK or a COLLECT_ERR_* code
+  */
+ int collect_open(struct collector *col, unsigned plan, const char *fixture) {
+     memset(col, 0, sizeof(*col));
+     col->plan = plan;
+     col->fixture = fixture;
+     col->meminfo_fd = -1;
+     col->vmstat_fd = -1;
+
+ #ifdef __APPLE__
+     col->ops = fixture ? &collector_meminfo_ops : &collector_mach_ops;
+ #else
+     col->ops = &collector_meminfo_ops;
+ #endif
+
+     return col->ops->open(col);
+ }
+ 
+ /**
+  * Read samples from the snapshot ring a --daemon publishes instead of
+  * from the kernel; the plan only documents what the caller renders
+  * Returns COLLECT_OK or a COLLECT_ERR_* code
+  */
+ int collect_attach(struct collector *col, unsigned plan, const char *ring_path) {
+     memset(col, 0, sizeof(*col));
+     col->plan = plan;
+     col->ring_path = ring_path;
+     col->meminfo_fd = -1;
+     col->vmstat_fd = -1;
+     col->ring.fd = -1;
+     col->ops = &collector_shm_ops;
+ 
+     return col->ops->open(col);
+ }
+
+ /**
+  * Report one cgroup v2 group instead of the host: path is relative to
+  * /sys/fs/cgroup, or a path below it, and the fixture root is prepended
+  * Returns COLLECT_OK or a COLLECT_ERR_* code
+  */
+ int collect_cgroup(struct collector *col, unsigned plan, const char *path, const char *fixture) {
+     memset(col, 0, sizeof(*col));
+     col->plan = plan;
+     col->fixture = fixture;
+     col->meminfo_fd = -1;
+     col->vmstat_fd = -1;
+     col->cgroup_current_fd = -1;
+     col->cgroup_stat_fd = -1;
+     col->cgroup_swap_fd = -1;
+     col->cgroup_swap_max_fd = -1;
+     col->ops = &collector_cgroup_ops;
+ 
+     int below = strncmp(path, CGROUP_ROOT, sizeof(CGROUP_ROOT) - 1) == 0;
+     int n = snprintf(col->cgroup_dir, sizeof(col->cgroup_dir), "%s%s%s%s", fixture ? fixture : "",
+                      below ? "" : CGROUP_ROOT, below || path[0] == '/' ? "" : "/", path);
+     if (n < 0 || (size_t)n >= sizeof(col->cgroup_dir)) {
+         return COLLECT_ERR_CGROUP;
+     }
+     return col->ops->open(col);
+ }
+
+ /**
+  * Fetch the dynamic counters named in the plan into sample
+  * Swap failures are not fatal: the swap counters are left zeroed and the
+  * status is COLLECT_ERR_SWAP with SAMPLE_SWAP missing from sample->valid
+  */
+ int collect_sample(struct collector *col, struct mem_sample *sample) {
+     if (col->ops == NULL) {
+         return COLLECT_ERR_BACKEND;
+     }
+
+     memset(&sample->counters, 0, sizeof(sample->counters));
+     sample->valid = 0;
+     sample->counters.page_size = col->facts.page_size;
+     sample->counters.mem_total = col->facts.mem_total;
+     col->calls_made = 0;
+
+     return col->ops->sample(col, sample);
+ }
+
+ /**
+  * Release the backend's resources
+  * Returns 0 on success, -1 if they could not be released
+  */
+ int collect_close(struct collector *col) {
+     int ret = 0;
+
+     if (col->ops != NULL) {
+         ret = col->ops->close(col);
+         col->ops = NULL;
+     }
+     return ret;
+ }
+
+ /**
+  * Message for a COLLECT_* status, worded like the other free: errors
+  */
+ const char *collect_strerror(int status) {
+     switch (status) {
+         case COLLECT_OK: return "success";
+         case COLLECT_ERR_HOST: return "cannot get host information";
+         case COLLECT_ERR_PAGESIZE: return "cannot get memory page size";
+         case COLLECT_ERR_HOSTINFO: return "cannot get memory information";
+         case COLLECT_ERR_VM: return "cannot get vm statistics";
+         case COLLECT_ERR_SWAP: return "cannot get swap information";
+         case COLLECT_ERR_OPEN: return "cannot open memory information";
+         case COLLECT_ERR_BACKEND: return "no memory information backend";
+         case COLLECT_ERR_RING: return "cannot attach to snapshot ring";
+         case COLLECT_ERR_EMPTY: return "no snapshot published yet";
+         case COLLECT_ERR_STALE: return "snapshot is stale, is the daemon running?";
+         case COLLECT_ERR_TORN: return "the daemon died while writing a snapshot";
+         case COLLECT_ERR_CGROUP: return "not a cgroup v2 group with the memory controller";
+         default: return "unknown collection error";
+     }
+ }
+
+ /**
+  * Name of a kernel call of the active backend, for --debug timing output
+  */
+ const char *collect_call_name(const struct collector *col, int call) {
+     if (col->ops == NULL || col->ops->call_name == NULL) {
+         return "?";
+     }
+     return col->ops->call_name(call);
+ }
+
+ /**
+  * Start timing a kernel call, used by the backends
+  */
+ uint64_t collect_call_begin(const struct collector *col) {
+     return col->timing ? sched_now_ns() : 0;
+ }
+
+ /**
+  * Record that a call ran and, when timing, how long it took
+  */
+ void collect_call_end(struct collector *col, int call, uint64_t start) {
+     col->calls_made |= 1u << call;
+     if (col->timing) {
+         col->call_ns[call] = sched_now_ns() - start;
+     }
+ }
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_COLLECT_H
+ #define FREE_COLLECT_H
+
+ #include <stddef.h>
+ #include <stdint.h>
+ #include <sys/types.h>
+ #ifdef __APPLE__
+ #include <mach/mach.h>
+ #endif
+
+ #include "sample.h"
+ #include "shm.h"
+
+ #define MEMINFO_BUFFER_SIZE 8192
+ #define VMSTAT_BUFFER_SIZE 16384
+ #define CGROUP_ROOT "/sys/fs/cgroup"
+ #define CGROUP_PATH_SIZE 4096
+ #define CGROUP_MAX_DEPTH 32
+
+ /* Status codes of the collection layer */
+ typedef enum {
+     COLLECT_OK = 0,
+     COLLECT_ERR_HOST,       /* mach_host_self() failed */
+     COLLECT_ERR_PAGESIZE,   /* host_page_size() failed */
+     COLLECT_ERR_HOSTINFO,   /* HOST_BASIC_INFO failed or MemTotal missing */
+     COLLECT_ERR_VM,         /* HOST_VM_INFO64 or /proc/meminfo read failed */
+     COLLECT_ERR_SWAP,       /* VM_SWAPUSAGE failed */
+     COLLECT_ERR_OPEN,       /* /proc/meminfo could not be opened */
+     COLLECT_ERR_BACKEND,    /* No backend for this platform */
+     COLLECT_ERR_RING,       /* Snapshot ring missing or of another version */
+     COLLECT_ERR_EMPTY,      /* No snapshot published to the ring yet */
+     COLLECT_ERR_STALE,      /* The daemon stopped publishing */
+     COLLECT_ERR_TORN,       /* The daemon died while writing a snapshot */
+     COLLECT_ERR_CGROUP      /* Not a cgroup v2 directory with the memory controller */
+ } CollectStatus;
+
+ /* Kernel calls a backend may make per sample, indexes into collector.call_ns */
+ typedef enum {
+     COLLECT_CALL_VM,        /* host_statistics64(HOST_VM_INFO64), pread(/proc/meminfo), ring read */
+     COLLECT_CALL_SWAP,      /* sysctl(VM_SWAPUSAGE) */
+     COLLECT_CALL_EVENTS,    /* pread(/proc/vmstat); Mach has them in HOST_VM_INFO64 */
+     COLLECT_CALLS
+ } CollectCall;
+
+ /* Host facts that never change while we run */
+ struct host_facts {
+     uint64_t page_size;
+     uint64_t mem_total;
+ };
+
+ struct collector;
+
+ /* A collection backend */
+ struct collector_ops {
+     const char *name;
+     int (*open)(struct collector *col);
+     int (*sample)(struct collector *col, struct mem_sample *sample);
+     int (*close)(struct collector *col);
+     const char *(*call_name)(int call);
+ };
+
+ struct collector {
+     const struct collector_ops *ops;
+     struct host_facts facts;    /* Fetched once by collect_open() */
+     unsigned plan;              /* SAMPLE_* groups fetched per sample */
+     int timing;                 /* Measure each call into call_ns */
+     unsigned calls_made;        /* Bit n set when call n ran in the last sample */
+     uint64_t call_ns[COLLECT_CALLS];
+
+     /* Backend state */
+ #ifdef __APPLE__
+     mach_port_t host_port;
+ #endif
+     const char *fixture;        /* Fixture root replacing / for the meminfo backend */
+     int meminfo_fd;
+     char meminfo_buf[MEMINFO_BUFFER_SIZE];
+     int vmstat_fd;
+     uint64_t sys_page_size;     /* Unit of the /proc/vmstat page events */
+     uint64_t reserve_pages;     /* vm.page_free_target of the Mach backend */
+     char vmstat_buf[VMSTAT_BUFFER_SIZE];
+     const char *ring_path;      /* Snapshot ring of the shm backend */
+     struct shm_ring ring;
+     char cgroup_dir[CGROUP_PATH_SIZE];  /* cgroup backend; memory.stat goes in vmstat_buf */
+     int cgroup_current_fd;
+     int cgroup_stat_fd;
+     int cgroup_swap_fd;                 /* -1 without the swap controller */
+     int cgroup_swap_max_fd;
+     int cgroup_max_fd[CGROUP_MAX_DEPTH];    /* memory.max of the cgroup, then its ancestors */
+     unsigned cgroup_depth;
+     uint64_t swap_host;                 /* SwapTotal, the swap limit without memory.swap.max */
+ };
+
+ /* A field of a proc-style file, see proc_parse() */
+ struct proc_key {
+     const char *name;
+     size_t len;
+     size_t offset;
+ };
+
+ #define KEY_COUNT(keys) (sizeof(keys) / sizeof(keys[0]))
+
+ extern const struct collector_ops collector_mach_ops;
+ extern const struct collector_ops collector_meminfo_ops;
+ extern const struct collector_ops collector_shm_ops;
+ extern const struct collector_ops collector_cgroup_ops;
+
+ unsigned collect_plan(int mem_line, int swap_line, int total, int committed, int events);
+ int collect_open(struct collector *col, unsigned plan, const char *fixture);
+ int collect_attach(struct collector *col, unsigned plan, const char *ring_path);
+ int collect_cgroup(struct collector *col, unsigned plan, const char *path, const char *fixture);
+ int collect_sample(struct collector *col, struct mem_sample *sample);
+ int collect_close(struct collector *col);
+ const char *collect_strerror(int status);
+ const char *collect_call_name(const struct collector *col, int call);
+ uint64_t collect_call_begin(const struct collector *col);
+ void collect_call_end(struct collector *col, int call, uint64_t start);
+ unsigned long proc_parse(const char *buf, size_t len, const struct proc_key *keys, size_t nkeys, void *out);
+ ssize_t proc_read(int fd, char *buf, size_t size);
+ int proc_read_keys(int fd, char *buf, size_t size, const struct proc_key *keys, size_t nkeys, void *out,
+                    unsigned long *found);
+
+ #endif /* FREE_COLLECT_H */
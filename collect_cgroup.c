@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /*
+  * cgroup v2 collection backend for --cgroup: the group's memory.current,
+  * memory.max, memory.stat and swap files, kept open and re-read with
+  * pread() like /proc/meminfo. Counters are in bytes, with a page size of
+  * 1, so the table, -t, -v, --rates and every other output work
+  * unchanged. The total is the lowest memory.max from the group up to the
+  * root, or MemTotal when none is set, so free is the group's real
+  * headroom. Only POSIX is used, so fixture trees work on any platform.
+  */
+
+ #include "collect.h"
+
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <limits.h>
+ #include <stddef.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <unistd.h>
+
+ /* The memory.stat fields we use, in bytes or events */
+ struct memcg_stat {
+     uint64_t anon;
+     uint64_t file;
+     uint64_t kernel;                /* Since Linux 5.18, summed from the parts before */
+     uint64_t kernel_stack;
+     uint64_t pagetables;
+     uint64_t percpu;
+     uint64_t sock;
+     uint64_t vmalloc;
+     uint64_t slab_reclaimable;
+     uint64_t slab_unreclaimable;
+     uint64_t unevictable;
+     uint64_t zswap;                 /* Compressed size of the zswapped pages */
+     uint64_t pgfault;
+     uint64_t pswpin;                /* Pages, where the kernel has them */
+     uint64_t pswpout;
+     uint64_t zswpin;
+     uint64_t zswpout;
+ };
+
+ /* The host totals that stand in for "max" */
+ struct memcg_host {
+     uint64_t mem_total;             /* kB */
+     uint64_t swap_total;
+ };
+
+ #define STAT_KEY(name) { #name, sizeof(#name) - 1, offsetof(struct memcg_stat, name) }
+ #define HOST_KEY(name, field) { name, sizeof(name) - 1, offsetof(struct memcg_host, field) }
+
+ static const struct proc_key stat_keys[] = {
+     STAT_KEY(anon),
+     STAT_KEY(file),
+     STAT_KEY(kernel),
+     STAT_KEY(kernel_stack),
+     STAT_KEY(pagetables),
+     STAT_KEY(percpu),
+     STAT_KEY(sock),
+     STAT_KEY(vmalloc),
+     STAT_KEY(slab_reclaimable),
+     STAT_KEY(slab_unreclaimable),
+     STAT_KEY(unevictable),
+     STAT_KEY(zswap),
+     STAT_KEY(pgfault),
+     STAT_KEY(pswpin),
+     STAT_KEY(pswpout),
+     STAT_KEY(zswpin),
+     STAT_KEY(zswpout)
+ };
+
+ #define STAT_FOUND_KERNEL (1UL << 2)    /* Bit of "kernel" in the proc_parse() mask */
+
+ static const struct proc_key host_keys[] = {
+     HOST_KEY("MemTotal", mem_total),
+     HOST_KEY("SwapTotal", swap_total)
+ };
+
+ /**
+  * Open a file of the group directory dir
+  * Returns the descriptor, or -1
+  */
+ static int memcg_file(const char *dir, const char *name) {
+     char path[CGROUP_PATH_SIZE + 32];
+
+     int n = snprintf(path, sizeof(path), "%s/%s", dir, name);
+     if (n < 0 || (size_t)n >= sizeof(path)) {
+         return -1;
+     }
+     return open(path, O_RDONLY | O_CLOEXEC);
+ }
+
+ /**
+  * Re-read a one-value file: a byte count, or "max" for no limit
+  * Returns 0, or -1 when it could not be read
+  */
+ static int memcg_value(int fd, uint64_t *value) {
+     char buf[32];
+
+     if (proc_read(fd, buf, sizeof(buf)) <= 0) {
+         return -1;
+     }
+     *value = strncmp(buf, "max", 3) == 0 ? UINT64_MAX : strtoull(buf, NULL, 10);
+     return 0;
+ }
+
+ /**
+  * Read MemTotal and SwapTotal, the limits of a group with none of its own
+  */
+ static int host_totals(struct collector *col) {
+     char path[PATH_MAX];
+     struct memcg_host host = {0};
+     unsigned long found;
+
+     int n = snprintf(path, sizeof(path), "%s/proc/meminfo", col->fixture ? col->fixture : "");
+     int fd = n > 0 && (size_t)n < sizeof(path) ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+     if (fd < 0) {
+         return COLLECT_ERR_OPEN;
+     }
+     int ret = proc_read_keys(fd, col->meminfo_buf, sizeof(col->meminfo_buf), host_keys, KEY_COUNT(host_keys),
+                              &host, &found);
+     close(fd);
+     if (ret != 0 || host.mem_total == 0) {
+         return COLLECT_ERR_HOSTINFO;
+     }
+     col->facts.mem_total = host.mem_total * 1024;
+     col->swap_host = host.swap_total * 1024;
+     return COLLECT_OK;
+ }
+
+ /**
+  * Open the group's files and the memory.max of each ancestor below the
+  * root, which has none
+  */
+ static int memcg_open(struct collector *col) {
+     char dir[CGROUP_PATH_SIZE];
+     char root[CGROUP_PATH_SIZE];
+
+     int status = host_totals(col);
+     if (status != COLLECT_OK) {
+         return status;
+     }
+     col->facts.page_size = 1;
+     col->sys_page_size = sysconf(_SC_PAGESIZE) > 0 ? (uint64_t)sysconf(_SC_PAGESIZE) : 4096;
+
+     col->cgroup_current_fd = memcg_file(col->cgroup_dir, "memory.current");
+     col->cgroup_stat_fd = memcg_file(col->cgroup_dir, "memory.stat");
+     if (col->cgroup_current_fd < 0 || col->cgroup_stat_fd < 0) {
+         return COLLECT_ERR_CGROUP;
+     }
+     col->cgroup_swap_fd = memcg_file(col->cgroup_dir, "memory.swap.current");
+     col->cgroup_swap_max_fd = memcg_file(col->cgroup_dir, "memory.swap.max");
+
+     /* Walk up to the mount point, trailing slashes aside */
+     snprintf(root, sizeof(root), "%s%s", col->fixture ? col->fixture : "", CGROUP_ROOT);
+     snprintf(dir, sizeof(dir), "%s", col->cgroup_dir);
+     size_t len = strlen(dir), root_len = strlen(root);
+     while (len > root_len && col->cgroup_depth < CGROUP_MAX_DEPTH) {
+         while (len > root_len && dir[len - 1] == '/') dir[--len] = '\0';
+         if (len <= root_len) {
+             break;
+         }
+         int fd = memcg_file(dir, "memory.max");
+         if (fd >= 0) {
+             col->cgroup_max_fd[col->cgroup_depth++] = fd;
+         }
+         while (len > root_len && dir[len - 1] != '/') dir[--len] = '\0';
+     }
+     return COLLECT_OK;
+ }
+
+ /**
+  * Map the group onto the vm_statistics64 vocabulary: total is the limit,
+  * free what is left under it, cached the page cache and reclaimable slab,
+  * app the anonymous memory and wired the rest of the kernel memory
+  */
+ static int memcg_sample(struct collector *col, struct mem_sample *sample) {
+     struct mem_counters *c = &sample->counters;
+     struct memcg_stat st;
+     unsigned long found;
+
+     memset(&st, 0, sizeof(st));
+     if (col->plan & (SAMPLE_VM | SAMPLE_EVENTS)) {
+         uint64_t start = collect_call_begin(col);
+         int ret = proc_read_keys(col->cgroup_stat_fd, col->vmstat_buf, sizeof(col->vmstat_buf), stat_keys,
+                                  KEY_COUNT(stat_keys), &st, &found);
+         uint64_t current = 0, limit = col->facts.mem_total;
+         int ok = ret == 0 && memcg_value(col->cgroup_current_fd, &current) == 0;
+         for (unsigned i = 0; ok && i < col->cgroup_depth; i++) {
+             uint64_t max;
+             if (memcg_value(col->cgroup_max_fd[i], &max) == 0 && max < limit) {
+                 limit = max;
+             }
+         }
+         collect_call_end(col, COLLECT_CALL_VM, start);
+         if (!ok) {
+             return COLLECT_ERR_VM;
+         }
+         if (col->plan & SAMPLE_VM) {
+             /* Kernels before 5.18 have the parts of kernel but not the sum */
+             if ((found & STAT_FOUND_KERNEL) == 0) {
+                 st.kernel = st.kernel_stack + st.pagetables + st.percpu + st.sock + st.vmalloc +
+                             st.slab_reclaimable + st.slab_unreclaimable;
+             }
+             uint64_t free = limit > current ? limit - current : 0;
+             uint64_t cached = st.file + st.slab_reclaimable;
+
+             /* The stat figures lag memory.current a little; keep them within the limit */
+             if (cached > limit - free) {
+                 cached = limit - free;
+             }
+             c->mem_total = limit;
+             c->free_count = free;
+             c->external_page_count = cached;
+             c->internal_page_count = st.anon;
+             c->wire_count = (st.kernel > st.slab_reclaimable ? st.kernel - st.slab_reclaimable : 0) + st.unevictable;
+             c->compressor_page_count = st.zswap;
+             sample->valid |= SAMPLE_VM;
+         }
+         if (col->plan & SAMPLE_EVENTS) {
+             c->faults = st.pgfault;
+             c->swapins = st.pswpin;
+             c->swapouts = st.pswpout;
+             c->compressions = st.zswpout;
+             c->decompressions = st.zswpin;
+             c->event_bits = 64;
+             c->event_page_size = col->sys_page_size;
+             sample->valid |= SAMPLE_EVENTS;
+         }
+     }
+
+     if (col->plan & SAMPLE_SWAP) {
+         uint64_t start = collect_call_begin(col);
+         uint64_t used = 0, max = UINT64_MAX;
+         if (col->cgroup_swap_fd >= 0 && memcg_value(col->cgroup_swap_fd, &used) != 0) {
+             collect_call_end(col, COLLECT_CALL_SWAP, start);
+             return COLLECT_ERR_SWAP;
+         }
+         if (col->cgroup_swap_max_fd >= 0) {
+             memcg_value(col->cgroup_swap_max_fd, &max);
+         }
+         collect_call_end(col, COLLECT_CALL_SWAP, start);
+
+         /* No commit accounting in a cgroup: -v falls back to the swap figures */
+         c->swap_total = max < col->swap_host ? max : col->swap_host;
+         c->swap_used = used;
+         c->swap_avail = c->swap_total > used ? c->swap_total - used : 0;
+         sample->valid |= SAMPLE_SWAP;
+     }
+     return COLLECT_OK;
+ }
+
+ static int memcg_close(struct collector *col) {
+     int ret = 0;
+     int *fds[] = {&col->cgroup_current_fd, &col->cgroup_stat_fd, &col->cgroup_swap_fd, &col->cgroup_swap_max_fd};
+
+     for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+         if (*fds[i] >= 0) {
+             ret |= close(*fds[i]);
+             *fds[i] = -1;
+         }
+     }
+     for (unsigned i = 0; i < col->cgroup_depth; i++) {
+         ret |= close(col->cgroup_max_fd[i]);
+     }
+     col->cgroup_depth = 0;
+     return ret;
+ }
+
+ static const char *memcg_call_name(int call) {
+     switch (call) {
+         case COLLECT_CALL_VM: return "pread(memory.stat, memory.current, memory.max)";
+         case COLLECT_CALL_SWAP: return "pread(memory.swap.current, memory.swap.max)";
+         default: return "?";
+     }
+ }
+
+ const struct collector_ops collector_cgroup_ops = {
+     "cgroup",
+     memcg_open,
+     memcg_sample,
+     memcg_close,
+     memcg_call_name
+ };
@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /*
+  * Linux collection backend: /proc/meminfo and, for event counters,
+  * /proc/vmstat, kept open and re-read with pread() into the collector's
+  * fixed buffers. Page counts are reported in 1 KiB units, the unit of
+  * /proc/meminfo. Only POSIX is used, so the backend also serves fixture
+  * trees on any platform.
+  */
+
+ #include "collect.h"
+
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <limits.h>
+ #include <stddef.h>
+ #include <stdio.h>
+ #include <string.h>
+ #include <unistd.h>
+
+ #define MEMINFO_PATH "/proc/meminfo"
+ #define VMSTAT_PATH "/proc/vmstat"
+ #define MEMINFO_UNIT 1024ULL
+
+ /* The /proc/meminfo fields we use, in kB */
+ struct meminfo {
+     uint64_t mem_total;
+     uint64_t mem_free;
+     uint64_t mem_available;         /* Since Linux 3.14 */
+     uint64_t buffers;
+     uint64_t cached;
+     uint64_t anon_pages;
+     uint64_t unevictable;
+     uint64_t sreclaimable;
+     uint64_t sunreclaim;
+     uint64_t kernel_stack;
+     uint64_t page_tables;
+     uint64_t swap_total;
+     uint64_t swap_free;
+     uint64_t commit_limit;
+     uint64_t committed_as;
+     unsigned long found;            /* proc_parse() mask of the keys present */
+ };
+
+ /* The /proc/vmstat counters we use, cumulative since boot */
+ struct vmstat {
+     uint64_t pgpgin;                /* kB read from block devices */
+     uint64_t pgpgout;
+     uint64_t pgfault;
+     uint64_t pswpin;                /* Pages */
+     uint64_t pswpout;
+     uint64_t zswpin;                /* Pages, 0 without zswap */
+     uint64_t zswpout;
+ };
+
+ #define MEMINFO_KEY(name, field) { name, sizeof(name) - 1, offsetof(struct meminfo, field) }
+ #define VMSTAT_KEY(name) { #name, sizeof(#name) - 1, offsetof(struct vmstat, name) }
+
+ static const struct proc_key meminfo_keys[] = {
+     MEMINFO_KEY("MemTotal", mem_total),
+     MEMINFO_KEY("MemFree", mem_free),
+     MEMINFO_KEY("MemAvailable", mem_available),
+     MEMINFO_KEY("Buffers", buffers),
+     MEMINFO_KEY("Cached", cached),
+     MEMINFO_KEY("SwapTotal", swap_total),
+     MEMINFO_KEY("SwapFree", swap_free),
+     MEMINFO_KEY("AnonPages", anon_pages),
+     MEMINFO_KEY("Unevictable", unevictable),
+     MEMINFO_KEY("SReclaimable", sreclaimable),
+     MEMINFO_KEY("SUnreclaim", sunreclaim),
+     MEMINFO_KEY("KernelStack", kernel_stack),
+     MEMINFO_KEY("PageTables", page_tables),
+     MEMINFO_KEY("CommitLimit", commit_limit),
+     MEMINFO_KEY("Committed_AS", committed_as)
+ };
+
+ #define MEMINFO_FOUND_AVAILABLE (1UL << 2)  /* Bit of "MemAvailable" in the proc_parse() mask */
+
+ static const struct proc_key vmstat_keys[] = {
+     VMSTAT_KEY(pgpgin),
+     VMSTAT_KEY(pgpgout),
+     VMSTAT_KEY(pswpin),
+     VMSTAT_KEY(pswpout),
+     VMSTAT_KEY(pgfault),
+     VMSTAT_KEY(zswpin),
+     VMSTAT_KEY(zswpout)
+ };
+
+ /**
+  * Parse "Key:   value kB" (meminfo) or "key value" (vmstat) lines in a
+  * single pass, without allocating, into the fields keys point at in out
+  * Unknown keys are skipped; parsing stops once every known key was seen
+  * Returns a bit mask of the keys found
+  */
+ unsigned long proc_parse(const char *buf, size_t len, const struct proc_key *keys, size_t nkeys, void *out) {
+     const char *p = buf, *end = buf + len;
+     unsigned long found = 0;
+     unsigned long all = (1UL << nkeys) - 1;
+
+     while (p < end && found != all) {
+         const char *key = p;
+         while (p < end && *p != ':' && *p != ' ' && *p != '\n') p++;
+         if (p == end) break;
+         if (*p == '\n') {
+             p++;
+             continue;
+         }
+         size_t key_len = (size_t)(p - key);
+
+         if (*p == ':') p++;
+         while (p < end && *p == ' ') p++;
+         uint64_t value = 0;
+         while (p < end && *p >= '0' && *p <= '9') {
+             value = value * 10 + (uint64_t)(*p - '0');
+             p++;
+         }
+         while (p < end && *p != '\n') p++;
+         p++;
+
+         for (size_t i = 0; i < nkeys; i++) {
+             const struct proc_key *k = &keys[i];
+             if (k->len == key_len && memcmp(k->name, key, key_len) == 0) {
+                 memcpy((char *)out + k->offset, &value, sizeof(value));
+                 found |= 1UL << i;
+                 break;
+             }
+         }
+     }
+     return found;
+ }
+
+ /**
+  * Re-read a whole proc file from offset 0 into buf
+  * Returns the number of bytes read, or -1 on error
+  */
+ ssize_t proc_read(int fd, char *buf, size_t size) {
+     size_t total = 0;
+
+     while (total < size - 1) {
+         ssize_t n = pread(fd, buf + total, size - 1 - total, (off_t)total);
+         if (n < 0) {
+             if (errno == EINTR) continue;
+             return -1;
+         }
+         if (n == 0) break;
+         total += (size_t)n;
+     }
+     buf[total] = '\0';
+     return (ssize_t)total;
+ }
+
+ /**
+  * Re-read a proc file from offset 0 and proc_parse() it one buffer at a
+  * time, carrying a partial last line over to the next read, so a file
+  * larger than buf loses no keys; stops once every key was seen
+  * Returns 0 with the mask of keys found in *found, or -1 on a read error
+  * or an empty file
+  */
+ int proc_read_keys(int fd, char *buf, size_t size, const struct proc_key *keys, size_t nkeys, void *out,
+                    unsigned long *found) {
+     unsigned long all = (1UL << nkeys) - 1;
+     size_t keep = 0;
+     off_t offset = 0;
+
+     *found = 0;
+     for (;;) {
+         ssize_t n = pread(fd, buf + keep, size - 1 - keep, offset);
+         if (n < 0) {
+             if (errno == EINTR) continue;
+             return -1;
+         }
+         if (n == 0 && offset == 0) {
+             return -1;
+         }
+         offset += n;
+         size_t len = keep + (size_t)n;
+         buf[len] = '\0';
+
+         /* Whole lines only until the end of the file; a line longer than buf holds none of our keys */
+         size_t end = len;
+         if (n > 0) {
+             while (end > 0 && buf[end - 1] != '\n') end--;
+             if (end == 0 && len == size - 1) end = len;
+         }
+         *found |= proc_parse(buf, end, keys, nkeys, out);
+         if (n == 0 || *found == all) {
+             return 0;
+         }
+         keep = len - end;
+         memmove(buf, buf + end, keep);
+     }
+ }
+
+ /**
+  * Read and parse one snapshot of /proc/meminfo, timed as COLLECT_CALL_VM
+  */
+ static int meminfo_snapshot(struct collector *col, struct meminfo *mi) {
+     memset(mi, 0, sizeof(*mi));
+
+     uint64_t start = collect_call_begin(col);
+     int ret = proc_read_keys(col->meminfo_fd, col->meminfo_buf, sizeof(col->meminfo_buf), meminfo_keys,
+                              KEY_COUNT(meminfo_keys), mi, &mi->found);
+     collect_call_end(col, COLLECT_CALL_VM, start);
+     return ret == 0 ? COLLECT_OK : COLLECT_ERR_VM;
+ }
+
+ /**
+  * Read and parse one snapshot of /proc/vmstat, timed as COLLECT_CALL_EVENTS
+  */
+ static int vmstat_snapshot(struct collector *col, struct vmstat *vs) {
+     unsigned long found;
+
+     memset(vs, 0, sizeof(*vs));
+
+     uint64_t start = collect_call_begin(col);
+     int ret = proc_read_keys(col->vmstat_fd, col->vmstat_buf, sizeof(col->vmstat_buf), vmstat_keys,
+                              KEY_COUNT(vmstat_keys), vs, &found);
+     collect_call_end(col, COLLECT_CALL_EVENTS, start);
+     return ret == 0 ? COLLECT_OK : COLLECT_ERR_VM;
+ }
+
+ /**
+  * Open a proc file, or its copy under the fixture root
+  * Returns the descriptor, or -1
+  */
+ static int proc_open(const struct collector *col, const char *name) {
+     char path[PATH_MAX];
+
+     int ret = snprintf(path, sizeof(path), "%s%s", col->fixture ? col->fixture : "", name);
+     if (ret < 0 || (size_t)ret >= sizeof(path)) {
+         return -1;
+     }
+     return open(path, O_RDONLY | O_CLOEXEC);
+ }
+
+ /**
+  * Open /proc/meminfo, and /proc/vmstat when the plan has event counters,
+  * and fetch the static host facts
+  */
+ static int meminfo_open(struct collector *col) {
+     struct meminfo mi;
+
+     col->meminfo_fd = proc_open(col, MEMINFO_PATH);
+     if (col->meminfo_fd < 0) {
+         return COLLECT_ERR_OPEN;
+     }
+     if (col->plan & SAMPLE_EVENTS) {
+         col->vmstat_fd = proc_open(col, VMSTAT_PATH);
+         if (col->vmstat_fd < 0) {
+             return COLLECT_ERR_OPEN;
+         }
+     }
+
+     /* pgpgin and pgpgout count kB, the other events count system pages */
+     long page = sysconf(_SC_PAGESIZE);
+     col->sys_page_size = page > 0 ? (uint64_t)page : 4096;
+
+     col->facts.page_size = MEMINFO_UNIT;
+     int status = meminfo_snapshot(col, &mi);
+     if (status != COLLECT_OK) {
+         return status;
+     }
+     if (mi.mem_total == 0) {
+         return COLLECT_ERR_HOSTINFO;
+     }
+     col->facts.mem_total = mi.mem_total * MEMINFO_UNIT;
+
+     return COLLECT_OK;
+ }
+
+ /**
+  * Map /proc/meminfo onto the vm_statistics64 vocabulary, so the derived
+  * values match Linux free: free is MemFree and cached is buff/cache
+  */
+ static int meminfo_sample(struct collector *col, struct mem_sample *sample) {
+     struct mem_counters *c = &sample->counters;
+     struct meminfo mi;
+
+     if (col->plan & SAMPLE_EVENTS) {
+         struct vmstat vs;
+         int status = vmstat_snapshot(col, &vs);
+         if (status != COLLECT_OK) {
+             return status;
+         }
+
+         c->pageins = vs.pgpgin;
+         c->pageouts = vs.pgpgout;
+         c->faults = vs.pgfault;
+         c->compressions = vs.zswpout;
+         c->decompressions = vs.zswpin;
+         c->swapins = vs.pswpin;
+         c->swapouts = vs.pswpout;
+         c->event_bits = sizeof(unsigned long) * CHAR_BIT;  /* The kernel's unsigned long */
+         c->event_page_size = col->sys_page_size;
+         sample->valid |= SAMPLE_EVENTS;
+     }
+
+     if ((col->plan & (SAMPLE_VM | SAMPLE_SWAP)) == 0) {
+         return COLLECT_OK;
+     }
+
+     int status = meminfo_snapshot(col, &mi);
+     if (status != COLLECT_OK) {
+         return status;
+     }
+
+     if (col->plan & SAMPLE_VM) {
+         c->free_count = mi.mem_free;
+         c->wire_count = mi.unevictable + mi.sunreclaim + mi.kernel_stack + mi.page_tables;
+         c->internal_page_count = mi.anon_pages;
+         c->external_page_count = mi.buffers + mi.cached + mi.sreclaimable;
+         c->available_count = mi.mem_available;
+         c->available_known = (mi.found & MEMINFO_FOUND_AVAILABLE) != 0;
+         sample->valid |= SAMPLE_VM;
+     }
+
+     if (col->plan & SAMPLE_SWAP) {
+         c->swap_total = mi.swap_total * MEMINFO_UNIT;
+         c->swap_avail = mi.swap_free * MEMINFO_UNIT;
+         c->swap_used = mi.swap_total > mi.swap_free ? (mi.swap_total - mi.swap_free) * MEMINFO_UNIT : 0;
+         c->commit_limit = mi.commit_limit * MEMINFO_UNIT;
+         c->committed = mi.committed_as * MEMINFO_UNIT;
+         sample->valid |= SAMPLE_SWAP;
+     }
+
+     return COLLECT_OK;
+ }
+
+ static int meminfo_close(struct collector *col) {
+     int ret = 0;
+
+     if (col->meminfo_fd >= 0) {
+         ret = close(col->meminfo_fd);
+         col->meminfo_fd = -1;
+     }
+     if (col->vmstat_fd >= 0) {
+         ret |= close(col->vmstat_fd);
+         col->vmstat_fd = -1;
+     }
+     return ret;
+ }
+
+ static const char *meminfo_call_name(int call) {
+     switch (call) {
+         case COLLECT_CALL_VM: return "pread(/proc/meminfo)";
+         case COLLECT_CALL_EVENTS: return "pread(/proc/vmstat)";
+         default: return "?";
+     }
+ }
+
+ const struct collector_ops collector_meminfo_ops = {
+     "meminfo",
+     meminfo_open,
+     meminfo_sample,
+     meminfo_close,
+     meminfo_call_name
+ };
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /*
+  * Mach collection backend: HOST_VM_INFO64 page counts and VM_SWAPUSAGE
+  */
+
+ #include "collect.h"
+
+ #include <string.h>
+ #include <sys/types.h>
+ #include <sys/sysctl.h>
+
+ /**
+  * Take the host port and fetch the static host facts
+  */
+ static int mach_open(struct collector *col) {
+     col->host_port = mach_host_self();
+     if (col->host_port == MACH_PORT_NULL) {
+         return COLLECT_ERR_HOST;
+     }
+
+     vm_size_t page_size;
+     if (host_page_size(col->host_port, &page_size) != KERN_SUCCESS) {
+         return COLLECT_ERR_PAGESIZE;
+     }
+     col->facts.page_size = page_size;
+
+     /* Total physical memory does not change, fetch it once */
+     host_basic_info_data_t hostInfo = {0};
+     mach_msg_type_number_t info_count = HOST_BASIC_INFO_COUNT;
+     if (host_info(col->host_port, HOST_BASIC_INFO, (host_info_t)&hostInfo, &info_count) != KERN_SUCCESS) {
+         return COLLECT_ERR_HOSTINFO;
+     }
+     col->facts.mem_total = hostInfo.max_mem;
+
+     /* The pageout daemon keeps this many pages free; without the sysctl assume 1% */
+     unsigned int free_target = 0;
+     size_t free_target_size = sizeof(free_target);
+     if (sysctlbyname("vm.page_free_target", &free_target, &free_target_size, NULL, 0) == 0 && free_target > 0) {
+         col->reserve_pages = free_target;
+     } else {
+         col->reserve_pages = col->facts.mem_total / col->facts.page_size / 100;
+     }
+
+     return COLLECT_OK;
+ }
+
+ static int mach_sample(struct collector *col, struct mem_sample *sample) {
+     struct mem_counters *c = &sample->counters;
+     int status = COLLECT_OK;
+
+     /* Page counts and event counters come from the same call */
+     if (col->plan & (SAMPLE_VM | SAMPLE_EVENTS)) {
+         vm_statistics64_data_t vm_stat = {0};
+         mach_msg_type_number_t host_size = sizeof(vm_statistics64_data_t) / sizeof(integer_t);
+
+         uint64_t start = collect_call_begin(col);
+         kern_return_t kr = host_statistics64(col->host_port, HOST_VM_INFO64, (host_info_t)&vm_stat, &host_size);
+         collect_call_end(col, COLLECT_CALL_VM, start);
+         if (kr != KERN_SUCCESS) {
+             return COLLECT_ERR_VM;
+         }
+
+         c->free_count = vm_stat.free_count;
+         c->speculative_count = vm_stat.speculative_count;
+         c->wire_count = vm_stat.wire_count;
+         c->internal_page_count = vm_stat.internal_page_count;
+         c->purgeable_count = vm_stat.purgeable_count;
+         c->external_page_count = vm_stat.external_page_count;
+         c->compressor_page_count = vm_stat.compressor_page_count;
+         c->reserve_count = col->reserve_pages;
+
+         /* 64-bit counters in vm_statistics64, unlike the natural_t ones of vm_statistics */
+         c->pageins = vm_stat.pageins;
+         c->pageouts = vm_stat.pageouts;
+         c->faults = vm_stat.faults;
+         c->cow_faults = vm_stat.cow_faults;
+         c->compressions = vm_stat.compressions;
+         c->decompressions = vm_stat.decompressions;
+         c->swapins = vm_stat.swapins;
+         c->swapouts = vm_stat.swapouts;
+         c->event_bits = 64;
+         c->event_page_size = col->facts.page_size;
+         sample->valid |= col->plan & (SAMPLE_VM | SAMPLE_EVENTS);
+     }
+
+     if (col->plan & SAMPLE_SWAP) {
+         struct xsw_usage swapinfo = {0};
+         size_t swapinfo_sz = sizeof(swapinfo);
+         int mib[2] = {CTL_VM, VM_SWAPUSAGE};
+
+         uint64_t start = collect_call_begin(col);
+         int ret = sysctl(mib, 2, &swapinfo, &swapinfo_sz, NULL, 0);
+         collect_call_end(col, COLLECT_CALL_SWAP, start);
+         if (ret != 0) {
+             status = COLLECT_ERR_SWAP;
+         } else {
+             c->swap_total = swapinfo.xsu_total;
+             c->swap_used = swapinfo.xsu_used;
+             c->swap_avail = swapinfo.xsu_avail;
+             sample->valid |= SAMPLE_SWAP;
+         }
+     }
+
+     return status;
+ }
+
+ /**
+  * Release the host port
+  */
+ static int mach_close(struct collector *col) {
+     int ret = 0;
+
+     if (col->host_port != MACH_PORT_NULL) {
+         if (mach_port_deallocate(mach_task_self(), col->host_port) != KERN_SUCCESS) {
+             ret = -1;
+         }
+         col->host_port = MACH_PORT_NULL;
+     }
+     return ret;
+ }
+
+ static const char *mach_call_name(int call) {
+     switch (call) {
+         case COLLECT_CALL_VM: return "host_statistics64(HOST_VM_INFO64)";
+         case COLLECT_CALL_SWAP: return "sysctl(VM_SWAPUSAGE)";
+         default: return "?";
+     }
+ }
+
+ const struct collector_ops collector_mach_ops = {
+     "mach",
+     mach_open,
+     mach_sample,
+     mach_close,
+     mach_call_name
+ };
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /*
+  * Snapshot ring backend: reads the latest sample a --daemon published
+  * instead of asking the kernel. After the mapping is set up a sample is a
+  * plain memory copy, so any number of readers add no load to the host.
+  */
+
+ #include "collect.h"
+
+ #include <string.h>
+
+ /* A snapshot older than this many daemon intervals is reported as stale */
+ #define SHM_STALE_INTERVALS 3
+
+ static int shm_latest(struct collector *col, struct mem_sample *snap) {
+     for (;;) {
+         uint64_t published = shm_published(&col->ring);
+         if (published == 0) {
+             return COLLECT_ERR_EMPTY;
+         }
+         /* Only gone if the daemon lapped the whole ring while we copied */
+         int status = shm_read(&col->ring, published - 1, snap);
+         if (status == SHM_OK) {
+             return COLLECT_OK;
+         }
+         if (status == SHM_ERR_TORN) {
+             return COLLECT_ERR_TORN;
+         }
+     }
+ }
+
+ static int shm_backend_open(struct collector *col) {
+     struct mem_sample snap;
+
+     if (shm_attach(&col->ring, col->ring_path) != SHM_OK) {
+         return COLLECT_ERR_RING;
+     }
+
+     int status = shm_latest(col, &snap);
+     if (status != COLLECT_OK) {
+         return status;
+     }
+     col->facts.page_size = snap.counters.page_size;
+     col->facts.mem_total = snap.counters.mem_total;
+     return COLLECT_OK;
+ }
+
+ /**
+  * Copy the latest snapshot with the daemon's timestamps, so rates cover
+  * the interval between the snapshots themselves
+  * Returns COLLECT_ERR_STALE, with the sample filled in, when the daemon
+  * has stopped publishing
+  */
+ static int shm_backend_sample(struct collector *col, struct mem_sample *sample) {
+     struct mem_sample snap;
+
+     uint64_t start = collect_call_begin(col);
+     int status = shm_latest(col, &snap);
+     collect_call_end(col, COLLECT_CALL_VM, start);
+     if (status != COLLECT_OK) {
+         return status;
+     }
+
+     *sample = snap;
+
+     /* CLOCK_MONOTONIC is shared by every process on the host */
+     uint64_t interval = col->ring.header->interval_ns;
+     if (sched_now_ns() - snap.tick.actual_ns > SHM_STALE_INTERVALS * interval + NSEC_PER_SEC) {
+         return COLLECT_ERR_STALE;
+     }
+     return COLLECT_OK;
+ }
+
+ static int shm_backend_close(struct collector *col) {
+     shm_close(&col->ring);
+     return 0;
+ }
+
+ static const char *shm_call_name(int call) {
+     return call == COLLECT_CALL_VM ? "snapshot ring read" : "?";
+ }
+
+ const struct collector_ops collector_shm_ops = {
+     "snapshot ring",
+     shm_backend_open,
+     shm_backend_sample,
+     shm_backend_close,
+     shm_call_name
+ };
@@ -25,24 +25,103 @@
  #include <unistd.h>
  #include <string.h>
  #include <getopt.h>
- #include <mach/mach.h>
- #include <sys/types.h>
- #include <sys/sysctl.h>
  #include <signal.h>
  #include <errno.h>
  #include <limits.h>
  #include <stdarg.h>
+ #include <pthread.h>
+ 
+ #include "adapt.h"
+ #include "cgroup.h"
+ #include "collect.h"
+ #include "freemem.h"
+ #include "live.h"
+ #include "maps.h"
+ #include "merge.h"
+ #include "numa.h"
+ #include "pressure.h"
+ #include "procs.h"
+ #include "profile.h"
+ #include "queue.h"
+ #include "record.h"
+ #include "render.h"
+ #include "sample.h"
+ #include "sched.h"
+ #include "serve.h"
+ #include "shm.h"
+ #include "stats.h"
+ #include "trend.h"
  
  /* Constants */
- #define PROGRAM_VERSION "0.3"
- #define MEMORY_STRING_BUFFER_SIZE 32
+ #define PROGRAM_VERSION FREEMEM_VERSION
  #define MAX_COUNT_VALUE 1000
  #define MAX_DELAY_VALUE 3600.0  /* Maximum delay of 1 hour */
- #define MIN_DELAY_VALUE 0.1     /* Minimum delay of 0.1 seconds */
+ #define MIN_DELAY_VALUE 0.01    /* Minimum delay of 0.01 seconds (100 Hz) */
  #define MAX_EXPECTED_MEMORY (1ULL * 1024 * 1024 * 1024 * 1024) /* 1 TiB limit */
  
  /* Global variables */
- mach_port_t g_host_port = MACH_PORT_NULL;
+ struct collector g_collector;
+ struct freemem *g_freemem = NULL; /* libfreemem context of the plain table, instead of the collector */
+ volatile sig_atomic_t g_stop_signal = 0;
+ volatile sig_atomic_t g_dump_stats = 0;
+ volatile sig_atomic_t g_resized = 0;
+ struct proc_scan *g_top = NULL;   /* --top scanner, while its workers run */
+ struct numa *g_numa = NULL;       /* -l node files, while open */
+ struct cgroup_scan *g_cgroups = NULL; /* --cgroup-top scanner, while its workers run */
+ struct profile *g_profile = NULL; /* --self-profile histograms, NULL when off */
+ struct live *g_live = NULL;       /* --live screen, until the cursor is restored */
+ struct sample_queue *g_queue = NULL; /* Output queue, while its writer thread runs */
+ 
+ /* Long-only options without a short equivalent */
+ enum {
+     OPT_MISSED = 256,
+     OPT_JITTER,
+     OPT_FIXTURE,
+     OPT_RECORD,
+     OPT_REPLAY,
+     OPT_SPEED,
+     OPT_FROM,
+     OPT_DAEMON,
+     OPT_ATTACH,
+     OPT_HISTORY,
+     OPT_STATS,
+     OPT_RATES,
+     OPT_SERVE,
+     OPT_QUEUE,
+     OPT_OVERFLOW,
+     OPT_ADAPTIVE,
+     OPT_JSON,
+     OPT_CSV,
+     OPT_WATCH_PRESSURE,
+     OPT_HOOK,
+     OPT_TOP,
+     OPT_SELF_PROFILE,
+     OPT_LIVE,
+     OPT_MERGE,
+     OPT_TREND,
+     OPT_PID,
+     OPT_MAPS,
+     OPT_CGROUP,
+     OPT_CGROUP_TOP
+ };
+ 
+ /* Where samples go when they are shown: frames, --stats or --rates */
+ struct output {
+     const struct render_opts *ropts;
+     struct stats *stats;            /* --stats, NULL otherwise */
+     int rates;                      /* --rates */
+     int interval;                   /* Tag frames with the sampling interval */
+     struct mem_sample prev;         /* Baseline of the next rates frame */
+     int have_prev;
+     struct proc_scan *top;          /* --top, NULL otherwise */
+     struct numa *numa;              /* -l, NULL otherwise */
+     struct cgroup_scan *cgroups;    /* --cgroup-top, NULL otherwise */
+     struct live *live;              /* --live, NULL otherwise */
+     struct trend *trend;            /* --trend, NULL otherwise */
+     const char *hook;               /* --hook, run on --trend events */
+     struct freemem_format fmt;      /* The ropts of a libfreemem snapshot */
+     unsigned layout;                /* FREEMEM_LAYOUT_* */
+ };
  
  /* Log levels for error reporting */
  typedef enum {
@@ -63,22 +142,68 @@
  void cleanup(void);
  void signal_handler(int signum);
  void log_message(LogLevel level, const char *format, ...);
- int formatBytes(unsigned long long bytes, char *buffer, int bufferSize, int human, int si, int unit);
  void print_usage(const char *program_name);
  void print_version(void);
+ int derive_sample(const struct mem_sample *sample, struct mem_values *mv);
+ int print_sample(const struct mem_sample *sample, const struct render_opts *ropts, struct outbuf *frame, int batch);
+ int print_stats(const struct stats *st, const struct render_opts *ropts);
+ int print_rates(struct output *out, const struct mem_sample *sample, struct outbuf *frame, int batch);
+ int print_top(struct proc_scan *top, const struct render_opts *ropts, struct outbuf *frame);
+ int print_numa(struct numa *numa, const struct render_opts *ropts, struct outbuf *frame);
+ int print_cgroups(struct cgroup_scan *cgroups, const struct render_opts *ropts, struct outbuf *frame);
+ int print_live(struct output *out, const struct mem_sample *sample, struct outbuf *frame);
+ int print_trend(struct output *out, const struct mem_sample *sample, struct outbuf *frame, int batch);
+ int redraw_live(struct live *live);
+ void finish_live(void);
+ int emit_sample(struct output *out, const struct mem_sample *sample, struct outbuf *frame, int batch);
+ int write_queued(const void *sample, void *ctx);
+ int print_snapshot(const struct output *out, const struct freemem_snapshot *snap, struct outbuf *frame);
+ int write_snapshot(const void *snap, void *ctx);
+ int replay_recording(const char *path, double speed, double from, int count, struct output *out);
+ int print_history(const char *path, int history, const struct render_opts *ropts);
+ int print_merge(const char *const *paths, size_t n, double interval, int count, const struct render_opts *ropts);
+ int print_maps(int pid, int detail, double interval, int count, const struct render_opts *ropts, const char *fixture);
+ int watch_pressure(double threshold, const char *hook, double fallback, int count, struct output *out,
+                    const char *fixture);
  
  /**
   * Cleanup function to release all resources
   * Called before exit or on error conditions
   */
  void cleanup(void) {
-     /* Deallocate Mach port if it's valid */
-     if (g_host_port != MACH_PORT_NULL) {
-         kern_return_t kr = mach_port_deallocate(mach_task_self(), g_host_port);
-         if (kr != KERN_SUCCESS) {
-             log_message(WARNING, "Warning: Failed to deallocate host port, code %d\n", kr);
-         }
-         g_host_port = MACH_PORT_NULL;
+     /* Print what is queued and join the writer first, it uses everything below.
+        A fatal error in the writer itself cannot wait for its own thread */
+     if (g_queue != NULL && !pthread_equal(pthread_self(), g_queue->thread)) {
+         queue_finish(g_queue);
+         g_queue = NULL;
+     }
+     
+     /* Release the collector and its host port or open files */
+     if (collect_close(&g_collector) != 0) {
+         log_message(WARNING, "Warning: Failed to release the memory information source\n");
+     }
+     freemem_close(g_freemem);
+     g_freemem = NULL;
+     
+     /* Give the terminal its cursor back */
+     finish_live();
+     
+     /* Close the -l node files */
+     if (g_numa != NULL) {
+         numa_close(g_numa);
+         g_numa = NULL;
+     }
+     
+     /* Stop the --top workers */
+     if (g_top != NULL) {
+         procs_close(g_top);
+         g_top = NULL;
+     }
+     
+     /* And the --cgroup-top ones */
+     if (g_cgroups != NULL) {
+         cgroup_close(g_cgroups);
+         g_cgroups = NULL;
      }
 
      
@@ -86,12 +211,20 @@
  
  /**
   * Signal handler for graceful termination
-  * Catches signals like SIGINT and SIGTERM
+  * Catches signals like SIGINT and SIGTERM and asks the sampling loop to stop;
+  * main() cleans up and exits with the signal number. SIGUSR1 asks --stats
+  * for a summary instead
   */
  void signal_handler(int signum) {
-     log_message(INFO, "\nReceived signal %d, cleaning up...\n", signum);
-     cleanup();
-     exit(signum);
+     if (signum == SIGUSR1) {
+         g_dump_stats = 1;
+         return;
+     }
+     if (signum == SIGWINCH) {
+         g_resized = 1;
+         return;
+     }
+     g_stop_signal = signum;
  }
  
  /**
@@ -131,68 +264,6 @@
      }
  }
  
- /**
-  * Formats byte values into human-readable strings with appropriate units
-  * Returns 0 on success, -1 on error
-  */
- int formatBytes(unsigned long long bytes, char *buffer, int bufferSize, int human, int si, int unit) {
-     if (buffer == NULL || bufferSize <= 0) {
-         return -1;
-     }
-     
-     /* Define unit suffixes */
-     const char *suffixesHuman[] = {"B", "Ki", "Mi", "Gi", "Ti", "Pi"};
-     const char *suffixes[] = {"B", "KB", "MB", "GB", "TB", "PB"};
-     
-     /* Validate unit parameter */
-     if (unit < 0 || unit > 5) {
-         unit = 0; /* Default to bytes on invalid input */
-     }
-     
-     int suffixIndex = 0;
-     double result = (double)bytes;
-     
-     /* Calculate value based on unit parameters */
-     if (human) {
-         /* Guard against division by zero */
-         unsigned long divisor = si ? 1000 : 1024;
-         
-         while (result > divisor && suffixIndex < 5) {
-             result /= divisor;
-             suffixIndex++;
-         }
-         
-         /* Format and check for truncation */
-         int ret = snprintf(buffer, bufferSize, "%.2f %s", result, suffixesHuman[suffixIndex]);
-         if (ret < 0 || ret >= bufferSize) {
-             /* Handle truncation safely */
-             strncpy(buffer, "ERROR", bufferSize - 1);
-             buffer[bufferSize - 1] = '\0';
-             return -1;
-         }
-     } else {
-         /* Apply unit conversion */
-         unsigned long divisor = si ? 1000 : 1024;
-         
-         /* Apply unit conversion up to specified unit */
-         for (int i = 0; i < unit && suffixIndex < 5; i++) {
-             result /= divisor;
-             suffixIndex++;
-         }
-         
-         /* Format and check for truncation */
-         int ret = snprintf(buffer, bufferSize, "%.2f %s", result, suffixes[suffixIndex]);
-         if (ret < 0 || ret >= bufferSize) {
-             /* Handle truncation safely */
-             strncpy(buffer, "ERROR", bufferSize - 1);
-             buffer[bufferSize - 1] = '\0';
-             return -1;
-         }
-     }
-     
-     return 0;
- }
- 
  /**
   * Print program usage information
   */
@@ -213,9 +284,38 @@
      printf("  -h, --human         Show output in human-readable format.\n");
      printf("  -w, --wide          Switch to the wide mode.\n");
      printf("  -c, --count count   Display the result count times. Requires the -s option.\n");
-     printf("  -l, --lohi          Show detailed low and high memory statistics.\n");
+     printf("  -l, --lohi          Show per-NUMA-node memory and zone watermarks.\n");
      printf("  -L, --line          Show output on a single line.\n");
+     printf("  --live              Redraw the table in place, sending only the values that changed.\n");
+     printf("  --json              Print each sample as a JSON object on its own line, in bytes.\n");
+     printf("  --csv               Print a header, then each sample as a CSV record, in bytes.\n");
      printf("  -s, --seconds delay Continuously display the result delay seconds apart.\n");
+     printf("  --adaptive min:max  Sample between min and max seconds apart, faster while memory changes.\n");
+     printf("  --missed policy     What to do with missed -s deadlines: skip (default) or catchup.\n");
+     printf("  --jitter            Report sampling jitter statistics at exit.\n");
+     printf("  --self-profile      Report the time spent in each stage of the loop, CPU time and RSS at exit.\n");
+     printf("  --queue n           Buffer up to n samples for the output thread, 0 prints inline.\n");
+     printf("  --overflow policy   What to do when the output queue is full: block (default) or drop.\n");
+     printf("  --fixture dir       Read proc files under dir instead of the live system.\n");
+     printf("  --record file       Append raw samples to a binary recording instead of printing.\n");
+     printf("  --replay file       Print the samples of a recording in the selected format.\n");
+     printf("  --speed factor      Replay speed, 1 is real time, 0 as fast as possible.\n");
+     printf("  --from seconds      Start the replay this far into the recording.\n");
+     printf("  --merge file...     Print fleet aggregates of many recordings, one per -s interval.\n");
+     printf("  --daemon file       Publish samples into a shared snapshot ring instead of printing.\n");
+     printf("  --attach file       Read samples from the snapshot ring of a running daemon.\n");
+     printf("  --history n         With --attach, print the last n snapshots and exit.\n");
+     printf("  --rates             Display paging, fault and compressor events per second.\n");
+     printf("  --serve addr:port   Serve the latest sample as Prometheus metrics over HTTP.\n");
+     printf("  --watch-pressure[=pct] Print a snapshot whenever memory pressure changes level.\n");
+     printf("  --trend min[:pct]   Alert when memory would run out within min minutes or jumps by pct%%.\n");
+     printf("  --hook command      Run command on every --watch-pressure level change or --trend alert.\n");
+     printf("  --top n             List the n processes using the most resident memory below each frame.\n");
+     printf("  --pid pid           Print the resident, dirty and swapped memory of one process.\n");
+     printf("  --maps              With --pid, break it down by mapping category and backing file.\n");
+     printf("  --cgroup path       Show the memory of a cgroup v2 group against its limit instead of the host.\n");
+     printf("  --cgroup-top n      With --cgroup, list the n child cgroups using the most memory below each frame.\n");
+     printf("  --stats             Print min/mean/max/stddev and percentiles at exit or on SIGUSR1.\n");
      printf("  --si                Use power of 1000 instead of 1024.\n");
      printf("  -t, --total         Display a line showing the column totals.\n");
      printf("  -v, --committed     Display memory commit information.\n");
@@ -232,369 +332,1689 @@
  }
  
  /**
-  * Main program function
+  * Calculate the memory components of a sample with overflow checking
+  * Returns EXIT_SUCCESS, or EXIT_FAILURE after logging the error
   */
- int main(int argc, char *argv[]) {
-     /* Register signal handlers for graceful termination */
-     signal(SIGINT, signal_handler);
-     signal(SIGTERM, signal_handler);
-     
-     /* Default parameters */
-     int human = 0;
-     int si = 0;
-     int unit = 1;  /* Default unit is kibibytes (KiB) */
-     int wide = 0;
-     int count = 1;
-     int lohi = 0;
-     int line = 0;
-     float delay = 1.0;
-     int total = 0;
-     int committed = 0;
-     int debug = 0;
- 
-     /* Command-line options */
-     static struct option long_options[] = {
-         {"bytes", no_argument, 0, 'b'},
-         {"kibi", no_argument, 0, 'k'},
-         {"mebi", no_argument, 0, 'm'},
-         {"gibi", no_argument, 0, 'g'},
-         {"tebi", no_argument, 0, 'e'},
-         {"pebi", no_argument, 0, 'p'},
-         {"kilo", no_argument, 0, 'K'},
-         {"mega", no_argument, 0, 'M'},
-         {"giga", no_argument, 0, 'G'},
-         {"tera", no_argument, 0, 'T'},
-         {"peta", no_argument, 0, 'P'},
-         {"human", no_argument, 0, 'h'},
-         {"wide", no_argument, 0, 'w'},
-         {"count", required_argument, 0, 'c'},
-         {"lohi", no_argument, 0, 'l'},
-         {"line", no_argument, 0, 'L'},
-         {"seconds", required_argument, 0, 's'},
-         {"si", no_argument, 0, 'S'},
-         {"total", no_argument, 0, 't'},
-         {"committed", no_argument, 0, 'v'},
-         {"debug", no_argument, 0, 'd'},
-         {"help", no_argument, 0, '?'},
-         {"version", no_argument, 0, 'V'},
-         {0, 0, 0, 0}
-     };
+ int derive_sample(const struct mem_sample *sample, struct mem_values *mv) {
+     switch (sample_derive(&sample->counters, mv)) {
+         case DERIVE_OK:
+             return EXIT_SUCCESS;
+         case DERIVE_ERR_COUNTS:
+             log_message(ERROR, "invalid memory counts\n");
+             return EXIT_FAILURE;
+         case DERIVE_ERR_OVERFLOW:
+             log_message(FATAL, "integer overflow in memory calculation\n");
+             return EXIT_FAILURE;
+         default:
+             log_message(ERROR, "memory calculation error\n");
+             return EXIT_FAILURE;
+     }
+ }
  
-     /* Parse command-line options exactly like Linux free command */
-     int opt;
-     int option_index = 0;
-     opterr = 0; /* Suppress default getopt error messages for Linux-like behavior */
-     while ((opt = getopt_long(argc, argv, "bkmgepKMGTPhwc:lLs:StvdV?", long_options, &option_index)) != -1) {
-         switch (opt) {
-             /* Unit options */
-             case 'b': unit = 0; break;
-             case 'k': unit = 1; break;
-             case 'm': unit = 2; break;
-             case 'g': unit = 3; break;
-             case 'e': unit = 4; break;
-             case 'p': unit = 5; break;
-             
-             /* SI unit options */
-             case 'K': si = 1; unit = 1; break;
-             case 'M': si = 1; unit = 2; break;
-             case 'G': si = 1; unit = 3; break;
-             case 'T': si = 1; unit = 4; break;
-             case 'P': si = 1; unit = 5; break;
-             
-             /* Display options */
-             case 'h': human = 1; break;
-             case 'w': wide = 1; break;
-             case 'l': lohi = 1; break;
-             case 'L': line = 1; break;
-             case 'S': si = 1; break;
-             case 't': total = 1; break;
-             case 'v': committed = 1; break;
-             case 'd': 
-                 debug = 1; 
-                 current_log_level = DEBUG;
-                 break;
-             
-             /* Count parameter with validation */
-             case 'c': 
-                 {
-                     char *endptr;
-                     long value = strtol(optarg, &endptr, 10);
-                     
-                     /* Validate conversion and range */
-                     if (*endptr != '\0' || value <= 0 || value > MAX_COUNT_VALUE) {
-                         log_message(ERROR, "invalid count value\n");
-                         CLEANUP_AND_EXIT(EXIT_FAILURE);
-                     }
-                     count = (int)value;
-                 }
-                 break;
-             
-             /* Delay parameter with validation */
-             case 's': 
-                 {
-                     char *endptr;
-                     float value = strtof(optarg, &endptr);
-                     
-                     /* Validate conversion and range */
-                     if (*endptr != '\0' || value < MIN_DELAY_VALUE || value > MAX_DELAY_VALUE) {
-                         log_message(ERROR, "invalid seconds value\n");
-                         CLEANUP_AND_EXIT(EXIT_FAILURE);
-                     }
-                     delay = value;
-                 }
-                 break;
-             
-             /* Help and version options */
-             case '?': 
-                 print_usage(argv[0]);
-                 return EXIT_SUCCESS;
-             
-             case 'V':
-                 print_version();
-                 return EXIT_SUCCESS;
-             
-             default:
-                 log_message(ERROR, "Unknown option: %c\n", opt);
-                 print_usage(argv[0]);
-                 CLEANUP_AND_EXIT(EXIT_FAILURE);
-         }
+ /**
+  * Derive, render and write one sample in the selected output format
+  * With batch set, frames accumulate in the buffer and are written once it
+  * is half full; the caller writes what is left
+  * Returns EXIT_SUCCESS, or EXIT_FAILURE after logging the error
+  */
+ int print_sample(const struct mem_sample *sample, const struct render_opts *ropts, struct outbuf *frame, int batch) {
+     uint64_t start_ns = g_profile ? sched_now_ns() : 0;
+     struct mem_values mv;
+     if (derive_sample(sample, &mv) != EXIT_SUCCESS) {
+         return EXIT_FAILURE;
      }
      
-     /* Validate -c requires -s */
-     if (count > 1 && optind < argc && strcmp(argv[optind-1], "-s") != 0 && 
-         !strstr(argv[optind-1], "--seconds")) {
-         log_message(ERROR, "option -c/--count requires -s/--seconds\n");
-         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     /* Assemble the frame in one buffer */
+     switch (render_sample(frame, ropts, sample, &mv)) {
+         case RENDER_OK:
+             break;
+         case RENDER_ERR_TOTAL:
+             log_message(ERROR, "integer overflow in total calculation\n");
+             break;
+         default:
+             log_message(ERROR, "cannot format memory values\n");
+             return EXIT_FAILURE;
      }
      
-     /* Check for privilege escalation (only show with debug flag) */
-     if (getuid() == 0 && debug) {
-         log_message(DEBUG, "Running with root privileges\n");
+     /* Debug output */
+     log_message(DEBUG, "Memory values formatted successfully\n");
+     if (g_profile) {
+         uint64_t now_ns = sched_now_ns();
+         profile_add(g_profile, PROFILE_RENDER, start_ns, now_ns);
+         start_ns = now_ns;
      }
      
-     /* Initialize Mach port */
-     g_host_port = mach_host_self();
-     if (g_host_port == MACH_PORT_NULL) {
-         log_message(FATAL, "cannot get host information\n");
-         /* FATAL log level automatically exits */
+     if (batch && frame->len < sizeof(frame->data) / 2) {
+         return EXIT_SUCCESS;
      }
      
-     /* Get page size */
-     vm_size_t page_size;
-     kern_return_t kr = host_page_size(g_host_port, &page_size);
-     if (kr != KERN_SUCCESS) {
-         log_message(FATAL, "cannot get memory page size\n");
+     /* Emit the frame with a single write(); flush stdio first so debug lines stay in order */
+     fflush(stdout);
+     if (outbuf_write(frame, STDOUT_FILENO) != 0) {
+         log_message(ERROR, "write error: %s\n", strerror(errno));
+         return EXIT_FAILURE;
+     }
+     if (g_profile) {
+         profile_add(g_profile, PROFILE_WRITE, start_ns, sched_now_ns());
      }
+     return EXIT_SUCCESS;
+ }
+ 
+ /**
+  * Render and write the --stats summary, clearing a pending SIGUSR1 request
+  * Returns EXIT_SUCCESS, or EXIT_FAILURE after logging the error
+  */
+ int print_stats(const struct stats *st, const struct render_opts *ropts) {
+     static struct outbuf summary;
      
-     log_message(DEBUG, "Page size: %lu bytes\n", (unsigned long)page_size);
+     g_dump_stats = 0;
+     if (stats_render(&summary, ropts, st) != RENDER_OK) {
+         outbuf_reset(&summary);
+         log_message(ERROR, "cannot format memory values\n");
+         return EXIT_FAILURE;
+     }
+     fflush(stdout);
+     if (outbuf_write(&summary, STDOUT_FILENO) != 0) {
+         log_message(ERROR, "write error: %s\n", strerror(errno));
+         return EXIT_FAILURE;
+     }
+     return EXIT_SUCCESS;
+ }
+ 
+ /**
+  * Print the event rates since the previous sample, which becomes the new
+  * baseline; the first sample only sets the baseline
+  * Returns EXIT_SUCCESS, or EXIT_FAILURE after logging the error
+  */
+ int print_rates(struct output *out, const struct mem_sample *sample, struct outbuf *frame, int batch) {
+     uint64_t start_ns = g_profile ? sched_now_ns() : 0;
+     struct mem_rates mr;
      
-     /* Main memory reporting loop */
-     for (int i = 0; i < count; i++) {
-         /* Fetch total physical memory */
-         host_basic_info_data_t hostInfo = {0};
-         mach_msg_type_number_t info_count = HOST_BASIC_INFO_COUNT;
-         kr = host_info(g_host_port, HOST_BASIC_INFO, (host_info_t)&hostInfo, &info_count);
-         if (kr != KERN_SUCCESS) {
-             log_message(FATAL, "cannot get memory information\n");
-         }
-         
-         /* Check if detected memory exceeds the practical limit */
-         if ((unsigned long long)hostInfo.max_mem > MAX_EXPECTED_MEMORY) {
-             log_message(WARNING, "Detected physical memory (%llu bytes) exceeds expected maximum (1TB)\n", 
-                        (unsigned long long)hostInfo.max_mem);
-         }
-         
-         log_message(DEBUG, "Total physical memory: %llu bytes\n", 
-                    (unsigned long long)hostInfo.max_mem);
-         
-         /* Fetch detailed memory statistics */
-         vm_statistics64_data_t vm_stat = {0};
-         mach_msg_type_number_t host_size = sizeof(vm_statistics64_data_t) / sizeof(integer_t);
-         kr = host_statistics64(g_host_port, HOST_VM_INFO64, (host_info_t)&vm_stat, &host_size);
-         if (kr != KERN_SUCCESS) {
-             log_message(FATAL, "cannot get vm statistics\n");
+     if (!(sample->valid & SAMPLE_EVENTS)) {
+         log_message(ERROR, "no event counters in sample\n");
+         return EXIT_FAILURE;
+     }
+     if (!out->have_prev) {
+         out->prev = *sample;
+         out->have_prev = 1;
+         return EXIT_SUCCESS;
+     }
+     if (sample_rates(&out->prev, sample, &mr) != DERIVE_OK) {
+         /* Same snapshot again, e.g. --attach polling faster than the daemon */
+         return EXIT_SUCCESS;
+     }
+     out->prev = *sample;
+     
+     if (render_rates(frame, out->ropts, &mr) != RENDER_OK) {
+         log_message(ERROR, "cannot format event rates\n");
+         return EXIT_FAILURE;
+     }
+     if (g_profile) {
+         uint64_t now_ns = sched_now_ns();
+         profile_add(g_profile, PROFILE_RENDER, start_ns, now_ns);
+         start_ns = now_ns;
+     }
+     if (batch && frame->len < sizeof(frame->data) / 2) {
+         return EXIT_SUCCESS;
+     }
+     fflush(stdout);
+     if (outbuf_write(frame, STDOUT_FILENO) != 0) {
+         log_message(ERROR, "write error: %s\n", strerror(errno));
+         return EXIT_FAILURE;
+     }
+     if (g_profile) {
+         profile_add(g_profile, PROFILE_WRITE, start_ns, sched_now_ns());
+     }
+     return EXIT_SUCCESS;
+ }
+ 
+ /**
+  * Scan the processes and print the largest below the frame already in the
+  * buffer, writing the frame and the list in as few pieces as fit
+  * Returns EXIT_SUCCESS, or EXIT_FAILURE after logging the error
+  */
+ int print_top(struct proc_scan *top, const struct render_opts *ropts, struct outbuf *frame) {
+     uint64_t start_ns = g_profile ? sched_now_ns() : 0;
+     int status = procs_scan(top);
+     if (g_profile) {
+         uint64_t now_ns = sched_now_ns();
+         profile_add(g_profile, PROFILE_TOP, start_ns, now_ns);
+         start_ns = now_ns;
+     }
+     if (status != PROCS_OK) {
+         outbuf_reset(frame);
+         log_message(ERROR, "%s\n", procs_strerror(status));
+         return EXIT_FAILURE;
+     }
+     log_message(DEBUG, "Scanned %zu processes\n", top->npids);
+     
+     size_t next = 0;
+     fflush(stdout);
+     do {
+         next = procs_render(frame, ropts, top->result, top->nresult, next);
+         if (outbuf_write(frame, STDOUT_FILENO) != 0) {
+             log_message(ERROR, "write error: %s\n", strerror(errno));
+             return EXIT_FAILURE;
          }
-         
-         /* Validate memory counts to prevent integer overflow */
-         if (vm_stat.free_count < vm_stat.speculative_count) {
-             log_message(ERROR, "invalid memory counts\n");
-             CLEANUP_AND_EXIT(EXIT_FAILURE);
+     } while (next < top->nresult);
+     if (g_profile) {
+         profile_add(g_profile, PROFILE_WRITE, start_ns, sched_now_ns());
+     }
+     return EXIT_SUCCESS;
+ }
+ 
+ /**
+  * Read the nodes and print their rows below the frame already in the
+  * buffer, writing the frame and the rows in as few pieces as fit
+  * Returns EXIT_SUCCESS, or EXIT_FAILURE after logging the error
+  */
+ int print_numa(struct numa *numa, const struct render_opts *ropts, struct outbuf *frame) {
+     int status = numa_read(numa);
+     if (status != NUMA_OK) {
+         outbuf_reset(frame);
+         log_message(ERROR, "%s\n", numa_strerror(status));
+         return EXIT_FAILURE;
+     }
+     
+     size_t next = 0, rows = numa_rows(numa);
+     fflush(stdout);
+     do {
+         next = numa_render(frame, ropts, numa, next);
+         if (outbuf_write(frame, STDOUT_FILENO) != 0) {
+             log_message(ERROR, "write error: %s\n", strerror(errno));
+             return EXIT_FAILURE;
          }
-         
-         /* Calculate memory components with overflow checking */
-         unsigned long long total_memory = hostInfo.max_mem;
-         
-         /* Check for potential integer overflow */
-         if ((unsigned long long)vm_stat.free_count > ULLONG_MAX / page_size ||
-             (unsigned long long)vm_stat.speculative_count > ULLONG_MAX / page_size ||
-             (unsigned long long)vm_stat.wire_count > ULLONG_MAX / page_size ||
-             (unsigned long long)vm_stat.internal_page_count > ULLONG_MAX / page_size ||
-             (unsigned long long)vm_stat.purgeable_count > ULLONG_MAX / page_size ||
-             (unsigned long long)vm_stat.external_page_count > ULLONG_MAX / page_size) {
-             log_message(FATAL, "integer overflow in memory calculation\n");
+     } while (next < rows);
+     return EXIT_SUCCESS;
+ }
+ 
+ /**
+  * Walk the cgroup tree and print the largest groups below the frame
+  * already in the buffer, writing the frame and the list in as few pieces
+  * as fit
+  * Returns EXIT_SUCCESS, or EXIT_FAILURE after logging the error
+  */
+ int print_cgroups(struct cgroup_scan *cgroups, const struct render_opts *ropts, struct outbuf *frame) {
+     int status = cgroup_scan(cgroups);
+     if (status != CGROUP_OK) {
+         outbuf_reset(frame);
+         log_message(ERROR, "%s\n", cgroup_strerror(status));
+         return EXIT_FAILURE;
+     }
+     log_message(DEBUG, "Scanned %zu cgroups\n", cgroups->nodes.count);
+     
+     size_t next = 0;
+     fflush(stdout);
+     do {
+         next = cgroup_render(frame, ropts, cgroups, next);
+         if (outbuf_write(frame, STDOUT_FILENO) != 0) {
+             log_message(ERROR, "write error: %s\n", strerror(errno));
+             return EXIT_FAILURE;
          }
-         
-         unsigned long long free_memory = (unsigned long long)(vm_stat.free_count - vm_stat.speculative_count) * page_size;
-         unsigned long long wired_memory = (unsigned long long)vm_stat.wire_count * page_size;
-         unsigned long long app_memory = (unsigned long long)(vm_stat.internal_page_count - vm_stat.purgeable_count) * page_size;
-         unsigned long long cached_memory = (unsigned long long)(vm_stat.purgeable_count + vm_stat.external_page_count) * page_size;
-         
-         /* Guard against overflow in subtraction */
-         if (total_memory < free_memory + cached_memory) {
-             log_message(ERROR, "memory calculation error\n");
-             CLEANUP_AND_EXIT(EXIT_FAILURE);
+     } while (next < cgroups->nresult);
+     return EXIT_SUCCESS;
+ }
+ 
+ /**
+  * Render the frame as usual, then send the terminal only what changed
+  * since the frame on screen; with --top, as many processes as fit
+  * Returns EXIT_SUCCESS, or EXIT_FAILURE after logging the error
+  */
+ int print_live(struct output *out, const struct mem_sample *sample, struct outbuf *frame) {
+     static struct outbuf screen;
+     struct mem_values mv;
+     
+     if (g_resized) {
+         g_resized = 0;
+         live_resize(out->live, STDOUT_FILENO);
+     }
+     if (derive_sample(sample, &mv) != EXIT_SUCCESS) {
+         outbuf_reset(frame);
+         return EXIT_FAILURE;
+     }
+     switch (render_sample(frame, out->ropts, sample, &mv)) {
+         case RENDER_OK:
+             break;
+         case RENDER_ERR_TOTAL:
+             log_message(ERROR, "integer overflow in total calculation\n");
+             break;
+         default:
+             outbuf_reset(frame);
+             log_message(ERROR, "cannot format memory values\n");
+             return EXIT_FAILURE;
+     }
+     if (out->numa != NULL) {
+         if (numa_read(out->numa) != NUMA_OK) {
+             outbuf_reset(frame);
+             log_message(ERROR, "%s\n", numa_strerror(NUMA_ERR_READ));
+             return EXIT_FAILURE;
          }
-         
-         unsigned long long used_memory = total_memory - free_memory - cached_memory;
-         
-         /* Get swap information safely */
-         struct xsw_usage swapinfo = {0};
-         size_t swapinfo_sz = sizeof(swapinfo);
-         int mib[2] = {CTL_VM, VM_SWAPUSAGE};
-         
-         if (sysctl(mib, 2, &swapinfo, &swapinfo_sz, NULL, 0) != 0) {
-             log_message(ERROR, "cannot get swap information\n");
-             /* Continue with zeroed swap info instead of exiting */
-             memset(&swapinfo, 0, sizeof(swapinfo));
+         numa_render(frame, out->ropts, out->numa, 0);
+     }
+     if (out->top != NULL) {
+         int status = procs_scan(out->top);
+         if (status != PROCS_OK) {
+             outbuf_reset(frame);
+             log_message(ERROR, "%s\n", procs_strerror(status));
+             return EXIT_FAILURE;
          }
-         
-         /* Get memory commit information */
-         int mib_commit[2] = {CTL_VM, VM_SWAPUSAGE};
-         struct xsw_usage commitinfo = {0};
-         size_t commitinfo_sz = sizeof(commitinfo);
-         
-         if (sysctl(mib_commit, 2, &commitinfo, &commitinfo_sz, NULL, 0) != 0) {
-             log_message(ERROR, "cannot get memory commit information\n");
-             /* Continue with zeroed commit info instead of exiting */
-             memset(&commitinfo, 0, sizeof(commitinfo));
+         procs_render(frame, out->ropts, out->top->result, out->top->nresult, 0);
+     }
+     if (out->cgroups != NULL) {
+         int status = cgroup_scan(out->cgroups);
+         if (status != CGROUP_OK) {
+             outbuf_reset(frame);
+             log_message(ERROR, "%s\n", cgroup_strerror(status));
+             return EXIT_FAILURE;
          }
-         
-         unsigned long long commit_limit = commitinfo.xsu_total;
-         unsigned long long committed_memory = commitinfo.xsu_used;
-         unsigned long long uncommitted_memory = commitinfo.xsu_avail;
-         
-         /* Formatting memory sizes with consistent buffer sizes */
-         char totalStr[MEMORY_STRING_BUFFER_SIZE], usedStr[MEMORY_STRING_BUFFER_SIZE], 
-              freeStr[MEMORY_STRING_BUFFER_SIZE], cachedStr[MEMORY_STRING_BUFFER_SIZE], 
-              appStr[MEMORY_STRING_BUFFER_SIZE], wiredStr[MEMORY_STRING_BUFFER_SIZE];
-         char swapTotalStr[MEMORY_STRING_BUFFER_SIZE], swapUsedStr[MEMORY_STRING_BUFFER_SIZE], 
-              swapFreeStr[MEMORY_STRING_BUFFER_SIZE];
-         char commitLimitStr[MEMORY_STRING_BUFFER_SIZE], committedStr[MEMORY_STRING_BUFFER_SIZE], 
-              uncommittedStr[MEMORY_STRING_BUFFER_SIZE];
-         
-         /* Format all memory values with error checking */
-         if (formatBytes(total_memory, totalStr, sizeof(totalStr), human, si, unit) < 0 ||
-             formatBytes(used_memory, usedStr, sizeof(usedStr), human, si, unit) < 0 ||
-             formatBytes(free_memory, freeStr, sizeof(freeStr), human, si, unit) < 0 ||
-             formatBytes(cached_memory, cachedStr, sizeof(cachedStr), human, si, unit) < 0 ||
-             formatBytes(app_memory, appStr, sizeof(appStr), human, si, unit) < 0 ||
-             formatBytes(wired_memory, wiredStr, sizeof(wiredStr), human, si, unit) < 0 ||
-             formatBytes(swapinfo.xsu_total, swapTotalStr, sizeof(swapTotalStr), human, si, unit) < 0 ||
-             formatBytes(swapinfo.xsu_used, swapUsedStr, sizeof(swapUsedStr), human, si, unit) < 0 ||
-             formatBytes(swapinfo.xsu_avail, swapFreeStr, sizeof(swapFreeStr), human, si, unit) < 0 ||
-             formatBytes(commit_limit, commitLimitStr, sizeof(commitLimitStr), human, si, unit) < 0 ||
-             formatBytes(committed_memory, committedStr, sizeof(committedStr), human, si, unit) < 0 ||
-             formatBytes(uncommitted_memory, uncommittedStr, sizeof(uncommittedStr), human, si, unit) < 0) {
-             log_message(ERROR, "cannot format memory values\n");
-             CLEANUP_AND_EXIT(EXIT_FAILURE);
+         cgroup_render(frame, out->ropts, out->cgroups, 0);
+     }
+     
+     int status = live_render(&screen, out->live, frame);
+     outbuf_reset(frame);
+     if (status != RENDER_OK) {
+         outbuf_reset(&screen);
+         log_message(ERROR, "frame does not fit the terminal buffer\n");
+         return EXIT_FAILURE;
+     }
+     if (outbuf_write(&screen, STDOUT_FILENO) != 0) {
+         log_message(ERROR, "write error: %s\n", strerror(errno));
+         return EXIT_FAILURE;
+     }
+     return EXIT_SUCCESS;
+ }
+ 
+ /**
+  * Draw the frame on screen again in full after the terminal was resized
+  * Returns EXIT_SUCCESS, or EXIT_FAILURE after logging the error
+  */
+ int redraw_live(struct live *live) {
+     static struct outbuf screen;
+     
+     g_resized = 0;
+     live_resize(live, STDOUT_FILENO);
+     if (live->prev_len == 0) {
+         return EXIT_SUCCESS;
+     }
+     if (live_redraw(&screen, live) != RENDER_OK) {
+         outbuf_reset(&screen);
+         log_message(ERROR, "frame does not fit the terminal buffer\n");
+         return EXIT_FAILURE;
+     }
+     if (outbuf_write(&screen, STDOUT_FILENO) != 0) {
+         log_message(ERROR, "write error: %s\n", strerror(errno));
+         return EXIT_FAILURE;
+     }
+     return EXIT_SUCCESS;
+ }
+ 
+ /**
+  * Move below the --live frame and show the cursor again, once
+  */
+ void finish_live(void) {
+     static struct outbuf screen;
+     
+     if (g_live == NULL) {
+         return;
+     }
+     live_finish(&screen, g_live);
+     g_live = NULL;
+     if (outbuf_write(&screen, STDOUT_FILENO) != 0) {
+         log_message(ERROR, "write error: %s\n", strerror(errno));
+     }
+ }
+ 
+ /**
+  * Feed a sample to the trend detector and print a line for each event it
+  * raises, running the hook for each
+  * Returns EXIT_SUCCESS, or EXIT_FAILURE after logging the error
+  */
+ int print_trend(struct output *out, const struct mem_sample *sample, struct outbuf *frame, int batch) {
+     struct trend_event events[TREND_MAX_EVENTS];
+     struct mem_values mv;
+     
+     if (derive_sample(sample, &mv) != EXIT_SUCCESS) {
+         return EXIT_FAILURE;
+     }
+     size_t n = trend_update(out->trend, sample, &mv, events);
+     for (size_t i = 0; i < n; i++) {
+         if (trend_render(frame, out->ropts, &events[i]) != RENDER_OK) {
+             outbuf_reset(frame);
+             log_message(ERROR, "cannot format memory values\n");
+             return EXIT_FAILURE;
+         }
+         if (out->hook != NULL && trend_hook(out->hook, &events[i]) != 0) {
+             log_message(ERROR, "cannot run hook: %s\n", strerror(errno));
+         }
+     }
+     if (n == 0 || (batch && frame->len < sizeof(frame->data) / 2)) {
+         return EXIT_SUCCESS;
+     }
+     fflush(stdout);
+     if (outbuf_write(frame, STDOUT_FILENO) != 0) {
+         log_message(ERROR, "write error: %s\n", strerror(errno));
+         return EXIT_FAILURE;
+     }
+     return EXIT_SUCCESS;
+ }
+ 
+ /**
+  * Show one sample in the selected output mode
+  * Returns EXIT_SUCCESS, or EXIT_FAILURE after logging the error
+  */
+ int emit_sample(struct output *out, const struct mem_sample *sample, struct outbuf *frame, int batch) {
+     if (out->stats != NULL) {
+         struct mem_values mv;
+         if (derive_sample(sample, &mv) != EXIT_SUCCESS) {
+             return EXIT_FAILURE;
+         }
+         stats_add(out->stats, &sample->tick, &mv);
+         return g_dump_stats ? print_stats(out->stats, out->ropts) : EXIT_SUCCESS;
+     }
+     /* The first --rates sample is only a baseline, nothing to tag */
+     if (out->interval && out->ropts->format == RENDER_FORMAT_TEXT && (!out->rates || out->have_prev)) {
+         render_interval(frame, out->ropts, sample->tick.interval_ns);
+     }
+     if (out->rates) {
+         return print_rates(out, sample, frame, batch);
+     }
+     if (out->live != NULL) {
+         return print_live(out, sample, frame);
+     }
+     int ret;
+     if (out->top != NULL || out->numa != NULL || out->cgroups != NULL) {
+         /* Node rows and the process and cgroup lists follow their frame, all written together */
+         ret = print_sample(sample, out->ropts, frame, 1);
+         if (ret == EXIT_SUCCESS && out->numa != NULL) {
+             ret = print_numa(out->numa, out->ropts, frame);
+         }
+         if (ret == EXIT_SUCCESS && out->top != NULL) {
+             ret = print_top(out->top, out->ropts, frame);
+         }
+         if (ret == EXIT_SUCCESS && out->cgroups != NULL) {
+             ret = print_cgroups(out->cgroups, out->ropts, frame);
+         }
+     } else {
+         ret = print_sample(sample, out->ropts, frame, batch);
+     }
+     if (ret == EXIT_SUCCESS && out->trend != NULL) {
+         ret = print_trend(out, sample, frame, batch);
+     }
+     return ret;
+ }
+ 
+ /**
+  * Print one sample on the output thread, which owns its frame buffer
+  */
+ int write_queued(const void *sample, void *ctx) {
+     static struct outbuf frame;
+     return emit_sample(ctx, sample, &frame, 0);
+ }
+
+ /**
+  * Format and write one libfreemem snapshot: the plain table, or its -w,
+  * -L, -t and -v variants
+  * Returns EXIT_SUCCESS, or EXIT_FAILURE after logging the error
+  */
+ int print_snapshot(const struct output *out, const struct freemem_snapshot *snap, struct outbuf *frame) {
+     int len = freemem_format_snapshot(snap, &out->fmt, out->layout, frame->data, sizeof(frame->data));
+     if (len < 0) {
+         log_message(ERROR, "cannot format memory values\n");
+         return EXIT_FAILURE;
+     }
+     frame->len = (size_t)len;
+     fflush(stdout);
+     if (outbuf_write(frame, STDOUT_FILENO) != 0) {
+         log_message(ERROR, "write error: %s\n", strerror(errno));
+         return EXIT_FAILURE;
+     }
+     return EXIT_SUCCESS;
+ }
+
+ /**
+  * Print one snapshot on the output thread, which owns its frame buffer
+  */
+ int write_snapshot(const void *snap, void *ctx) {
+     static struct outbuf frame;
+     return print_snapshot(ctx, snap, &frame);
+ }
+ 
+ /**
+  * Print the samples of a recording, paced by their recorded monotonic
+  * timestamps divided by speed, or as fast as possible when speed is 0
+  * Returns the exit status
+  */
+ int replay_recording(const char *path, double speed, double from, int count, struct output *out) {
+     static struct outbuf frame;
+     struct replay rp;
+     struct mem_sample sample;
+     unsigned flags;
+     uint64_t from_wall = 0, base_mono = 0, base_now = 0;
+     int have_base = 0, ret, exit_code = EXIT_SUCCESS;
+     unsigned long long printed = 0;
+     
+     ret = replay_open(&rp, path);
+     if (ret != RECORD_OK) {
+         log_message(ERROR, "%s: %s\n", path, record_strerror(ret));
+         replay_close(&rp);
+         return EXIT_FAILURE;
+     }
+     
+     /* Jump to the keyframe before the start offset, relative to the first sample */
+     if (from > 0) {
+         ret = replay_next(&rp, &sample, &flags);
+         if (ret == 1) {
+             from_wall = sample.wall_ns + (uint64_t)(from * NSEC_PER_SEC);
+             ret = replay_seek(&rp, from_wall);
+         }
+         if (ret < 0) {
+             log_message(ERROR, "%s: %s\n", path, record_strerror(ret));
+             replay_close(&rp);
+             return EXIT_FAILURE;
+         }
+     }
+     
+     while (!g_stop_signal && (ret = replay_next(&rp, &sample, &flags)) == 1) {
+         if (sample.wall_ns < from_wall) {
+             continue;
          }
          
-         /* Debug output */
-         log_message(DEBUG, "Memory values formatted successfully\n");
+         if (speed > 0) {
+             /* Each recording session restarts the clock, gaps between them are not replayed */
+             if (!have_base || (flags & RECORD_FLAG_SESSION) || sample.tick.actual_ns < base_mono) {
+                 base_mono = sample.tick.actual_ns;
+                 base_now = sched_now_ns();
+                 have_base = 1;
+             }
+             uint64_t offset = (uint64_t)((double)(sample.tick.actual_ns - base_mono) / speed);
+             if (sched_sleep_until(base_now + offset, &g_stop_signal) != 0) {
+                 break;
+             }
+         }
          
-         /* Printing results in requested format */
-         if (line) {
-             /* Single line output format, Linux free-like */
-             printf("Mem: %s total, %s used, %s free, %s shared, %s buff/cache, %s available\n", 
-                    totalStr, usedStr, freeStr, "0B", cachedStr, freeStr);
-             printf("Swap: %s total, %s used, %s free\n", 
-                    swapTotalStr, swapUsedStr, swapFreeStr);
+         /* Rates never span two sessions */
+         if (flags & RECORD_FLAG_SESSION) {
+             out->have_prev = 0;
+         }
+         exit_code = emit_sample(out, &sample, &frame, speed == 0);
+         if (exit_code != EXIT_SUCCESS || (count > 0 && ++printed >= (unsigned long long)count)) {
+             break;
+         }
+     }
+     
+     if (ret < 0) {
+         log_message(ERROR, "%s: %s\n", path, record_strerror(ret));
+         exit_code = EXIT_FAILURE;
+     }
+     if (frame.len > 0 && outbuf_write(&frame, STDOUT_FILENO) != 0) {
+         log_message(ERROR, "write error: %s\n", strerror(errno));
+         exit_code = EXIT_FAILURE;
+     }
+     replay_close(&rp);
+     return exit_code;
+ }
+ 
+ /**
+  * Print up to history of the latest snapshots in a daemon's ring, oldest
+  * first; snapshots the daemon overwrote meanwhile are skipped
+  * Returns the exit status
+  */
+ int print_history(const char *path, int history, const struct render_opts *ropts) {
+     static struct outbuf frame;
+     struct shm_ring ring;
+     struct mem_sample sample;
+     int exit_code = EXIT_SUCCESS;
+     
+     int ret = shm_attach(&ring, path);
+     if (ret != SHM_OK) {
+         log_message(ERROR, "%s: %s\n", path, shm_strerror(ret));
+         shm_close(&ring);
+         return EXIT_FAILURE;
+     }
+     
+     uint64_t end = shm_published(&ring);
+     uint64_t begin = end > (uint64_t)history ? end - (uint64_t)history : 0;
+     if (end - begin > ring.header->slot_count) {
+         begin = end - ring.header->slot_count;
+     }
+     if (end == 0) {
+         log_message(ERROR, "%s: %s\n", path, shm_strerror(SHM_ERR_EMPTY));
+         exit_code = EXIT_FAILURE;
+     }
+     
+     for (uint64_t n = begin; n < end && exit_code == EXIT_SUCCESS; n++) {
+         if (shm_read(&ring, n, &sample) == SHM_OK) {
+             exit_code = print_sample(&sample, ropts, &frame, 1);
+         }
+     }
+     
+     if (frame.len > 0 && outbuf_write(&frame, STDOUT_FILENO) != 0) {
+         log_message(ERROR, "write error: %s\n", strerror(errno));
+         exit_code = EXIT_FAILURE;
+     }
+     shm_close(&ring);
+     return exit_code;
+ }
+ 
+ /**
+  * Merge the recordings of many hosts and print the fleet aggregates of
+  * every interval seconds, up to count buckets when count is not 0
+  * Returns the exit status
+  */
+ int print_merge(const char *const *paths, size_t n, double interval, int count, const struct render_opts *ropts) {
+     static struct merge merge;
+     static struct outbuf frame;
+     struct fleet_bucket fb;
+     int exit_code = EXIT_SUCCESS, printed = 0, ret = 0;
+     
+     long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+     int status = merge_open(&merge, paths, n, (uint64_t)(interval * NSEC_PER_SEC + 0.5), cpus > 0 ? (unsigned)cpus : 1);
+     if (status != MERGE_OK) {
+         if (status == MERGE_ERR_OPEN || status == MERGE_ERR_FORMAT) {
+             log_message(ERROR, "%s: %s\n", paths[merge.failed], merge_strerror(status));
          } else {
-             /* Standard multi-line output format matching Linux free */
-             if (wide) {
-                 /* Linux free -w format */
-                 printf("%-7s %11s %11s %11s %11s %11s %11s %11s\n",
-                        "", "total", "used", "free", "shared", "buffers", "cache", "available");
-                 /* Use app_memory and wired_memory as buffers and cache for Linux-like output */
-                 printf("%-7s %11s %11s %11s %11s %11s %11s %11s\n", 
-                        "Mem:", totalStr, usedStr, freeStr, "0B", appStr, cachedStr, freeStr);
-                 printf("%-7s %11s %11s %11s\n", 
-                        "Swap:", swapTotalStr, swapUsedStr, swapFreeStr);
-             } else {
-                 /* Standard Linux free format */
-                 printf("%-7s %11s %11s %11s %11s %11s %11s\n",
-                        "", "total", "used", "free", "shared", "buff/cache", "available");
-                 printf("%-7s %11s %11s %11s %11s %11s %11s\n", 
-                        "Mem:", totalStr, usedStr, freeStr, "0B", cachedStr, freeStr);
-                 printf("%-7s %11s %11s %11s\n", 
-                        "Swap:", swapTotalStr, swapUsedStr, swapFreeStr);
+             log_message(ERROR, "%s\n", merge_strerror(status));
+         }
+         merge_close(&merge);
+         return EXIT_FAILURE;
+     }
+     log_message(DEBUG, "Merging %zu recordings with %u workers\n", n, merge.pool.workers);
+     
+     if (ropts->format == RENDER_FORMAT_CSV) {
+         merge_csv_header(&frame);
+     }
+     while (!g_stop_signal && (count == 0 || printed < count) && (ret = merge_next(&merge, &fb)) == 1) {
+         if (merge_render(&frame, ropts, &fb) != RENDER_OK) {
+             log_message(ERROR, "cannot format memory values\n");
+             exit_code = EXIT_FAILURE;
+             break;
+         }
+         printed++;
+         if (frame.len >= sizeof(frame.data) / 2 && outbuf_write(&frame, STDOUT_FILENO) != 0) {
+             log_message(ERROR, "write error: %s\n", strerror(errno));
+             exit_code = EXIT_FAILURE;
+             break;
+         }
+     }
+     if (exit_code == EXIT_SUCCESS && ret < 0) {
+         log_message(ERROR, "%s: %s\n", paths[merge.failed], merge_strerror(-ret));
+         exit_code = EXIT_FAILURE;
+     }
+     if (frame.len > 0 && outbuf_write(&frame, STDOUT_FILENO) != 0) {
+         log_message(ERROR, "write error: %s\n", strerror(errno));
+         exit_code = EXIT_FAILURE;
+     }
+     if (merge.skipped > 0) {
+         log_message(WARNING, "%llu samples with invalid memory counts left out\n",
+                    (unsigned long long)merge.skipped);
+     }
+     merge_close(&merge);
+     return exit_code;
+ }
+ 
+ /**
+  * Read the memory map of one process and print its totals, or with detail
+  * its categories and largest files, every interval seconds, count times
+  * or until stopped when count is 0
+  * Returns the exit status
+  */
+ int print_maps(int pid, int detail, double interval, int count, const struct render_opts *ropts, const char *fixture) {
+     static struct proc_maps maps;
+     static struct outbuf frame;
+     uint64_t deadline_ns = sched_now_ns();
+     int exit_code = EXIT_SUCCESS;
+     
+     if (ropts->format == RENDER_FORMAT_CSV) {
+         maps_csv_header(&frame);
+     }
+     for (int n = 0; !g_stop_signal && (count == 0 || n < count); n++) {
+         if (n > 0) {
+             deadline_ns += (uint64_t)(interval * NSEC_PER_SEC + 0.5);
+             if (sched_sleep_until(deadline_ns, &g_stop_signal) != 0) {
+                 break;
              }
+         }
+         
+         uint64_t start_ns = sched_now_ns();
+         int status = maps_read(&maps, pid, detail, fixture);
+         if (status != MAPS_OK) {
+             log_message(ERROR, "%d: %s\n", pid, maps_strerror(status));
+             exit_code = EXIT_FAILURE;
+             break;
+         }
+         log_message(DEBUG, "Read %llu regions and %zu files in %.3f ms\n", (unsigned long long)maps.total.regions,
+                     maps.nfiles, (double)(sched_now_ns() - start_ns) / 1e6);
+         
+         size_t next = 0;
+         do {
+             next = maps_render(&frame, ropts, &maps, next);
+             if (outbuf_write(&frame, STDOUT_FILENO) != 0) {
+                 log_message(ERROR, "write error: %s\n", strerror(errno));
+                 exit_code = EXIT_FAILURE;
+                 break;
+             }
+         } while (next < maps.nlisted);
+         if (exit_code != EXIT_SUCCESS) {
+             break;
+         }
+     }
+     maps_free(&maps);
+     return exit_code;
+ }
+ 
+ /**
+  * Print a snapshot at start and whenever the memory pressure level changes,
+  * running hook each time; in between, block on kernel notifications, or
+  * poll every fallback seconds where there are none
+  * Returns the exit status
+  */
+ int watch_pressure(double threshold, const char *hook, double fallback, int count, struct output *out,
+                    const char *fixture) {
+     static struct pressure pressure;
+     static struct outbuf frame;
+     int level = -1, printed = 0, exit_code = EXIT_SUCCESS;
+     
+     int status = pressure_open(&pressure, threshold, fixture);
+     if (status != PRESSURE_OK) {
+         log_message(WARNING, "%s, polling every %gs\n", pressure_strerror(status), fallback);
+     }
+     
+     for (uint64_t seq = 0; !g_stop_signal; seq++) {
+         int notified = 0;
+         
+         /* While under pressure, wake once a window to see it end */
+         if (seq > 0) {
+             uint64_t timeout = pressure.fd < 0 ? (uint64_t)(fallback * NSEC_PER_SEC + 0.5) :
+                                level > PRESSURE_NORMAL ? PRESSURE_WINDOW_US * 1000 : 0;
+             if (pressure_wait(&pressure, timeout, &g_stop_signal, &notified) != PRESSURE_OK) {
+                 log_message(ERROR, "%s: %s\n", pressure_strerror(PRESSURE_ERR_WAIT), strerror(errno));
+                 exit_code = EXIT_FAILURE;
+                 break;
+             }
+             if (g_stop_signal) {
+                 break;
+             }
+         }
+         
+         struct mem_sample sample;
+         struct mem_values mv;
+         memset(&sample, 0, sizeof(sample));
+         sample.tick.seq = seq;
+         sample.tick.scheduled_ns = sample.tick.actual_ns = sched_now_ns();
+         sample.wall_ns = sched_wall_ns();
+         status = collect_sample(&g_collector, &sample);
+         if (status == COLLECT_ERR_SWAP) {
+             log_message(ERROR, "%s\n", collect_strerror(status));
+         } else if (status != COLLECT_OK) {
+             log_message(FATAL, "%s\n", collect_strerror(status));
+         }
+         if (derive_sample(&sample, &mv) != EXIT_SUCCESS) {
+             exit_code = EXIT_FAILURE;
+             break;
+         }
+         
+         int current = pressure_level(&pressure, &mv, notified);
+         log_message(DEBUG, "Pressure %s%s, some %.2f%%, full %.2f%%\n", pressure_level_name(current),
+                    notified ? " (notified)" : "", pressure.some_avg10, pressure.full_avg10);
+         if (current == level) {
+             continue;
+         }
+         level = current;
+         
+         if (out->ropts->format == RENDER_FORMAT_TEXT) {
+             outbuf_puts(&frame, "Pressure: ");
+             outbuf_puts(&frame, pressure_level_name(level));
+             outbuf_puts(&frame, out->ropts->line ? " " : "\n");
+         }
+         if (emit_sample(out, &sample, &frame, 0) != EXIT_SUCCESS) {
+             exit_code = EXIT_FAILURE;
+             break;
+         }
+         if (hook != NULL && pressure_hook(hook, level, &mv) != 0) {
+             log_message(ERROR, "cannot run hook: %s\n", strerror(errno));
+         }
+         if (count > 0 && ++printed >= count) {
+             break;
+         }
+     }
+     
+     pressure_close(&pressure);
+     return exit_code;
+ }
+ 
+ /**
+  * Main program function
+  */
+ int main(int argc, char *argv[]) {
+     /* Register signal handlers for graceful termination */
+     signal(SIGINT, signal_handler);
+     signal(SIGTERM, signal_handler);
+     
+     /* Default parameters */
+     int human = 0;
+     int si = 0;
+     int unit = 1;  /* Default unit is kibibytes (KiB) */
+     int wide = 0;
+     int count = 1;
+     int count_set = 0;
+     int lohi = 0;
+     int line = 0;
+     int live_mode = 0;
+     int merge_mode = 0;
+     int format = RENDER_FORMAT_TEXT;
+     double delay = 1.0;
+     int seconds_set = 0;
+     double adapt_min = 0.0, adapt_max = 0.0;
+     double adapt_threshold = ADAPT_DEFAULT_THRESHOLD;
+     SchedMissedPolicy missed_policy = SCHED_MISSED_SKIP;
+     int report_jitter = 0;
+     int self_profile = 0;
+     int queue_size = QUEUE_DEFAULT_SIZE;
+     QueueOverflowPolicy overflow_policy = QUEUE_OVERFLOW_BLOCK;
+     const char *fixture = NULL;
+     const char *record_path = NULL;
+     const char *replay_path = NULL;
+     const char *daemon_path = NULL;
+     const char *attach_path = NULL;
+     const char *serve_address = NULL;
+     double pressure_threshold = 0.0;
+     const char *hook = NULL;
+     double trend_minutes = 0.0, trend_jump = TREND_DEFAULT_JUMP;
+     int history = 0;
+     int top = 0;
+     int pid = 0;
+     const char *cgroup_path = NULL;
+     int cgroup_top = 0;
+     int maps_mode = 0;
+     int stats_mode = 0;
+     int rates_mode = 0;
+     double speed = 1.0;
+     double from = 0.0;
+     int total = 0;
+     int committed = 0;
+     int debug = 0;
+ 
+     /* Command-line options */
+     static struct option long_options[] = {
+         {"bytes", no_argument, 0, 'b'},
+         {"kibi", no_argument, 0, 'k'},
+         {"mebi", no_argument, 0, 'm'},
+         {"gibi", no_argument, 0, 'g'},
+         {"tebi", no_argument, 0, 'e'},
+         {"pebi", no_argument, 0, 'p'},
+         {"kilo", no_argument, 0, 'K'},
+         {"mega", no_argument, 0, 'M'},
+         {"giga", no_argument, 0, 'G'},
+         {"tera", no_argument, 0, 'T'},
+         {"peta", no_argument, 0, 'P'},
+         {"human", no_argument, 0, 'h'},
+         {"wide", no_argument, 0, 'w'},
+         {"count", required_argument, 0, 'c'},
+         {"lohi", no_argument, 0, 'l'},
+         {"line", no_argument, 0, 'L'},
+         {"live", no_argument, 0, OPT_LIVE},
+         {"json", no_argument, 0, OPT_JSON},
+         {"csv", no_argument, 0, OPT_CSV},
+         {"seconds", required_argument, 0, 's'},
+         {"si", no_argument, 0, 'S'},
+         {"total", no_argument, 0, 't'},
+         {"committed", no_argument, 0, 'v'},
+         {"debug", no_argument, 0, 'd'},
+         {"help", no_argument, 0, '?'},
+         {"version", no_argument, 0, 'V'},
+         {"adaptive", required_argument, 0, OPT_ADAPTIVE},
+         {"missed", required_argument, 0, OPT_MISSED},
+         {"jitter", no_argument, 0, OPT_JITTER},
+         {"self-profile", no_argument, 0, OPT_SELF_PROFILE},
+         {"fixture", required_argument, 0, OPT_FIXTURE},
+         {"record", required_argument, 0, OPT_RECORD},
+         {"replay", required_argument, 0, OPT_REPLAY},
+         {"merge", no_argument, 0, OPT_MERGE},
+         {"speed", required_argument, 0, OPT_SPEED},
+         {"from", required_argument, 0, OPT_FROM},
+         {"daemon", required_argument, 0, OPT_DAEMON},
+         {"attach", required_argument, 0, OPT_ATTACH},
+         {"history", required_argument, 0, OPT_HISTORY},
+         {"stats", no_argument, 0, OPT_STATS},
+         {"rates", no_argument, 0, OPT_RATES},
+         {"serve", required_argument, 0, OPT_SERVE},
+         {"watch-pressure", optional_argument, 0, OPT_WATCH_PRESSURE},
+         {"hook", required_argument, 0, OPT_HOOK},
+         {"trend", required_argument, 0, OPT_TREND},
+         {"top", required_argument, 0, OPT_TOP},
+         {"pid", required_argument, 0, OPT_PID},
+         {"maps", no_argument, 0, OPT_MAPS},
+         {"cgroup", required_argument, 0, OPT_CGROUP},
+         {"cgroup-top", required_argument, 0, OPT_CGROUP_TOP},
+         {"queue", required_argument, 0, OPT_QUEUE},
+         {"overflow", required_argument, 0, OPT_OVERFLOW},
+         {0, 0, 0, 0}
+     };
+ 
+     /* Parse command-line options exactly like Linux free command */
+     int opt;
+     int option_index = 0;
+     opterr = 0; /* Suppress default getopt error messages for Linux-like behavior */
+     while ((opt = getopt_long(argc, argv, "bkmgepKMGTPhwc:lLs:StvdV?", long_options, &option_index)) != -1) {
+         switch (opt) {
+             /* Unit options */
+             case 'b': unit = 0; break;
+             case 'k': unit = 1; break;
+             case 'm': unit = 2; break;
+             case 'g': unit = 3; break;
+             case 'e': unit = 4; break;
+             case 'p': unit = 5; break;
+             
+             /* SI unit options */
+             case 'K': si = 1; unit = 1; break;
+             case 'M': si = 1; unit = 2; break;
+             case 'G': si = 1; unit = 3; break;
+             case 'T': si = 1; unit = 4; break;
+             case 'P': si = 1; unit = 5; break;
+             
+             /* Display options */
+             case 'h': human = 1; break;
+             case 'w': wide = 1; break;
+             case 'l': lohi = 1; break;
+             case 'L': line = 1; break;
+             
+             /* Machine-readable output, the last one given wins */
+             case OPT_JSON: format = RENDER_FORMAT_JSON; break;
+             case OPT_CSV: format = RENDER_FORMAT_CSV; break;
+             case 'S': si = 1; break;
+             case 't': total = 1; break;
+             case 'v': committed = 1; break;
+             case 'd': 
+                 debug = 1; 
+                 current_log_level = DEBUG;
+                 break;
+             
+             /* Count parameter with validation */
+             case 'c': 
+                 {
+                     char *endptr;
+                     long value = strtol(optarg, &endptr, 10);
+                     
+                     /* Validate conversion and range */
+                     if (*endptr != '\0' || value <= 0 || value > INT_MAX) {
+                         log_message(ERROR, "invalid count value\n");
+                         CLEANUP_AND_EXIT(EXIT_FAILURE);
+                     }
+                     count = (int)value;
+                     count_set = 1;
+                 }
+                 break;
+             
+             /* Delay parameter with validation */
+             case 's': 
+                 {
+                     char *endptr;
+                     double value = strtod(optarg, &endptr);
+                     
+                     /* Validate conversion and range */
+                     if (*endptr != '\0' || value < MIN_DELAY_VALUE || value > MAX_DELAY_VALUE) {
+                         log_message(ERROR, "invalid seconds value\n");
+                         CLEANUP_AND_EXIT(EXIT_FAILURE);
+                     }
+                     delay = value;
+                     seconds_set = 1;
+                 }
+                 break;
+             
+             /* Adaptive interval bounds MIN:MAX, optionally :THRESHOLD */
+             case OPT_ADAPTIVE:
+                 {
+                     char *endptr;
+                     adapt_min = strtod(optarg, &endptr);
+                     if (*endptr == ':') {
+                         adapt_max = strtod(endptr + 1, &endptr);
+                         if (*endptr == ':') {
+                             adapt_threshold = strtod(endptr + 1, &endptr);
+                         }
+                     }
+                     
+                     /* Validate conversion and range */
+                     if (*endptr != '\0' || adapt_min < MIN_DELAY_VALUE || adapt_max > MAX_DELAY_VALUE ||
+                         adapt_min > adapt_max || adapt_threshold <= 0 || adapt_threshold > 100) {
+                         log_message(ERROR, "invalid adaptive value '%s'\n", optarg);
+                         CLEANUP_AND_EXIT(EXIT_FAILURE);
+                     }
+                 }
+                 break;
+             
+             /* Growth horizon in minutes, optionally with the jump threshold in percent */
+             case OPT_TREND:
+                 {
+                     char *endptr;
+                     trend_minutes = strtod(optarg, &endptr);
+                     if (*endptr == ':') {
+                         trend_jump = strtod(endptr + 1, &endptr);
+                     }
+                     
+                     /* Validate conversion and range */
+                     if (*endptr != '\0' || trend_minutes <= 0 || trend_minutes > 1e6 || trend_jump < 0 ||
+                         trend_jump > 100) {
+                         log_message(ERROR, "invalid trend value '%s'\n", optarg);
+                         CLEANUP_AND_EXIT(EXIT_FAILURE);
+                     }
+                 }
+                 break;
+             
+             /* Missed deadline policy for -s */
+             case OPT_MISSED:
+                 if (strcmp(optarg, "skip") == 0) {
+                     missed_policy = SCHED_MISSED_SKIP;
+                 } else if (strcmp(optarg, "catchup") == 0) {
+                     missed_policy = SCHED_MISSED_CATCHUP;
+                 } else {
+                     log_message(ERROR, "invalid missed policy '%s'\n", optarg);
+                     CLEANUP_AND_EXIT(EXIT_FAILURE);
+                 }
+                 break;
+             
+             /* Output queue full: wait for the writer or drop the sample */
+             case OPT_OVERFLOW:
+                 if (strcmp(optarg, "block") == 0) {
+                     overflow_policy = QUEUE_OVERFLOW_BLOCK;
+                 } else if (strcmp(optarg, "drop") == 0) {
+                     overflow_policy = QUEUE_OVERFLOW_DROP;
+                 } else {
+                     log_message(ERROR, "invalid overflow policy '%s'\n", optarg);
+                     CLEANUP_AND_EXIT(EXIT_FAILURE);
+                 }
+                 break;
+             
+             case OPT_JITTER: report_jitter = 1; break;
+             case OPT_SELF_PROFILE: self_profile = 1; break;
+             case OPT_LIVE: live_mode = 1; break;
+             case OPT_MERGE: merge_mode = 1; break;
+             case OPT_MAPS: maps_mode = 1; break;
+             case OPT_FIXTURE: fixture = optarg; break;
+             case OPT_RECORD: record_path = optarg; break;
+             case OPT_REPLAY: replay_path = optarg; break;
+             case OPT_DAEMON: daemon_path = optarg; break;
+             case OPT_ATTACH: attach_path = optarg; break;
+             case OPT_CGROUP: cgroup_path = optarg; break;
+             case OPT_STATS: stats_mode = 1; break;
+             case OPT_RATES: rates_mode = 1; break;
+             case OPT_SERVE: serve_address = optarg; break;
+             case OPT_HOOK: hook = optarg; break;
+             
+             /* Pressure watch, optionally with the stall percentage that counts as pressure */
+             case OPT_WATCH_PRESSURE:
+                 pressure_threshold = PRESSURE_DEFAULT_THRESHOLD;
+                 if (optarg != NULL) {
+                     char *endptr;
+                     pressure_threshold = strtod(optarg, &endptr);
+                     if (*endptr != '\0' || pressure_threshold <= 0 || pressure_threshold > 100) {
+                         log_message(ERROR, "invalid watch-pressure value '%s'\n", optarg);
+                         CLEANUP_AND_EXIT(EXIT_FAILURE);
+                     }
+                 }
+                 break;
              
-             /* Optional: low and high memory statistics */
-             if (lohi) {
-                 if (debug) {
-                     log_message(DEBUG, "Low/high memory statistics not implemented\n");
+             /* Samples the output queue holds */
+             case OPT_QUEUE:
+                 {
+                     char *endptr;
+                     long value = strtol(optarg, &endptr, 10);
+                     
+                     /* Validate conversion and range */
+                     if (*endptr != '\0' || value < 0 || value > QUEUE_MAX_SIZE) {
+                         log_message(ERROR, "invalid queue value\n");
+                         CLEANUP_AND_EXIT(EXIT_FAILURE);
+                     }
+                     queue_size = (int)value;
                  }
-             }
+                 break;
              
-             /* Optional: total statistics (matching Linux free -t format) */
-             if (total) {
-                 unsigned long long mem_total = total_memory;
-                 unsigned long long swap_total = swapinfo.xsu_total;
-                 
-                 /* Check for potential overflow */
-                 if (ULLONG_MAX - mem_total < swap_total) {
-                     log_message(ERROR, "integer overflow in total calculation\n");
-                 } else {
-                     unsigned long long total_total = mem_total + swap_total;
+             /* Number of processes to list */
+             case OPT_TOP:
+                 {
+                     char *endptr;
+                     long value = strtol(optarg, &endptr, 10);
+                     
+                     /* Validate conversion and range */
+                     if (*endptr != '\0' || value <= 0 || value > PROCS_MAX_TOP) {
+                         log_message(ERROR, "invalid top value\n");
+                         CLEANUP_AND_EXIT(EXIT_FAILURE);
+                     }
+                     top = (int)value;
+                 }
+                 break;
+             
+             /* Number of cgroups to list */
+             case OPT_CGROUP_TOP:
+                 {
+                     char *endptr;
+                     long value = strtol(optarg, &endptr, 10);
+                     
+                     /* Validate conversion and range */
+                     if (*endptr != '\0' || value <= 0 || value > CGROUP_MAX_TOP) {
+                         log_message(ERROR, "invalid cgroup-top value\n");
+                         CLEANUP_AND_EXIT(EXIT_FAILURE);
+                     }
+                     cgroup_top = (int)value;
+                 }
+                 break;
+             
+             /* Process whose memory map to read */
+             case OPT_PID:
+                 {
+                     char *endptr;
+                     long value = strtol(optarg, &endptr, 10);
                      
-                     /* Format total values consistent with Linux free -t */
-                     char totalTotalStr[MEMORY_STRING_BUFFER_SIZE];
-                     char totalUsedStr[MEMORY_STRING_BUFFER_SIZE];
-                     char totalFreeStr[MEMORY_STRING_BUFFER_SIZE];
+                     /* Validate conversion and range */
+                     if (*endptr != '\0' || value <= 0 || value > INT_MAX) {
+                         log_message(ERROR, "invalid pid value\n");
+                         CLEANUP_AND_EXIT(EXIT_FAILURE);
+                     }
+                     pid = (int)value;
+                 }
+                 break;
+             
+             /* Number of snapshots to print from the ring */
+             case OPT_HISTORY:
+                 {
+                     char *endptr;
+                     long value = strtol(optarg, &endptr, 10);
                      
-                     unsigned long long total_used = used_memory + swapinfo.xsu_used;
-                     unsigned long long total_free = free_memory + swapinfo.xsu_avail;
+                     /* Validate conversion and range */
+                     if (*endptr != '\0' || value <= 0 || value > SHM_DEFAULT_SLOTS) {
+                         log_message(ERROR, "invalid history value\n");
+                         CLEANUP_AND_EXIT(EXIT_FAILURE);
+                     }
+                     history = (int)value;
+                 }
+                 break;
+             
+             /* Replay speed factor and start offset */
+             case OPT_SPEED:
+             case OPT_FROM:
+                 {
+                     char *endptr;
+                     double value = strtod(optarg, &endptr);
                      
-                     if (formatBytes(total_total, totalTotalStr, sizeof(totalTotalStr), human, si, unit) < 0 ||
-                         formatBytes(total_used, totalUsedStr, sizeof(totalUsedStr), human, si, unit) < 0 ||
-                         formatBytes(total_free, totalFreeStr, sizeof(totalFreeStr), human, si, unit) < 0) {
-                         log_message(ERROR, "error formatting total values\n");
-                     } else {
-                         if (wide) {
-                             /* Match the column width of the main output */
-                             printf("%-7s %11s %11s %11s %11s %11s %11s %11s\n",
-                                    "Total:", totalTotalStr, totalUsedStr, totalFreeStr, 
-                                    "", "", "", "");
-                         } else {
-                             printf("%-7s %11s %11s %11s %11s %11s %11s\n",
-                                    "Total:", totalTotalStr, totalUsedStr, totalFreeStr, 
-                                    "", "", "");
-                         }
+                     /* Validate conversion and range */
+                     if (*endptr != '\0' || value < 0 || value > 1e9) {
+                         log_message(ERROR, "invalid %s value\n", opt == OPT_SPEED ? "speed" : "from");
+                         CLEANUP_AND_EXIT(EXIT_FAILURE);
                      }
+                     if (opt == OPT_SPEED) speed = value; else from = value;
                  }
-             }
+                 break;
+             
+             /* Help and version options */
+             case '?': 
+                 print_usage(argv[0]);
+                 return EXIT_SUCCESS;
+             
+             case 'V':
+                 print_version();
+                 return EXIT_SUCCESS;
              
-             /* Optional: memory commitment information (matching Linux free -v format) */
-             if (committed) {
-                 /* Calculate percentage - Linux free shows "% of limit" */
-                 double percent = 0;
-                 if (commit_limit > 0) {
-                     percent = ((double)committed_memory / commit_limit) * 100.0;
+             default:
+                 log_message(ERROR, "Unknown option: %c\n", opt);
+                 print_usage(argv[0]);
+                 CLEANUP_AND_EXIT(EXIT_FAILURE);
+         }
+     }
+     
+     /* Validate -c requires -s */
+     if (count > 1 && !merge_mode && optind < argc && strcmp(argv[optind-1], "-s") != 0 && 
+         !strstr(argv[optind-1], "--seconds")) {
+         log_message(ERROR, "option -c/--count requires -s/--seconds\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     
+     /* Only --stats keeps nothing per sample, so only it may run past MAX_COUNT_VALUE */
+     if (count > MAX_COUNT_VALUE && !stats_mode) {
+         log_message(ERROR, "invalid count value\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     
+     /* The adaptive interval starts at its maximum, which bounds staleness for --daemon readers */
+     if (adapt_max > 0) {
+         if (seconds_set || replay_path != NULL || history > 0) {
+             log_message(ERROR, "option --adaptive cannot be combined with -s, --replay or --history\n");
+             CLEANUP_AND_EXIT(EXIT_FAILURE);
+         }
+         delay = adapt_max;
+     }
+     
+     /* Like Linux free, -s without -c repeats until interrupted; so do --adaptive, --daemon, --serve and --live */
+     if ((seconds_set || adapt_max > 0 || daemon_path != NULL || serve_address != NULL || live_mode) && !count_set) {
+         count = 0;
+     }
+     
+     /* Check for privilege escalation (only show with debug flag) */
+     if (getuid() == 0 && debug) {
+         log_message(DEBUG, "Running with root privileges\n");
+     }
+     
+     /* Output options and the frame buffer reused by every iteration */
+     struct render_opts ropts = {human, si, unit, wide, line, total, committed, format};
+     static struct outbuf frame;
+     
+     if ((record_path != NULL) + (replay_path != NULL) + (daemon_path != NULL) + (attach_path != NULL) > 1) {
+         log_message(ERROR, "options --record, --replay, --daemon and --attach are mutually exclusive\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (history > 0 && attach_path == NULL) {
+         log_message(ERROR, "option --history requires --attach\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if ((stats_mode || rates_mode) && (record_path != NULL || daemon_path != NULL || history > 0)) {
+         log_message(ERROR, "options --stats and --rates cannot be combined with --record, --daemon or --history\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (serve_address != NULL && (record_path != NULL || replay_path != NULL || daemon_path != NULL ||
+                                   history > 0 || stats_mode || rates_mode)) {
+         log_message(ERROR, "option --serve cannot be combined with --record, --replay, --daemon, --history, --stats or --rates\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (format != RENDER_FORMAT_TEXT && (stats_mode || rates_mode || line)) {
+         log_message(ERROR, "options --json and --csv cannot be combined with --stats, --rates or -L\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (pressure_threshold > 0 && (record_path != NULL || replay_path != NULL || daemon_path != NULL ||
+                                    attach_path != NULL || serve_address != NULL || stats_mode || rates_mode ||
+                                    adapt_max > 0)) {
+         log_message(ERROR, "option --watch-pressure cannot be combined with --record, --replay, --daemon, --attach, --serve, --stats, --rates or --adaptive\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (trend_minutes > 0 && (format == RENDER_FORMAT_CSV || record_path != NULL || daemon_path != NULL ||
+                               history > 0 || serve_address != NULL || stats_mode || rates_mode || live_mode ||
+                               merge_mode || pressure_threshold > 0)) {
+         log_message(ERROR, "option --trend cannot be combined with --csv, --record, --daemon, --history, --serve, --stats, --rates, --live, --merge or --watch-pressure\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (hook != NULL && pressure_threshold == 0 && trend_minutes == 0) {
+         log_message(ERROR, "option --hook requires --watch-pressure or --trend\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (top > 0 && (record_path != NULL || replay_path != NULL || daemon_path != NULL || attach_path != NULL ||
+                     serve_address != NULL || stats_mode || rates_mode || format != RENDER_FORMAT_TEXT)) {
+         log_message(ERROR, "option --top cannot be combined with --record, --replay, --daemon, --attach, --serve, --stats, --rates, --json or --csv\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (lohi && format == RENDER_FORMAT_CSV) {
+         log_message(ERROR, "option -l cannot be combined with --csv\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (live_mode && (line || format != RENDER_FORMAT_TEXT || record_path != NULL || daemon_path != NULL ||
+                       history > 0 || serve_address != NULL || stats_mode || rates_mode || pressure_threshold > 0)) {
+         log_message(ERROR, "option --live cannot be combined with -L, --json, --csv, --record, --daemon, --history, --serve, --stats, --rates or --watch-pressure\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (merge_mode && (optind == argc || line || record_path != NULL || replay_path != NULL || daemon_path != NULL ||
+                        attach_path != NULL || serve_address != NULL || stats_mode || rates_mode || top > 0 ||
+                        live_mode || pressure_threshold > 0 || adapt_max > 0)) {
+         log_message(ERROR, "option --merge needs recordings and cannot be combined with -L, --record, --replay, --daemon, --attach, --serve, --stats, --rates, --top, --live, --watch-pressure or --adaptive\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (maps_mode && pid == 0) {
+         log_message(ERROR, "option --maps requires --pid\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (pid > 0 && (line || record_path != NULL || replay_path != NULL || daemon_path != NULL ||
+                     attach_path != NULL || serve_address != NULL || stats_mode || rates_mode || top > 0 ||
+                     live_mode || merge_mode || pressure_threshold > 0 || trend_minutes > 0 || adapt_max > 0)) {
+         log_message(ERROR, "option --pid cannot be combined with -L, --record, --replay, --daemon, --attach, --serve, --stats, --rates, --top, --live, --merge, --watch-pressure, --trend or --adaptive\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (cgroup_path != NULL && (replay_path != NULL || attach_path != NULL || merge_mode || pid > 0 ||
+                                 pressure_threshold > 0)) {
+         log_message(ERROR, "option --cgroup cannot be combined with --replay, --attach, --merge, --pid or --watch-pressure\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (cgroup_top > 0 && (cgroup_path == NULL || record_path != NULL || daemon_path != NULL ||
+                            serve_address != NULL || stats_mode || rates_mode || format != RENDER_FORMAT_TEXT)) {
+         log_message(ERROR, "option --cgroup-top requires --cgroup and cannot be combined with --record, --daemon, --serve, --stats, --rates, --json or --csv\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     if (stats_mode && rates_mode) {
+         log_message(ERROR, "options --stats and --rates are mutually exclusive\n");
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     
+     /* Rates need one more sample than they print, as the first baseline */
+     if (rates_mode && count > 0) {
+         count++;
+     }
+     
+     /* Streaming statistics, constant size whatever the run length; SIGUSR1 prints a summary */
+     static struct stats stats;
+     if (stats_mode) {
+         signal(SIGUSR1, signal_handler);
+     }
+     struct output out = {.ropts = &ropts, .stats = stats_mode ? &stats : NULL, .rates = rates_mode,
+                          .interval = adapt_max > 0};
+     
+     /* Trend state is a handful of sums per figure, updated as samples are shown */
+     static struct trend trend;
+     if (trend_minutes > 0) {
+         trend_init(&trend, trend_minutes, trend_jump);
+         out.trend = &trend;
+         out.hook = hook;
+     }
+     
+     /* The live view follows the terminal size; SIGWINCH redraws it */
+     static struct live live;
+     if (live_mode) {
+         live_init(&live, STDOUT_FILENO);
+         out.live = g_live = &live;
+         signal(SIGWINCH, signal_handler);
+     }
+     
+     /* CSV names its columns once, ahead of the first record */
+     if (format == RENDER_FORMAT_CSV && record_path == NULL && daemon_path == NULL && serve_address == NULL &&
+         !merge_mode && pid == 0) {
+         render_csv_header(&frame);
+         if (outbuf_write(&frame, STDOUT_FILENO) != 0) {
+             log_message(ERROR, "write error: %s\n", strerror(errno));
+             CLEANUP_AND_EXIT(EXIT_FAILURE);
+         }
+     }
+     
+     /* So does the fleet merge, over the files left on the command line */
+     if (merge_mode) {
+         int exit_code = print_merge((const char *const *)&argv[optind], (size_t)(argc - optind),
+                                     seconds_set ? delay : 1.0, count_set ? count : 0, &ropts);
+         if (g_stop_signal) {
+             exit_code = g_stop_signal;
+         }
+         CLEANUP_AND_EXIT(exit_code);
+     }
+     
+     /* One process's memory map needs none of the system counters */
+     if (pid > 0) {
+         int exit_code = print_maps(pid, maps_mode, seconds_set ? delay : 1.0, count, &ropts, fixture);
+         if (g_stop_signal) {
+             exit_code = g_stop_signal;
+         }
+         CLEANUP_AND_EXIT(exit_code);
+     }
+     
+     /* Replay renders recorded samples, no collection needed */
+     if (replay_path != NULL) {
+         int exit_code = replay_recording(replay_path, speed, from, count_set ? count : 0, &out);
+         if (stats_mode && exit_code == EXIT_SUCCESS) {
+             exit_code = print_stats(&stats, &ropts);
+         }
+         if (g_stop_signal) {
+             exit_code = g_stop_signal;
+         }
+         CLEANUP_AND_EXIT(exit_code);
+     }
+     
+     /* A history window is read straight from the ring */
+     if (history > 0) {
+         CLEANUP_AND_EXIT(print_history(attach_path, history, &ropts));
+     }
+     
+     /* Recording keeps every counter, whatever the output options */
+     static struct recorder recorder = {.fd = -1};
+     if (record_path != NULL) {
+         int ret = record_open(&recorder, record_path);
+         if (ret != RECORD_OK) {
+             log_message(ERROR, "%s: %s\n", record_path, record_strerror(ret));
+             record_close(&recorder);
+             CLEANUP_AND_EXIT(EXIT_FAILURE);
+         }
+     }
+     
+     /* The plain table and its -w, -L, -t and -v variants are sampled and
+        formatted through libfreemem, as an embedder sees them; every other
+        mode needs the raw counters */
+     int adaptive = adapt_max > 0;
+     int plain = format == RENDER_FORMAT_TEXT && attach_path == NULL && cgroup_path == NULL &&
+                 record_path == NULL && daemon_path == NULL && serve_address == NULL && !rates_mode &&
+                 !stats_mode && !live_mode && top == 0 && !(lohi && !line) && trend_minutes <= 0 &&
+                 !adaptive && pressure_threshold <= 0 && !self_profile;
+     int status;
+     if (plain) {
+         out.fmt = (struct freemem_format){(FreememUnit)unit, si, human};
+         out.layout = (wide ? FREEMEM_LAYOUT_WIDE : 0) | (line ? FREEMEM_LAYOUT_LINE : 0) |
+                      (total ? FREEMEM_LAYOUT_TOTAL : 0) | (committed ? FREEMEM_LAYOUT_COMMITTED : 0);
+         status = freemem_open(&g_freemem, fixture);
+         if (status != FREEMEM_OK) {
+             log_message(FATAL, "%s\n", freemem_error_detail(g_freemem));
+         }
+     } else {
+         /* Fetch static host facts once; the plan decides the calls made per sample */
+         unsigned plan = (record_path || daemon_path || serve_address) ? collect_plan(1, 1, 1, 1, 1) :
+                         rates_mode ? collect_plan(adaptive, adaptive, 0, 0, 1) :
+                         collect_plan(1, 1, total, committed || format != RENDER_FORMAT_TEXT, adaptive);
+         status = attach_path ? collect_attach(&g_collector, plan, attach_path)
+                  : cgroup_path ? collect_cgroup(&g_collector, plan, cgroup_path, fixture)
+                  : collect_open(&g_collector, plan, fixture);
+         const char *source = attach_path ? attach_path : cgroup_path;
+         if (status != COLLECT_OK) {
+             log_message(FATAL, "%s%s%s\n", source ? source : "", source ? ": " : "", collect_strerror(status));
+             /* FATAL log level automatically exits */
+         }
+         g_collector.timing = debug || self_profile;
+     }
+     uint64_t page_size = plain ? freemem_page_size(g_freemem) : g_collector.facts.page_size;
+     uint64_t mem_total = plain ? freemem_mem_total(g_freemem) : g_collector.facts.mem_total;
+     
+     /* Stage histograms live for the whole run, nothing is allocated per sample */
+     static struct profile profile;
+     if (self_profile) {
+         profile_init(&profile, &g_collector);
+         g_profile = &profile;
+     }
+     
+     log_message(DEBUG, "Collection backend: %s%s%s\n", plain ? "libfreemem " FREEMEM_VERSION : g_collector.ops->name,
+                fixture ? ", fixture root " : "", fixture ? fixture : "");
+     
+     /* Readers attach to the ring by path, the daemon publishes one snapshot per tick */
+     static struct shm_ring ring = {.fd = -1};
+     if (daemon_path != NULL) {
+         int ret = shm_create(&ring, daemon_path, SHM_DEFAULT_SLOTS, (uint64_t)(delay * NSEC_PER_SEC + 0.5));
+         if (ret != SHM_OK) {
+             log_message(ERROR, "%s: %s\n", daemon_path, shm_strerror(ret));
+             shm_close(&ring);
+             CLEANUP_AND_EXIT(EXIT_FAILURE);
+         }
+         log_message(DEBUG, "Publishing to %s, %u slots\n", daemon_path, ring.header->slot_count);
+     }
+     
+     /* Scrapes are answered between samples from the last rendered response */
+     static struct server server = {.listen_fd = -1};
+     if (serve_address != NULL) {
+         int ret = serve_open(&server, serve_address);
+         if (ret != SERVE_OK) {
+             log_message(ERROR, "%s: %s\n", serve_address, serve_strerror(ret));
+             serve_close(&server);
+             CLEANUP_AND_EXIT(EXIT_FAILURE);
+         }
+         log_message(DEBUG, "Serving metrics on %s\n", serve_address);
+     }
+     log_message(DEBUG, "Page size: %llu bytes\n", (unsigned long long)page_size);
+     log_message(DEBUG, "Total physical memory: %llu bytes\n", 
+                (unsigned long long)mem_total);
+     if (!plain) {
+         log_message(DEBUG, "Collection plan:%s%s\n",
+                    (g_collector.plan & SAMPLE_VM) ? " vm" : "",
+                    (g_collector.plan & SAMPLE_SWAP) ? " swap" : "");
+     }
+     
+     /* Check if detected memory exceeds the practical limit */
+     if (mem_total > MAX_EXPECTED_MEMORY) {
+         log_message(WARNING, "Detected physical memory (%llu bytes) exceeds expected maximum (1TB)\n", 
+                    (unsigned long long)mem_total);
+     }
+     
+     /* The process scan reads the same root as the collector, one worker per CPU */
+     static struct proc_scan procs;
+     if (top > 0) {
+         long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+         g_top = &procs;
+         int ret = procs_open(&procs, (unsigned)top, cpus > 0 ? (unsigned)cpus : 1, fixture);
+         if (ret != PROCS_OK) {
+             log_message(ERROR, "%s\n", procs_strerror(ret));
+             CLEANUP_AND_EXIT(EXIT_FAILURE);
+         }
+         out.top = &procs;
+         log_message(DEBUG, "Process scan: %u workers\n", procs.pool.workers);
+     }
+     
+     /* The cgroup scan walks the tree below the collector's group, one worker per CPU */
+     static struct cgroup_scan cgroups;
+     if (cgroup_top > 0) {
+         long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+         g_cgroups = &cgroups;
+         int ret = cgroup_open(&cgroups, (unsigned)cgroup_top, cpus > 0 ? (unsigned)cpus : 1, g_collector.cgroup_dir);
+         if (ret != CGROUP_OK) {
+             log_message(ERROR, "%s: %s\n", g_collector.cgroup_dir, cgroup_strerror(ret));
+             CLEANUP_AND_EXIT(EXIT_FAILURE);
+         }
+         out.cgroups = &cgroups;
+         log_message(DEBUG, "Cgroup scan: %u workers\n", cgroups.pool.workers);
+     }
+     
+     /* Node rows for -l read the same root as the collector, their files kept open */
+     static struct numa numa;
+     if (lohi && !line) {
+         int ret = numa_open(&numa, fixture);
+         if (ret != NUMA_OK) {
+             log_message(WARNING, "%s\n", numa_strerror(ret));
+         } else {
+             out.numa = g_numa = &numa;
+             log_message(DEBUG, "NUMA: %zu nodes\n", numa.nnodes);
+         }
+     }
+     
+     /* Pressure changes drive the output instead of a timer; -s sets the fallback poll */
+     if (pressure_threshold > 0) {
+         int exit_code = watch_pressure(pressure_threshold, hook, seconds_set ? delay : PRESSURE_FALLBACK_SECONDS,
+                                        count_set ? count : 0, &out, fixture);
+         if (g_stop_signal) {
+             exit_code = g_stop_signal;
+         }
+         CLEANUP_AND_EXIT(exit_code);
+     }
+     
+     /* Repeated output is printed by its own thread, so a slow reader cannot delay sampling */
+     static struct sample_queue queue;
+     int queued = count != 1 && queue_size > 0 && !stats_mode && !live_mode && record_path == NULL &&
+                  daemon_path == NULL && serve_address == NULL;
+     if (queued) {
+         int ret = plain ? queue_start(&queue, (unsigned)queue_size, sizeof(struct freemem_snapshot), overflow_policy,
+                                       write_snapshot, &out)
+                         : queue_start(&queue, (unsigned)queue_size, sizeof(struct mem_sample), overflow_policy,
+                                       write_queued, &out);
+         if (ret != QUEUE_OK) {
+             log_message(ERROR, "%s\n", queue_strerror(ret));
+             queue_finish(&queue);
+             CLEANUP_AND_EXIT(EXIT_FAILURE);
+         }
+         g_queue = &queue;
+     }
+     
+     /* Samples are taken on absolute monotonic deadlines delay seconds apart */
+     struct scheduler sched;
+     sched_init(&sched, (uint64_t)(delay * NSEC_PER_SEC + 0.5), missed_policy);
+     
+     /* With --adaptive each sample sets the interval to the next one */
+     static struct adaptive adapt;
+     if (adaptive) {
+         adapt_init(&adapt, (uint64_t)(adapt_min * NSEC_PER_SEC + 0.5), sched.interval_ns, adapt_threshold);
+     }
+     
+     /* Main memory reporting loop */
+     for (unsigned long long i = 0; count == 0 || i < (unsigned long long)count; i++) {
+         struct sched_tick tick;
+         if (serve_address != NULL) {
+             status = serve_poll(&server, sched_deadline(&sched), &g_stop_signal);
+             if (status != SERVE_OK) {
+                 log_message(ERROR, "%s: %s: %s\n", serve_address, serve_strerror(status), strerror(errno));
+                 serve_close(&server);
+                 CLEANUP_AND_EXIT(EXIT_FAILURE);
+             }
+         }
+         while (!g_stop_signal && sched_wait(&sched, &tick) != 0) {
+             /* Interrupted by a signal that did not ask us to stop */
+             if (g_dump_stats && print_stats(&stats, &ropts) != EXIT_SUCCESS) {
+                 CLEANUP_AND_EXIT(EXIT_FAILURE);
+             }
+             if (g_resized && live_mode && redraw_live(&live) != EXIT_SUCCESS) {
+                 CLEANUP_AND_EXIT(EXIT_FAILURE);
+             }
+         }
+         if (g_stop_signal) {
+             break;
+         }
+         uint64_t wake_ns = g_profile ? sched_now_ns() : 0;
+         
+         log_message(DEBUG, "Sample %llu: scheduled +%.6fs, actual +%.6fs, jitter %.3fus\n",
+                    (unsigned long long)tick.seq,
+                    (double)(tick.scheduled_ns - sched.start_ns) / NSEC_PER_SEC,
+                    (double)(tick.actual_ns - sched.start_ns) / NSEC_PER_SEC,
+                    (double)(tick.actual_ns - tick.scheduled_ns) / 1000.0);
+         
+         /* The plain table is one libfreemem snapshot, printed directly or by the output thread */
+         if (plain) {
+             struct freemem_snapshot snap;
+             status = freemem_sample(g_freemem, &snap);
+             if (status == FREEMEM_ERR_SWAP) {
+                 /* Continue with zeroed swap info instead of exiting */
+                 log_message(ERROR, "%s\n", freemem_error_detail(g_freemem));
+             } else if (status == FREEMEM_ERR_COUNTS) {
+                 log_message(ERROR, "%s\n", freemem_strerror(status));
+                 CLEANUP_AND_EXIT(EXIT_FAILURE);
+             } else if (status != FREEMEM_OK) {
+                 log_message(FATAL, "%s\n", freemem_error_detail(g_freemem));
+             }
+             if (queued) {
+                 if (queue_push(&queue, &snap, &g_stop_signal) == QUEUE_ERR_WRITER) {
+                     break;
+                 }
+             } else if (print_snapshot(&out, &snap, &frame) != EXIT_SUCCESS) {
+                 CLEANUP_AND_EXIT(EXIT_FAILURE);
+             }
+             continue;
+         }
+         
+         /* Fetch the dynamic counters named in the plan */
+         struct mem_sample sample;
+         sample.tick = tick;
+         sample.wall_ns = sched_wall_ns();
+         uint64_t stage_ns = g_profile ? sched_now_ns() : 0;
+         status = collect_sample(&g_collector, &sample);
+         if (g_profile) {
+             profile_add(g_profile, PROFILE_COLLECT, stage_ns, sched_now_ns());
+             profile_add_calls(g_profile, &g_collector);
+         }
+         if (status == COLLECT_ERR_SWAP) {
+             /* Continue with zeroed swap info instead of exiting */
+             log_message(ERROR, "%s\n", collect_strerror(status));
+         } else if (status == COLLECT_ERR_STALE) {
+             /* Show the last snapshot anyway */
+             log_message(ERROR, "%s: %s\n", attach_path, collect_strerror(status));
+         } else if (status != COLLECT_OK) {
+             log_message(FATAL, "%s\n", collect_strerror(status));
+         }
+         
+         if (debug) {
+             for (int call = 0; call < COLLECT_CALLS; call++) {
+                 if (g_collector.calls_made & (1u << call)) {
+                     log_message(DEBUG, "%s: %.3fus\n", collect_call_name(&g_collector, call),
+                                (double)g_collector.call_ns[call] / 1000.0);
                  }
-                 
-                 /* Match Linux free output format exactly */
-                 printf("%-15s %11s\n", "Mem. Limit:", commitLimitStr);
-                 printf("%-15s %11s = %.1f%% of limit\n", "Committed:", committedStr, percent);
              }
          }
          
-         /* Sleep between iterations if not the last one */
-         if (i < count - 1) {
-             sleep(delay);
+         if (adaptive) {
+             uint64_t next = adapt_next(&adapt, &sample, sched.interval_ns);
+             if (next != sched.interval_ns) {
+                 log_message(DEBUG, "Volatility %.3f%%/s, interval %.3fs -> %.3fs\n", adapt.volatility,
+                            (double)sched.interval_ns / NSEC_PER_SEC, (double)next / NSEC_PER_SEC);
+                 sched_set_interval(&sched, next);
+             }
+         }
+         
+         if (g_profile) {
+             stage_ns = sched_now_ns();
+         }
+         if (record_path != NULL) {
+             status = record_append(&recorder, &sample);
+             if (status != RECORD_OK) {
+                 log_message(ERROR, "%s: %s\n", record_path, record_strerror(status));
+                 record_close(&recorder);
+                 CLEANUP_AND_EXIT(EXIT_FAILURE);
+             }
+         } else if (daemon_path != NULL) {
+             shm_publish(&ring, &sample);
+         } else if (serve_address != NULL) {
+             struct mem_values mv;
+             if (derive_sample(&sample, &mv) != EXIT_SUCCESS) {
+                 CLEANUP_AND_EXIT(EXIT_FAILURE);
+             }
+             /* A client still reading both responses gets them unchanged, the next tick catches up */
+             status = serve_publish(&server, &sample, &mv);
+             if (status != SERVE_OK) {
+                 log_message(WARNING, "%s: %s\n", serve_address, serve_strerror(status));
+             }
+         } else if (queued) {
+             /* Dropped samples are counted and reported at exit */
+             if (queue_push(&queue, &sample, &g_stop_signal) == QUEUE_ERR_WRITER) {
+                 break;
+             }
+         } else if (emit_sample(&out, &sample, &frame, 0) != EXIT_SUCCESS) {
+             CLEANUP_AND_EXIT(EXIT_FAILURE);
+         }
+         if (g_profile) {
+             uint64_t end_ns = sched_now_ns();
+             profile_add(g_profile, PROFILE_OUTPUT, stage_ns, end_ns);
+             profile_add(g_profile, PROFILE_ITERATION, wake_ns, end_ns);
+         }
+     }
+     
+     /* Reports below start on the line after the live frame */
+     finish_live();
+     
+     if (record_path != NULL && record_close(&recorder) != 0) {
+         log_message(ERROR, "%s: %s\n", record_path, strerror(errno));
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     
+     /* Readers keep the last snapshots, the file stays until the next daemon replaces it */
+     shm_close(&ring);
+     if (serve_address != NULL) {
+         log_message(DEBUG, "Answered %llu scrapes\n", (unsigned long long)server.scrapes);
+         serve_close(&server);
+     }
+     
+     /* Print what is still queued, then report what the queue could not take */
+     if (queued) {
+         g_queue = NULL;
+         if (queue_finish(&queue) != QUEUE_OK) {
+             CLEANUP_AND_EXIT(queue.status);
+         }
+         if (queue.dropped > 0 || report_jitter) {
+             fprintf(stderr, "Output queue: %llu samples printed, %llu dropped (%s), %llu waits, max depth %llu of %llu\n",
+                     (unsigned long long)queue.tail, (unsigned long long)queue.dropped,
+                     overflow_policy == QUEUE_OVERFLOW_BLOCK ? "block" : "drop",
+                     (unsigned long long)queue.waits, (unsigned long long)queue.max_depth,
+                     (unsigned long long)queue.mask + 1);
+         }
+     }
+     
+     /* Summary of the whole run, also when interrupted */
+     if (stats_mode && print_stats(&stats, &ropts) != EXIT_SUCCESS) {
+         CLEANUP_AND_EXIT(EXIT_FAILURE);
+     }
+     
+     /* Jitter statistics for the samples actually taken */
+     if (report_jitter) {
+         const struct sched_stats *js = &sched.stats;
+         fprintf(stderr, "Samples: %llu, missed deadlines: %llu (%s)\n",
+                 (unsigned long long)js->samples, (unsigned long long)js->missed,
+                 missed_policy == SCHED_MISSED_SKIP ? "skip" : "catchup");
+         fprintf(stderr, "Jitter: min %.3fus, mean %.3fus, max %.3fus, stddev %.3fus\n",
+                 (double)js->min_ns / 1000.0, js->mean_ns / 1000.0,
+                 (double)js->max_ns / 1000.0, sched_stddev_ns(js) / 1000.0);
+     }
+     
+     /* Where the loop spent its time, after the output thread has finished */
+     if (self_profile) {
+         static struct outbuf report;
+         profile_render(&report, &profile);
+         if (outbuf_write(&report, STDERR_FILENO) != 0) {
+             log_message(ERROR, "write error: %s\n", strerror(errno));
+             CLEANUP_AND_EXIT(EXIT_FAILURE);
          }
      }
      
+     /* Terminated by SIGINT/SIGTERM: exit with the signal number as before */
+     if (g_stop_signal) {
+         log_message(INFO, "\nReceived signal %d, cleaning up...\n", (int)g_stop_signal);
+         CLEANUP_AND_EXIT(g_stop_signal);
+     }
+     
      /* Clean up resources */
      cleanup();
      return EXIT_SUCCESS;
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /*
+  * Public library interface, a thin layer over the collect, sample and
+  * render modules that free itself is built from
+  */
+
+ #include "freemem.h"
+
+ #include <limits.h>
+ #include <stdlib.h>
+ #include <string.h>
+
+ #include "collect.h"
+ #include "render.h"
+ #include "sample.h"
+ #include "sched.h"
+
+ struct freemem {
+     struct collector col;
+     int detail;                     /* COLLECT_* status of the last failure */
+ };
+
+ /**
+  * Allocate a context and open the platform's memory information source;
+  * fixture names a directory holding proc/meminfo to read instead, or NULL
+  * Returns FREEMEM_OK, or a FREEMEM_ERR_* code with *fm still set when the
+  * context exists, so freemem_error_detail() can explain the failure
+  */
+ int freemem_open(struct freemem **fm, const char *fixture) {
+     if (fm == NULL) {
+         return FREEMEM_ERR_ARGUMENT;
+     }
+
+     *fm = calloc(1, sizeof(**fm));
+     if (*fm == NULL) {
+         return FREEMEM_ERR_NOMEM;
+     }
+
+     int status = collect_open(&(*fm)->col, collect_plan(1, 1, 1, 1, 0), fixture);
+     if (status != COLLECT_OK) {
+         (*fm)->detail = status;
+         return FREEMEM_ERR_SYSTEM;
+     }
+     return FREEMEM_OK;
+ }
+
+ /**
+  * Release the kernel handles and the context; NULL is ignored
+  */
+ void freemem_close(struct freemem *fm) {
+     if (fm != NULL) {
+         collect_close(&fm->col);
+         free(fm);
+     }
+ }
+
+ uint64_t freemem_page_size(const struct freemem *fm) {
+     return fm->col.facts.page_size;
+ }
+
+ uint64_t freemem_mem_total(const struct freemem *fm) {
+     return fm->col.facts.mem_total;
+ }
+
+ /**
+  * Take one sample and derive its values into snap
+  * Returns FREEMEM_OK, FREEMEM_ERR_SWAP with the swap figures zeroed, or
+  * another FREEMEM_ERR_* code
+  */
+ int freemem_sample(struct freemem *fm, struct freemem_snapshot *snap) {
+     struct mem_sample sample;
+     struct mem_values mv;
+
+     if (fm == NULL || snap == NULL) {
+         return FREEMEM_ERR_ARGUMENT;
+     }
+
+     memset(&sample, 0, sizeof(sample));
+     sample.tick.actual_ns = sched_now_ns();
+     sample.wall_ns = sched_wall_ns();
+     int status = collect_sample(&fm->col, &sample);
+     if (status != COLLECT_OK && status != COLLECT_ERR_SWAP) {
+         fm->detail = status;
+         return FREEMEM_ERR_SYSTEM;
+     }
+     if (sample_derive(&sample.counters, &mv) != DERIVE_OK) {
+         return FREEMEM_ERR_COUNTS;
+     }
+
+     snap->mono_ns = sample.tick.actual_ns;
+     snap->wall_ns = sample.wall_ns;
+     snap->total = mv.total;
+     snap->used = mv.used;
+     snap->free = mv.free;
+     snap->app = mv.app;
+     snap->wired = mv.wired;
+     snap->cached = mv.cached;
+     snap->swap_total = mv.swap_total;
+     snap->swap_used = mv.swap_used;
+     snap->swap_free = mv.swap_free;
+     snap->commit_limit = mv.commit_limit;
+     snap->committed = mv.committed;
+     snap->uncommitted = mv.uncommitted;
+     snap->available = mv.available;
+
+     if (status == COLLECT_ERR_SWAP) {
+         fm->detail = status;
+         return FREEMEM_ERR_SWAP;
+     }
+     return FREEMEM_OK;
+ }
+
+ /**
+  * Format one value as free prints it, e.g. "1.50 GiB" or "1.50 Gi"
+  * Returns the length written, or -1 if buf is too small
+  */
+ int freemem_format_bytes(uint64_t bytes, const struct freemem_format *fmt, char *buf, size_t size) {
+     char value[MEMORY_STRING_BUFFER_SIZE];
+
+     if (fmt == NULL || buf == NULL || size == 0) {
+         return -1;
+     }
+     if (formatBytes(bytes, value, sizeof(value), fmt->human, fmt->si, (int)fmt->unit) < 0) {
+         return -1;
+     }
+
+     size_t len = strlen(value);
+     if (len >= size) {
+         return -1;
+     }
+     memcpy(buf, value, len + 1);
+     return (int)len;
+ }
+
+ /**
+  * Format a snapshot exactly as free prints it with the given layout flags
+  * Returns the length written, or -1 if buf is too small
+  */
+ int freemem_format_snapshot(const struct freemem_snapshot *snap, const struct freemem_format *fmt,
+                             unsigned layout, char *buf, size_t size) {
+     struct outbuf frame;
+     struct mem_values mv;
+
+     if (snap == NULL || fmt == NULL || buf == NULL || size == 0) {
+         return -1;
+     }
+
+     struct render_opts opts = {
+         fmt->human, fmt->si, (int)fmt->unit,
+         (layout & FREEMEM_LAYOUT_WIDE) != 0, (layout & FREEMEM_LAYOUT_LINE) != 0,
+         (layout & FREEMEM_LAYOUT_TOTAL) != 0, (layout & FREEMEM_LAYOUT_COMMITTED) != 0,
+         RENDER_FORMAT_TEXT
+     };
+     mv.total = snap->total;
+     mv.used = snap->used;
+     mv.free = snap->free;
+     mv.app = snap->app;
+     mv.wired = snap->wired;
+     mv.cached = snap->cached;
+     mv.swap_total = snap->swap_total;
+     mv.swap_used = snap->swap_used;
+     mv.swap_free = snap->swap_free;
+     mv.commit_limit = snap->commit_limit;
+     mv.committed = snap->committed;
+     mv.uncommitted = snap->uncommitted;
+     mv.available = snap->available;
+
+     outbuf_reset(&frame);
+     int status = render_frame(&frame, &opts, &mv);
+     if ((status != RENDER_OK && status != RENDER_ERR_TOTAL) || frame.len >= size) {
+         return -1;
+     }
+     memcpy(buf, frame.data, frame.len);
+     buf[frame.len] = '\0';
+     return (int)frame.len;
+ }
+
+ /**
+  * Message for a FREEMEM_* status
+  */
+ const char *freemem_strerror(int status) {
+     switch (status) {
+         case FREEMEM_OK: return "success";
+         case FREEMEM_ERR_NOMEM: return "out of memory";
+         case FREEMEM_ERR_SYSTEM: return "cannot get memory information";
+         case FREEMEM_ERR_SWAP: return "cannot get swap information";
+         case FREEMEM_ERR_COUNTS: return "invalid memory counts";
+         case FREEMEM_ERR_ARGUMENT: return "invalid argument";
+         default: return "unknown error";
+     }
+ }
+
+ /**
+  * What exactly failed in the last FREEMEM_ERR_SYSTEM or FREEMEM_ERR_SWAP
+  */
+ const char *freemem_error_detail(const struct freemem *fm) {
+     return fm != NULL ? collect_strerror(fm->detail) : freemem_strerror(FREEMEM_ERR_NOMEM);
+ }
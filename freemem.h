@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREEMEM_H
+ #define FREEMEM_H
+
+ /*
+  * libfreemem - the memory statistics behind free(1), for embedding
+  *
+  * A context keeps the kernel handles (the Mach host port, or the open
+  * /proc/meminfo) and the page size for its whole life, so taking a
+  * snapshot costs one or two kernel calls and no allocation. Formatting
+  * writes into caller buffers and never allocates either.
+  *
+  *     struct freemem *fm;
+  *     struct freemem_snapshot snap;
+  *     char used[FREEMEM_FORMAT_SIZE];
+  *     struct freemem_format fmt = {FREEMEM_UNIT_MEBI, 0, 1};
+  *
+  *     if (freemem_open(&fm, NULL) == FREEMEM_OK && freemem_sample(fm, &snap) == FREEMEM_OK)
+  *         freemem_format_bytes(snap.used, &fmt, used, sizeof(used));
+  *     freemem_close(fm);
+  */
+
+ #include <stddef.h>
+ #include <stdint.h>
+
+ #ifdef __cplusplus
+ extern "C" {
+ #endif
+
+ #define FREEMEM_VERSION "0.4"
+
+ /* Everything else in the library is built with -fvisibility=hidden */
+ #if defined(__GNUC__)
+ #define FREEMEM_API __attribute__((visibility("default")))
+ #else
+ #define FREEMEM_API
+ #endif
+
+ /* Room for any single value formatted by freemem_format_bytes() */
+ #define FREEMEM_FORMAT_SIZE 32
+
+ /* Status codes of the library */
+ typedef enum {
+     FREEMEM_OK = 0,
+     FREEMEM_ERR_NOMEM,          /* The context could not be allocated */
+     FREEMEM_ERR_SYSTEM,         /* Memory information unavailable, see freemem_error_detail() */
+     FREEMEM_ERR_SWAP,           /* Swap figures unavailable, the rest of the snapshot is valid */
+     FREEMEM_ERR_COUNTS,         /* The kernel returned inconsistent counters */
+     FREEMEM_ERR_ARGUMENT        /* Invalid argument */
+ } FreememStatus;
+
+ /* Units of freemem_format_bytes(), powers of 1024 or, with si, of 1000 */
+ typedef enum {
+     FREEMEM_UNIT_BYTES = 0,
+     FREEMEM_UNIT_KIBI,
+     FREEMEM_UNIT_MEBI,
+     FREEMEM_UNIT_GIBI,
+     FREEMEM_UNIT_TEBI,
+     FREEMEM_UNIT_PEBI
+ } FreememUnit;
+
+ /* Layout flags of freemem_format_snapshot(), as the free options */
+ #define FREEMEM_LAYOUT_WIDE      (1u << 0)  /* -w */
+ #define FREEMEM_LAYOUT_LINE      (1u << 1)  /* -L */
+ #define FREEMEM_LAYOUT_TOTAL     (1u << 2)  /* -t */
+ #define FREEMEM_LAYOUT_COMMITTED (1u << 3)  /* -v */
+
+ /* Opaque sampling context */
+ struct freemem;
+
+ /* Derived values of one sample, in bytes */
+ struct freemem_snapshot {
+     uint64_t mono_ns;               /* CLOCK_MONOTONIC when taken */
+     uint64_t wall_ns;               /* CLOCK_REALTIME when taken */
+     uint64_t total;
+     uint64_t used;
+     uint64_t free;
+     uint64_t app;
+     uint64_t wired;
+     uint64_t cached;
+     uint64_t swap_total;
+     uint64_t swap_used;
+     uint64_t swap_free;
+     uint64_t commit_limit;
+     uint64_t committed;
+     uint64_t uncommitted;
+     uint64_t available;             /* Can be handed out without swapping, free's available column */
+ };
+
+ /* How values are formatted */
+ struct freemem_format {
+     FreememUnit unit;               /* Ignored when human is set */
+     int si;                         /* Powers of 1000 instead of 1024 */
+     int human;                      /* Pick the unit per value, as free -h */
+ };
+
+ /* Context lifetime; fixture is a directory holding proc/meminfo, or NULL */
+ FREEMEM_API int freemem_open(struct freemem **fm, const char *fixture);
+ FREEMEM_API void freemem_close(struct freemem *fm);
+
+ /* Unit of the page counts (the VM page size, 1 KiB for /proc/meminfo) and physical memory */
+ FREEMEM_API uint64_t freemem_page_size(const struct freemem *fm);
+ FREEMEM_API uint64_t freemem_mem_total(const struct freemem *fm);
+
+ /* One sample, derived as free shows it */
+ FREEMEM_API int freemem_sample(struct freemem *fm, struct freemem_snapshot *snap);
+
+ /* Non-allocating formatters, return the length written or -1 */
+ FREEMEM_API int freemem_format_bytes(uint64_t bytes, const struct freemem_format *fmt, char *buf, size_t size);
+ FREEMEM_API int freemem_format_snapshot(const struct freemem_snapshot *snap, const struct freemem_format *fmt,
+                                         unsigned layout, char *buf, size_t size);
+
+ FREEMEM_API const char *freemem_strerror(int status);
+ FREEMEM_API const char *freemem_error_detail(const struct freemem *fm);
+
+ #ifdef __cplusplus
+ }
+ #endif
+
+ #endif /* FREEMEM_H */
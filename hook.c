@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "hook.h"
+
+ #include <errno.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <sys/wait.h>
+ #include <unistd.h>
+
+ extern char **environ;
+
+ /**
+  * Start command with /bin/sh, vars added to the environment
+  * The command runs detached from a double fork, nothing waits for it
+  * Returns 0, or -1 with errno set
+  */
+ int hook_run(const char *command, char (*vars)[HOOK_VAR_SIZE], size_t nvars) {
+     size_t count = 0;
+
+     /* Everything is prepared before fork(), the child only calls execve() */
+     while (environ[count] != NULL) count++;
+     char **envp = malloc((count + nvars + 1) * sizeof(*envp));
+     if (envp == NULL) {
+         return -1;
+     }
+     memcpy(envp, environ, count * sizeof(*envp));
+     for (size_t i = 0; i < nvars; i++) {
+         envp[count + i] = vars[i];
+     }
+     envp[count + nvars] = NULL;
+     char *const argv[] = {"sh", "-c", (char *)command, NULL};
+
+     pid_t pid = fork();
+     if (pid == 0) {
+         if (fork() == 0) {
+             execve("/bin/sh", argv, envp);
+             _exit(127);
+         }
+         _exit(0);
+     }
+     free(envp);
+     if (pid < 0) {
+         return -1;
+     }
+     while (waitpid(pid, NULL, 0) < 0 && errno == EINTR) {}
+     return 0;
+ }
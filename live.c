@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "live.h"
+
+ #include <stdio.h>
+ #include <string.h>
+ #include <sys/ioctl.h>
+
+ /* Visible part of one line of a frame */
+ struct live_line {
+     const char *text;
+     size_t len;
+ };
+
+ /**
+  * Query the terminal size of fd, left at 0 when fd is not a terminal
+  */
+ static void query_size(struct live *lv, int fd) {
+     struct winsize ws;
+
+     lv->rows = lv->cols = 0;
+     if (ioctl(fd, TIOCGWINSZ, &ws) == 0) {
+         lv->rows = ws.ws_row;
+         lv->cols = ws.ws_col;
+     }
+ }
+
+ void live_init(struct live *lv, int fd) {
+     memset(lv, 0, sizeof(*lv));
+     query_size(lv, fd);
+ }
+
+ /**
+  * Take the new terminal size; the next frame is drawn in full
+  */
+ void live_resize(struct live *lv, int fd) {
+     query_size(lv, fd);
+     lv->drawn = 0;
+ }
+
+ /**
+  * Split a frame into its lines, clipped to the terminal and to the lines
+  * that can be sent within LIVE_BUDGET
+  * Returns the number of lines
+  */
+ static size_t split_lines(const struct live *lv, const char *text, size_t len, struct live_line *lines,
+                           size_t max) {
+     size_t n = 0, cost = 0;
+
+     while (len > 0 && n < max && (lv->rows == 0 || n < lv->rows)) {
+         const char *nl = memchr(text, '\n', len);
+         size_t line_len = nl ? (size_t)(nl - text) : len;
+         size_t shown = lv->cols > 0 && line_len > lv->cols ? lv->cols : line_len;
+         cost += shown + LIVE_LINE_COST;
+         if (cost > LIVE_BUDGET) {
+             break;
+         }
+         lines[n].text = text;
+         lines[n].len = shown;
+         n++;
+         if (nl == NULL) {
+             break;
+         }
+         len -= line_len + 1;
+         text = nl + 1;
+     }
+     return n;
+ }
+
+ /**
+  * Move the cursor to a zero-based row and column
+  */
+ static void move_to(struct outbuf *ob, size_t row, size_t col) {
+     char seq[32];
+     int n = snprintf(seq, sizeof(seq), "\033[%zu;%zuH", row + 1, col + 1);
+     outbuf_append(ob, seq, (size_t)n);
+ }
+
+ /**
+  * Send the changes that turn line old into line new on screen row, or the
+  * whole line when the changed runs would cost more than LIVE_LINE_COST
+  * beyond its text
+  */
+ static void diff_line(struct outbuf *ob, size_t row, const struct live_line *old, const struct live_line *new) {
+     size_t common = old->len < new->len ? old->len : new->len;
+     size_t end = old->len > new->len ? old->len : new->len;
+     size_t j = 0, start_len = ob->len;
+     int start_overflow = ob->overflow;
+
+     while (j < end) {
+         /* Next changed character; everything past the common part differs */
+         while (j < common && old->text[j] == new->text[j]) j++;
+         if (j == end) {
+             break;
+         }
+
+         /* Extend the run over short stretches of unchanged text */
+         size_t start = j, stop = j + 1;
+         for (size_t k = stop; k < end && k - stop < LIVE_GAP; k++) {
+             if (k >= common || old->text[k] != new->text[k]) {
+                 stop = k + 1;
+             }
+         }
+
+         move_to(ob, row, start);
+         if (start < new->len) {
+             outbuf_append(ob, new->text + start, (stop < new->len ? stop : new->len) - start);
+         }
+         if (stop > new->len) {
+             /* The old line was longer, erase the rest */
+             outbuf_puts(ob, "\033[K");
+         }
+         j = stop;
+     }
+
+     if (ob->overflow || ob->len - start_len > new->len + LIVE_LINE_COST) {
+         ob->len = start_len;
+         ob->overflow = start_overflow;
+         move_to(ob, row, 0);
+         outbuf_append(ob, new->text, new->len);
+         outbuf_puts(ob, "\033[K");
+     }
+ }
+
+ /**
+  * Render into ob what brings the terminal from the frame on screen to the
+  * new frame: the whole frame after clearing the screen the first time and
+  * after a resize, only the changed runs otherwise
+  * Returns RENDER_OK, or RENDER_ERR_OVERFLOW
+  */
+ int live_render(struct outbuf *ob, struct live *lv, const struct outbuf *frame) {
+     static struct live_line old[FRAME_BUFFER_SIZE / 2], new[FRAME_BUFFER_SIZE / 2];
+     size_t max = sizeof(new) / sizeof(new[0]);
+     size_t nnew = split_lines(lv, frame->data, frame->len, new, max);
+
+     if (!lv->drawn) {
+         /* Hide the cursor and start from a clear screen */
+         outbuf_puts(ob, "\033[?25l\033[H\033[2J");
+         for (size_t i = 0; i < nnew; i++) {
+             move_to(ob, i, 0);
+             outbuf_append(ob, new[i].text, new[i].len);
+         }
+     } else {
+         size_t nold = split_lines(lv, lv->prev, lv->prev_len, old, max);
+         struct live_line empty = {"", 0};
+         for (size_t i = 0; i < nnew; i++) {
+             diff_line(ob, i, i < nold ? &old[i] : &empty, &new[i]);
+         }
+         if (nold > nnew) {
+             /* Erase the lines the new frame no longer has in one go */
+             move_to(ob, nnew, 0);
+             outbuf_puts(ob, "\033[J");
+         }
+     }
+     if (ob->overflow) {
+         return RENDER_ERR_OVERFLOW;
+     }
+
+     memcpy(lv->prev, frame->data, frame->len);
+     lv->prev_len = frame->len;
+     lv->drawn = 1;
+     return RENDER_OK;
+ }
+
+ /**
+  * Draw the last frame again in full, after a resize
+  * Returns RENDER_OK, or RENDER_ERR_OVERFLOW
+  */
+ int live_redraw(struct outbuf *ob, struct live *lv) {
+     static struct outbuf frame;
+
+     outbuf_reset(&frame);
+     outbuf_append(&frame, lv->prev, lv->prev_len);
+     lv->drawn = 0;
+     return live_render(ob, lv, &frame);
+ }
+
+ /**
+  * Leave the cursor, visible again, on the line below the frame
+  */
+ void live_finish(struct outbuf *ob, const struct live *lv) {
+     static struct live_line lines[FRAME_BUFFER_SIZE / 2];
+     size_t n = split_lines(lv, lv->prev, lv->prev_len, lines, sizeof(lines) / sizeof(lines[0]));
+
+     if (lv->drawn) {
+         /* A frame filling the terminal scrolls up by one line */
+         if (lv->rows > 0 && n >= lv->rows) {
+             move_to(ob, lv->rows - 1, 0);
+             outbuf_append(ob, "\n", 1);
+         } else {
+             move_to(ob, n, 0);
+         }
+         outbuf_puts(ob, "\033[?25h");
+     }
+ }
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_LIVE_H
+ #define FREE_LIVE_H
+
+ #include <stddef.h>
+
+ #include "render.h"
+
+ /*
+  * Incremental terminal redraw for --live
+  *
+  * Frames are rendered exactly as for the table output, then compared with
+  * the frame on screen line by line. Only the runs of characters that
+  * changed are sent, each after a cursor-addressing sequence, all in one
+  * buffer and one write(). Runs closer than LIVE_GAP characters are joined,
+  * as the escape sequence would cost more than the unchanged text between
+  * them. Lines are clipped to the terminal, which never scrolls or wraps;
+  * a resize redraws the whole screen. Frames are also clipped to the lines
+  * whose text and cursor moves fit the output buffer, at LIVE_LINE_COST
+  * bytes of escapes per line at most.
+  */
+
+ #define LIVE_GAP 8
+ #define LIVE_LINE_COST 16           /* Cursor move and erase, rows below 10000 */
+ #define LIVE_BUDGET (FRAME_BUFFER_SIZE - 2 * LIVE_LINE_COST)
+
+ struct live {
+     int drawn;                      /* The screen holds prev */
+     unsigned rows;                  /* Terminal size, 0 when unknown */
+     unsigned cols;
+     size_t prev_len;
+     char prev[FRAME_BUFFER_SIZE];   /* Last frame, unclipped */
+ };
+
+ void live_init(struct live *lv, int fd);
+ void live_resize(struct live *lv, int fd);
+ int live_render(struct outbuf *ob, struct live *lv, const struct outbuf *frame);
+ int live_redraw(struct outbuf *ob, struct live *lv);
+ void live_finish(struct outbuf *ob, const struct live *lv);
+
+ #endif /* FREE_LIVE_H */
@@ -0,0 +1,743 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "maps.h"
+
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <limits.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <unistd.h>
+
+ #ifdef __APPLE__
+ #include <libproc.h>
+ #include <mach/mach.h>
+ #endif
+
+ static const char *const category_names[MAPS_CATEGORIES] = {
+     "heap", "stack", "anon", "file", "shared", "huge", "other"
+ };
+
+ static const char *const category_labels[MAPS_CATEGORIES] = {
+     "Heap:", "Stack:", "Anon:", "File:", "Shared:", "Huge:", "Other:"
+ };
+
+ /* The region being read and where its bytes go */
+ struct region {
+     int category;               /* -1 before the first region */
+     long file;                  /* Slot in pm->files, -1 for none */
+     struct maps_usage usage;
+ };
+
+ static void usage_add(struct maps_usage *a, const struct maps_usage *b) {
+     a->regions += b->regions;
+     a->size += b->size;
+     a->resident += b->resident;
+     a->pss += b->pss;
+     a->dirty += b->dirty;
+     a->swap += b->swap;
+     a->huge += b->huge;
+ }
+
+ /**
+  * FNV-1a hash of a path, never 0
+  */
+ static uint64_t path_hash(const char *s, size_t n) {
+     uint64_t h = 1469598103934665603ULL;
+     for (size_t i = 0; i < n; i++) {
+         h ^= (unsigned char)s[i];
+         h *= 1099511628211ULL;
+     }
+     return h ? h : 1;
+ }
+
+ /**
+  * Double the file table, or create it
+  * Returns MAPS_OK, or MAPS_ERR_NOMEM
+  */
+ static int files_grow(struct proc_maps *pm) {
+     size_t size = pm->files_size ? 2 * pm->files_size : 256;
+     struct maps_file *files = calloc(size, sizeof(*files));
+     if (files == NULL) {
+         return MAPS_ERR_NOMEM;
+     }
+     for (size_t i = 0; i < pm->files_size; i++) {
+         if (pm->files[i].hash != 0) {
+             size_t j = pm->files[i].hash & (size - 1);
+             while (files[j].hash != 0) j = (j + 1) & (size - 1);
+             files[j] = pm->files[i];
+         }
+     }
+     free(pm->files);
+     pm->files = files;
+     pm->files_size = size;
+     return MAPS_OK;
+ }
+
+ /**
+  * Slot of the file with this path, added when first seen
+  * Returns the slot, or -1 when the table could not grow
+  */
+ static long file_slot(struct proc_maps *pm, const char *path, size_t n) {
+     if (2 * (pm->nfiles + 1) > pm->files_size && files_grow(pm) != MAPS_OK) {
+         return -1;
+     }
+     uint64_t h = path_hash(path, n);
+     size_t mask = pm->files_size - 1;
+
+     for (size_t j = h & mask;; j = (j + 1) & mask) {
+         struct maps_file *f = &pm->files[j];
+         if (f->hash == h && memcmp(pm->names + f->path, path, n) == 0 && pm->names[f->path + n] == '\0') {
+             return (long)j;
+         }
+         if (f->hash != 0) {
+             continue;
+         }
+         if (pm->names_len + n + 1 > pm->names_size) {
+             size_t size = pm->names_size ? pm->names_size : 16384;
+             while (size < pm->names_len + n + 1) size *= 2;
+             char *names = realloc(pm->names, size);
+             if (names == NULL) {
+                 return -1;
+             }
+             pm->names = names;
+             pm->names_size = size;
+         }
+         memcpy(pm->names + pm->names_len, path, n);
+         pm->names[pm->names_len + n] = '\0';
+         f->hash = h;
+         f->path = pm->names_len;
+         pm->names_len += n + 1;
+         pm->nfiles++;
+         return (long)j;
+     }
+ }
+
+ /**
+  * Add the finished region to the totals, its category and its file
+  */
+ static void region_end(struct proc_maps *pm, const struct region *r) {
+     if (r->category < 0) {
+         return;
+     }
+     usage_add(&pm->total, &r->usage);
+     if (pm->detail) {
+         usage_add(&pm->category[r->category], &r->usage);
+         if (r->file >= 0) {
+             usage_add(&pm->files[r->file].usage, &r->usage);
+         }
+     }
+ }
+
+ static int file_less(const struct maps_file *a, const struct maps_file *b, const char *names) {
+     if (a->usage.resident != b->usage.resident) {
+         return a->usage.resident > b->usage.resident;
+     }
+     return strcmp(names + a->path, names + b->path) < 0;
+ }
+
+ /**
+  * Pack the used slots at the front with the MAPS_MAX_FILES most resident
+  * first, in order; the rest are only counted, so they are not sorted
+  */
+ static void files_rank(struct proc_maps *pm) {
+     size_t n = 0;
+
+     for (size_t i = 0; i < pm->files_size; i++) {
+         if (pm->files[i].hash != 0) {
+             pm->files[n++] = pm->files[i];
+         }
+     }
+     pm->nlisted = 0;
+     for (size_t i = 0; i < n; i++) {
+         struct maps_file f = pm->files[i];
+         size_t j = pm->nlisted < MAPS_MAX_FILES ? pm->nlisted++ : MAPS_MAX_FILES;
+         if (j == MAPS_MAX_FILES && !file_less(&f, &pm->files[j - 1], pm->names)) {
+             continue;
+         }
+         if (j == MAPS_MAX_FILES) {
+             /* The last listed file drops back into the unlisted ones */
+             pm->files[i] = pm->files[--j];
+         }
+         while (j > 0 && file_less(&f, &pm->files[j - 1], pm->names)) {
+             pm->files[j] = pm->files[j - 1];
+             j--;
+         }
+         pm->files[j] = f;
+     }
+ }
+
+ #ifdef __APPLE__
+ /**
+  * Walk the regions of the process with proc_pidinfo()
+  */
+ static int read_regions(struct proc_maps *pm) {
+     struct proc_regionwithpathinfo info;
+     struct region r = {.category = -1, .file = -1};
+     uint64_t page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+     uint64_t address = 0;
+
+     if (proc_name(pm->pid, pm->name, sizeof(pm->name)) <= 0) {
+         return MAPS_ERR_OPEN;
+     }
+     for (;;) {
+         int n = proc_pidinfo(pm->pid, PROC_PIDREGIONPATHINFO, address, &info, sizeof(info));
+         if (n < (int)sizeof(info)) {
+             /* Past the last region, unless the first could not be read */
+             if (address == 0) {
+                 return MAPS_ERR_OPEN;
+             }
+             break;
+         }
+         const struct proc_regioninfo *ri = &info.prp_prinfo;
+         const char *path = info.prp_vip.vip_path;
+         unsigned tag = ri->pri_user_tag;
+
+         memset(&r.usage, 0, sizeof(r.usage));
+         r.usage.regions = 1;
+         r.usage.size = ri->pri_size;
+         r.usage.resident = (uint64_t)ri->pri_pages_resident * page_size;
+         r.usage.dirty = (uint64_t)ri->pri_pages_dirtied * page_size;
+         r.usage.swap = (uint64_t)ri->pri_pages_swapped_out * page_size;
+         r.file = -1;
+
+         if (path[0] != '\0') {
+             r.category = MAPS_FILE;
+             if (pm->detail && (r.file = file_slot(pm, path, strlen(path))) < 0) {
+                 return MAPS_ERR_NOMEM;
+             }
+         } else if ((tag >= VM_MEMORY_MALLOC && tag <= VM_MEMORY_MALLOC_LARGE_REUSED) || tag == VM_MEMORY_MALLOC_NANO) {
+             r.category = MAPS_HEAP;
+         } else if (tag == VM_MEMORY_STACK) {
+             r.category = MAPS_STACK;
+         } else if (ri->pri_share_mode == SM_SHARED || ri->pri_share_mode == SM_TRUESHARED ||
+                    ri->pri_share_mode == SM_SHARED_ALIASED) {
+             r.category = MAPS_SHARED;
+         } else {
+             r.category = MAPS_ANON;
+         }
+         region_end(pm, &r);
+
+         if (ri->pri_address + ri->pri_size <= address) {
+             break;
+         }
+         address = ri->pri_address + ri->pri_size;
+     }
+     return MAPS_OK;
+ }
+ #else
+ static int open_proc_file(const char *root, int pid, const char *file) {
+     char path[PATH_MAX];
+     int n = snprintf(path, sizeof(path), "%s/proc/%d/%s", root ? root : "", pid, file);
+     if (n < 0 || (size_t)n >= sizeof(path)) {
+         errno = ENAMETOOLONG;
+         return -1;
+     }
+     return open(path, O_RDONLY | O_CLOEXEC);
+ }
+
+ /**
+  * Whether the n bytes at s start with the string prefix
+  */
+ static int starts_with(const char *s, size_t n, const char *prefix) {
+     size_t len = strlen(prefix);
+     return n >= len && memcmp(s, prefix, len) == 0;
+ }
+
+ /**
+  * Bytes of the "   123 kB" following a field name
+  */
+ static uint64_t field_kb(const char *p, const char *end) {
+     uint64_t value = 0;
+
+     while (p < end && *p == ' ') p++;
+     while (p < end && *p >= '0' && *p <= '9') {
+         value = value * 10 + (uint64_t)(*p++ - '0');
+     }
+     return value * 1024;
+ }
+
+ /**
+  * Start a region at its header line: "start-end perms offset dev inode path"
+  * Returns MAPS_OK, or MAPS_ERR_NOMEM
+  */
+ static int region_start(struct proc_maps *pm, struct region *r, const char *line, const char *end, int rollup) {
+     const char *p = line, *perms = line;
+
+     region_end(pm, r);
+     memset(&r->usage, 0, sizeof(r->usage));
+     r->usage.regions = rollup ? 0 : 1;
+     r->category = MAPS_OTHER;
+     r->file = -1;
+     if (rollup || !pm->detail) {
+         return MAPS_OK;
+     }
+
+     /* Keep the permissions and skip to the path, which may be empty */
+     for (int field = 0; field < 5; field++) {
+         while (p < end && *p == ' ') p++;
+         if (field == 1) perms = p;
+         while (p < end && *p != ' ') p++;
+     }
+     while (p < end && *p == ' ') p++;
+     const char *path = p;
+     size_t n = (size_t)(end - p);
+     int shared = end - perms > 3 && perms[3] == 's';
+
+     if (n == 0) {
+         r->category = shared ? MAPS_SHARED : MAPS_ANON;
+     } else if (path[0] == '[') {
+         if (starts_with(path, n, "[heap]")) {
+             r->category = MAPS_HEAP;
+         } else if (starts_with(path, n, "[stack")) {
+             r->category = MAPS_STACK;
+         } else if (starts_with(path, n, "[anon")) {
+             r->category = shared ? MAPS_SHARED : MAPS_ANON;
+         }
+     } else if (path[0] == '/') {
+         if (starts_with(path, n, "/anon_hugepage")) {
+             r->category = MAPS_HUGE;
+             return MAPS_OK;
+         }
+         if (starts_with(path, n, "/dev/zero")) {
+             r->category = shared ? MAPS_SHARED : MAPS_ANON;
+             return MAPS_OK;
+         }
+         /* shmem segments and memfds keep their name as a file */
+         int shmem = starts_with(path, n, "/dev/shm/") || starts_with(path, n, "/SYSV") ||
+                     starts_with(path, n, "/memfd:");
+         r->category = shmem && shared ? MAPS_SHARED : shmem ? MAPS_ANON : MAPS_FILE;
+         if ((r->file = file_slot(pm, path, n)) < 0) {
+             return MAPS_ERR_NOMEM;
+         }
+     }
+     return MAPS_OK;
+ }
+
+ /**
+  * hugetlbfs pages are left out of Rss, so they are added as resident here
+  */
+ static void region_hugetlb(struct region *r, uint64_t bytes) {
+     r->usage.resident += bytes;
+     r->usage.huge += bytes;
+     if (bytes > 0) {
+         r->category = MAPS_HUGE;
+     }
+ }
+
+ static int key_is(const char *key, size_t n, const char *name) {
+     return n == strlen(name) && memcmp(key, name, n) == 0;
+ }
+
+ /**
+  * Add one "Name:   123 kB" line to the region
+  */
+ static void region_field(struct region *r, const char *line, const char *end) {
+     const char *colon = memchr(line, ':', (size_t)(end - line));
+     struct maps_usage *u = &r->usage;
+
+     if (colon == NULL) {
+         return;
+     }
+     size_t n = (size_t)(colon - line);
+     switch (line[0]) {
+         case 'S':
+             if (key_is(line, n, "Size")) {
+                 u->size = field_kb(colon + 1, end);
+             } else if (key_is(line, n, "Swap")) {
+                 u->swap += field_kb(colon + 1, end);
+             } else if (key_is(line, n, "Shared_Dirty")) {
+                 u->dirty += field_kb(colon + 1, end);
+             } else if (key_is(line, n, "ShmemPmdMapped")) {
+                 u->huge += field_kb(colon + 1, end);
+             } else if (key_is(line, n, "Shared_Hugetlb")) {
+                 region_hugetlb(r, field_kb(colon + 1, end));
+             }
+             break;
+         case 'R':
+             if (key_is(line, n, "Rss")) {
+                 u->resident += field_kb(colon + 1, end);
+             }
+             break;
+         case 'P':
+             if (key_is(line, n, "Pss")) {
+                 u->pss += field_kb(colon + 1, end);
+             } else if (key_is(line, n, "Private_Dirty")) {
+                 u->dirty += field_kb(colon + 1, end);
+             } else if (key_is(line, n, "Private_Hugetlb")) {
+                 region_hugetlb(r, field_kb(colon + 1, end));
+             }
+             break;
+         case 'A':
+             if (key_is(line, n, "AnonHugePages")) {
+                 u->huge += field_kb(colon + 1, end);
+             }
+             break;
+         case 'F':
+             if (key_is(line, n, "FilePmdMapped")) {
+                 u->huge += field_kb(colon + 1, end);
+             }
+             break;
+         default:
+             break;
+     }
+ }
+
+ /**
+  * Stream smaps or smaps_rollup through pm->buf, one line at a time
+  * Returns MAPS_OK, or a MAPS_ERR_* code
+  */
+ static int read_smaps(struct proc_maps *pm, int fd, int rollup) {
+     struct region r = {.category = -1, .file = -1};
+     size_t len = 0;
+     ssize_t got;
+
+     do {
+         got = read(fd, pm->buf + len, sizeof(pm->buf) - len);
+         if (got < 0) {
+             if (errno == EINTR) continue;
+             return MAPS_ERR_READ;
+         }
+         len += (size_t)got;
+
+         /* Parse the whole lines, and the last one at end of file */
+         char *p = pm->buf, *end = pm->buf + len;
+         while (p < end) {
+             char *nl = memchr(p, '\n', (size_t)(end - p));
+             if (nl == NULL) {
+                 if (got > 0) break;
+                 nl = end;
+             }
+             /* Headers start with a hex address, fields with a capital */
+             if ((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'f')) {
+                 int status = region_start(pm, &r, p, nl, rollup);
+                 if (status != MAPS_OK) {
+                     return status;
+                 }
+             } else if (r.category >= 0) {
+                 region_field(&r, p, nl);
+             }
+             p = nl < end ? nl + 1 : end;
+         }
+         len = (size_t)(end - p);
+         if (len == sizeof(pm->buf)) {
+             /* No line is this long, drop it rather than stall */
+             len = 0;
+         }
+         memmove(pm->buf, p, len);
+     } while (got != 0);
+
+     region_end(pm, &r);
+     return MAPS_OK;
+ }
+
+ /**
+  * Read a small proc file of the process into buf, NUL-terminated
+  * Returns the length, or -1
+  */
+ static ssize_t read_small(const char *root, int pid, const char *file, char *buf, size_t size) {
+     int fd = open_proc_file(root, pid, file);
+     if (fd < 0) {
+         return -1;
+     }
+     ssize_t n = read(fd, buf, size - 1);
+     close(fd);
+     if (n < 0) {
+         return -1;
+     }
+     buf[n] = '\0';
+     return n;
+ }
+
+ static int read_regions(struct proc_maps *pm, const char *root) {
+     ssize_t n = read_small(root, pm->pid, "comm", pm->name, sizeof(pm->name));
+     if (n < 0) {
+         return MAPS_ERR_OPEN;
+     }
+     if (n > 0 && pm->name[n - 1] == '\n') {
+         pm->name[n - 1] = '\0';
+     }
+
+     /* The kernel sums the rollup itself; older kernels only have smaps */
+     int rollup = 0, fd = -1;
+     if (!pm->detail) {
+         fd = open_proc_file(root, pm->pid, "smaps_rollup");
+         rollup = fd >= 0;
+     }
+     if (fd < 0 && (fd = open_proc_file(root, pm->pid, "smaps")) < 0) {
+         return MAPS_ERR_OPEN;
+     }
+     int status = read_smaps(pm, fd, rollup);
+     close(fd);
+
+     /* The rollup has no Size, the first field of statm is the same */
+     if (status == MAPS_OK && rollup) {
+         char statm[128];
+         unsigned long long pages;
+         if (read_small(root, pm->pid, "statm", statm, sizeof(statm)) > 0 && sscanf(statm, "%llu", &pages) == 1) {
+             pm->total.size = pages * (uint64_t)sysconf(_SC_PAGESIZE);
+         }
+     }
+     return status;
+ }
+ #endif
+
+ /**
+  * Read the memory map of a process: its totals, and with detail its
+  * categories and files; root is prepended to /proc, as with --fixture
+  * Returns MAPS_OK, or a MAPS_ERR_* code
+  */
+ int maps_read(struct proc_maps *pm, int pid, int detail, const char *root) {
+     pm->pid = pid;
+     pm->detail = detail;
+     pm->name[0] = '\0';
+     memset(&pm->total, 0, sizeof(pm->total));
+     memset(pm->category, 0, sizeof(pm->category));
+     if (pm->files != NULL) {
+         memset(pm->files, 0, pm->files_size * sizeof(*pm->files));
+     }
+     pm->nfiles = 0;
+     pm->nlisted = 0;
+     pm->names_len = 0;
+
+ #ifdef __APPLE__
+     (void)root;
+     int status = read_regions(pm);
+ #else
+     int status = read_regions(pm, root);
+ #endif
+     if (status == MAPS_OK && detail) {
+         files_rank(pm);
+     }
+     return status;
+ }
+
+ /**
+  * Append s as a JSON string, or as a CSV field quoted when it must be
+  */
+ static void put_string(struct outbuf *ob, const char *s, int json) {
+     if (!json && strpbrk(s, ",\"\n\r") == NULL) {
+         outbuf_puts(ob, s);
+         return;
+     }
+     outbuf_append(ob, "\"", 1);
+     for (; *s != '\0'; s++) {
+         unsigned char c = (unsigned char)*s;
+         if (c == '"') {
+             outbuf_puts(ob, json ? "\\\"" : "\"\"");
+         } else if (json && c == '\\') {
+             outbuf_puts(ob, "\\\\");
+         } else if (json && c < 0x20) {
+             char esc[8];
+             snprintf(esc, sizeof(esc), "\\u%04x", c);
+             outbuf_puts(ob, esc);
+         } else {
+             outbuf_append(ob, s, 1);
+         }
+     }
+     outbuf_append(ob, "\"", 1);
+ }
+
+ /**
+  * Append the fields of u: a table row, a JSON object or CSV fields
+  */
+ static void put_usage(struct outbuf *ob, const struct render_opts *opts, const char *label,
+                       const struct maps_usage *u) {
+     const uint64_t values[] = {u->size, u->resident, u->pss, u->dirty, u->swap, u->huge};
+     char text[160];
+
+     if (opts->format == RENDER_FORMAT_TEXT) {
+         char cells[6][MEMORY_STRING_BUFFER_SIZE];
+         const char *row[6];
+         for (int i = 0; i < 6; i++) {
+             if (formatBytes(values[i], cells[i], sizeof(cells[i]), opts->human, opts->si, opts->unit) < 0) {
+                 snprintf(cells[i], sizeof(cells[i]), "?");
+             }
+             row[i] = cells[i];
+         }
+         render_row(ob, label, row, 6);
+     } else if (opts->format == RENDER_FORMAT_JSON) {
+         snprintf(text, sizeof(text),
+                  "{\"regions\":%llu,\"size\":%llu,\"resident\":%llu,\"pss\":%llu,\"dirty\":%llu,\"swap\":%llu,"
+                  "\"huge\":%llu}",
+                  (unsigned long long)u->regions, (unsigned long long)values[0], (unsigned long long)values[1],
+                  (unsigned long long)values[2], (unsigned long long)values[3], (unsigned long long)values[4],
+                  (unsigned long long)values[5]);
+         outbuf_puts(ob, text);
+     } else {
+         snprintf(text, sizeof(text), ",%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+                  (unsigned long long)u->regions, (unsigned long long)values[0], (unsigned long long)values[1],
+                  (unsigned long long)values[2], (unsigned long long)values[3], (unsigned long long)values[4],
+                  (unsigned long long)values[5]);
+         outbuf_puts(ob, text);
+     }
+ }
+
+ /**
+  * Column names of the CSV records, in the order maps_render() writes them
+  */
+ void maps_csv_header(struct outbuf *ob) {
+     outbuf_puts(ob, "pid,kind,name,regions,size,resident,pss,dirty,swap,huge\n");
+ }
+
+ /**
+  * Render the map read by maps_read(), starting with listed file first;
+  * the totals and categories come with first 0. Stops while the buffer
+  * still has room, so a long list goes out over several writes
+  * Returns the index of the next file to render, pm->nlisted when done
+  */
+ size_t maps_render(struct outbuf *ob, const struct render_opts *opts, const struct proc_maps *pm, size_t first) {
+     static const char *const header[] = {"size", "resident", "pss", "dirty", "swap", "huge"};
+     int json = opts->format == RENDER_FORMAT_JSON;
+     char text[96];
+     size_t i = first;
+
+     if (first == 0) {
+         if (opts->format == RENDER_FORMAT_TEXT) {
+             snprintf(text, sizeof(text), "PID %d (", pm->pid);
+             outbuf_puts(ob, text);
+             outbuf_puts(ob, pm->name);
+             outbuf_append(ob, ")", 1);
+             if (pm->detail) {
+                 snprintf(text, sizeof(text), ", %llu regions", (unsigned long long)pm->total.regions);
+                 outbuf_puts(ob, text);
+             }
+             outbuf_append(ob, "\n", 1);
+             render_row(ob, "", header, 6);
+             for (int k = 0; k < MAPS_CATEGORIES && pm->detail; k++) {
+                 put_usage(ob, opts, category_labels[k], &pm->category[k]);
+             }
+             put_usage(ob, opts, "Total:", &pm->total);
+             if (pm->nlisted > 0) {
+                 outbuf_append(ob, "\n", 1);
+                 outbuf_pad(ob, "resident", 11);
+                 outbuf_append(ob, " ", 1);
+                 outbuf_pad(ob, "dirty", 11);
+                 outbuf_append(ob, " ", 1);
+                 outbuf_pad(ob, "swap", 11);
+                 outbuf_puts(ob, "  file\n");
+             }
+         } else if (json) {
+             snprintf(text, sizeof(text), "{\"pid\":%d,\"name\":", pm->pid);
+             outbuf_puts(ob, text);
+             put_string(ob, pm->name, 1);
+             outbuf_puts(ob, ",\"total\":");
+             put_usage(ob, opts, NULL, &pm->total);
+             if (pm->detail) {
+                 outbuf_puts(ob, ",\"categories\":{");
+                 for (int k = 0; k < MAPS_CATEGORIES; k++) {
+                     snprintf(text, sizeof(text), "%s\"%s\":", k ? "," : "", category_names[k]);
+                     outbuf_puts(ob, text);
+                     put_usage(ob, opts, NULL, &pm->category[k]);
+                 }
+                 outbuf_puts(ob, "},\"files\":[");
+             }
+         } else {
+             snprintf(text, sizeof(text), "%d,total,", pm->pid);
+             outbuf_puts(ob, text);
+             put_string(ob, pm->name, 0);
+             put_usage(ob, opts, NULL, &pm->total);
+             for (int k = 0; k < MAPS_CATEGORIES && pm->detail; k++) {
+                 snprintf(text, sizeof(text), "%d,category,%s", pm->pid, category_names[k]);
+                 outbuf_puts(ob, text);
+                 put_usage(ob, opts, NULL, &pm->category[k]);
+             }
+         }
+     }
+
+     for (; i < pm->nlisted; i++) {
+         const struct maps_file *f = &pm->files[i];
+         const char *path = pm->names + f->path;
+         char shown[MAPS_PATH_SHOWN + 1];
+         size_t len = strlen(path);
+
+         if (len > MAPS_PATH_SHOWN) {
+             snprintf(shown, sizeof(shown), "...%s", path + len - (MAPS_PATH_SHOWN - 3));
+             path = shown;
+             len = MAPS_PATH_SHOWN;
+         }
+
+         /* Keep room for the path, escaped, and the figures; each call
+          * renders at least one file, so the list always progresses */
+         if (i > first && sizeof(ob->data) - ob->len < 2 * len + 256) {
+             break;
+         }
+         if (opts->format == RENDER_FORMAT_TEXT) {
+             const uint64_t values[] = {f->usage.resident, f->usage.dirty, f->usage.swap};
+             char cell[MEMORY_STRING_BUFFER_SIZE];
+             for (int k = 0; k < 3; k++) {
+                 if (formatBytes(values[k], cell, sizeof(cell), opts->human, opts->si, opts->unit) < 0) {
+                     snprintf(cell, sizeof(cell), "?");
+                 }
+                 outbuf_pad(ob, cell, 11);
+                 outbuf_append(ob, " ", 1);
+             }
+             outbuf_append(ob, " ", 1);
+             outbuf_puts(ob, path);
+             outbuf_append(ob, "\n", 1);
+         } else if (json) {
+             outbuf_puts(ob, i ? ",{\"path\":" : "{\"path\":");
+             put_string(ob, path, 1);
+             outbuf_puts(ob, ",\"usage\":");
+             put_usage(ob, opts, NULL, &f->usage);
+             outbuf_append(ob, "}", 1);
+         } else {
+             snprintf(text, sizeof(text), "%d,file,", pm->pid);
+             outbuf_puts(ob, text);
+             put_string(ob, path, 0);
+             put_usage(ob, opts, NULL, &f->usage);
+         }
+     }
+     if (i == pm->nlisted && json) {
+         outbuf_puts(ob, pm->detail ? "]}\n" : "}\n");
+     }
+     return i;
+ }
+
+ /**
+  * Release the file table and names
+  */
+ void maps_free(struct proc_maps *pm) {
+     free(pm->files);
+     free(pm->names);
+     pm->files = NULL;
+     pm->names = NULL;
+     pm->files_size = 0;
+     pm->names_size = 0;
+     pm->nfiles = 0;
+     pm->nlisted = 0;
+ }
+
+ /**
+  * Message for a MAPS_* status
+  */
+ const char *maps_strerror(int status) {
+     switch (status) {
+         case MAPS_OK: return "success";
+         case MAPS_ERR_OPEN: return "no such process, or its memory map is not readable";
+         case MAPS_ERR_READ: return "cannot read the memory map";
+         case MAPS_ERR_NOMEM: return "cannot allocate the file table";
+         default: return "unknown memory map error";
+     }
+ }
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_MAPS_H
+ #define FREE_MAPS_H
+
+ #include <stddef.h>
+ #include <stdint.h>
+
+ #include "render.h"
+
+ /*
+  * Memory map of one process
+  *
+  * For totals alone, Linux sums the regions itself in smaps_rollup. For a
+  * breakdown, smaps is streamed through a fixed buffer and parsed in place,
+  * line by line; each region is added to its category and, when a file
+  * backs it, to that file's entry in an open-addressing table keyed by
+  * path. Nothing is allocated per region, so a map of 100k regions costs
+  * the kernel's walk of it and one pass over the text. macOS walks the
+  * regions with proc_pidinfo(PROC_PIDREGIONPATHINFO).
+  */
+
+ #define MAPS_READ_SIZE 65536
+ #define MAPS_NAME_SIZE 32
+ #define MAPS_MAX_FILES 20           /* Files listed, most resident first */
+ #define MAPS_PATH_SHOWN 1024        /* Longer paths are shown by their end */
+
+ /* Status codes of maps_read() */
+ typedef enum {
+     MAPS_OK = 0,
+     MAPS_ERR_OPEN,          /* No such process, or not ours to inspect */
+     MAPS_ERR_READ,          /* The map could not be read */
+     MAPS_ERR_NOMEM          /* Could not grow the file table */
+ } MapsStatus;
+
+ /* Region categories */
+ typedef enum {
+     MAPS_HEAP = 0,
+     MAPS_STACK,
+     MAPS_ANON,              /* Private anonymous, malloc arenas included */
+     MAPS_FILE,
+     MAPS_SHARED,            /* Shared anonymous and shmem */
+     MAPS_HUGE,              /* hugetlbfs */
+     MAPS_OTHER,             /* vdso and other kernel mappings */
+     MAPS_CATEGORIES
+ } MapsCategory;
+
+ /* Bytes of a set of regions */
+ struct maps_usage {
+     uint64_t regions;
+     uint64_t size;              /* Virtual */
+     uint64_t resident;
+     uint64_t pss;               /* Proportional share of resident, Linux only */
+     uint64_t dirty;
+     uint64_t swap;
+     uint64_t huge;              /* Resident in huge pages, transparent or not */
+ };
+
+ struct maps_file {
+     uint64_t hash;              /* 0 marks a free slot */
+     size_t path;                /* Offset in names */
+     struct maps_usage usage;
+ };
+
+ struct proc_maps {
+     int pid;
+     int detail;                 /* Categories and files, not only totals */
+     char name[MAPS_NAME_SIZE];
+     struct maps_usage total;
+     struct maps_usage category[MAPS_CATEGORIES];
+
+     /* Hash table while reading, then packed and sorted by resident size */
+     struct maps_file *files;
+     size_t nfiles;
+     size_t nlisted;             /* Files maps_render() shows */
+     size_t files_size;          /* Slots, a power of two */
+     char *names;                /* NUL-terminated paths */
+     size_t names_len;
+     size_t names_size;
+
+     char buf[MAPS_READ_SIZE];
+ };
+
+ int maps_read(struct proc_maps *pm, int pid, int detail, const char *root);
+ void maps_csv_header(struct outbuf *ob);
+ size_t maps_render(struct outbuf *ob, const struct render_opts *opts, const struct proc_maps *pm, size_t first);
+ void maps_free(struct proc_maps *pm);
+ const char *maps_strerror(int status);
+
+ #endif /* FREE_MAPS_H */
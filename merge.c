@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "merge.h"
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+
+ static const char *const metric_names[MERGE_METRICS] = {"used", "free", "available", "swap"};
+ static const char *const metric_labels[MERGE_METRICS] = {"Used:", "Free:", "Avail:", "Swap:"};
+
+ /**
+  * Decode the samples of one source up to the end of the window, keeping
+  * the first sample past it pending for the next round
+  */
+ static void decode_source(struct merge *m, struct merge_source *s) {
+     s->len = s->pos = 0;
+     while (!s->done) {
+         if (!s->have_pending) {
+             struct mem_sample sample;
+             struct mem_values mv;
+             unsigned flags;
+             int ret = replay_next(&s->rp, &sample, &flags);
+             if (ret <= 0) {
+                 s->status = ret < 0 ? MERGE_ERR_FORMAT : MERGE_OK;
+                 s->done = 1;
+                 break;
+             }
+             if (!(sample.valid & SAMPLE_VM) || sample_derive(&sample.counters, &mv) != DERIVE_OK) {
+                 s->skipped++;
+                 continue;
+             }
+             s->pending.wall_ns = sample.wall_ns;
+             s->pending.value[MERGE_USED] = mv.used;
+             s->pending.value[MERGE_FREE] = mv.free;
+             s->pending.value[MERGE_AVAILABLE] = mv.available;
+             s->pending.value[MERGE_SWAP] = mv.swap_used;
+             s->have_pending = 1;
+         }
+         if (s->pending.wall_ns >= m->window_end) {
+             break;
+         }
+         if (s->len == s->size) {
+             size_t size = s->size ? s->size * 2 : MERGE_WINDOW;
+             struct merge_point *buf = realloc(s->buf, size * sizeof(*buf));
+             if (buf == NULL) {
+                 s->status = MERGE_ERR_NOMEM;
+                 s->done = 1;
+                 break;
+             }
+             s->buf = buf;
+             s->size = size;
+         }
+         s->buf[s->len++] = s->pending;
+         s->have_pending = 0;
+     }
+ }
+
+ /**
+  * Pool job: claim sources until none are left in this round
+  */
+ static void decode_claimed(void *ctx, unsigned worker) {
+     struct merge *m = ctx;
+     size_t begin, end;
+
+     (void)worker;
+     while (pool_claim(&m->pool, &begin, &end)) {
+         for (size_t i = begin; i < end; i++) {
+             decode_source(m, &m->src[i]);
+         }
+     }
+ }
+
+ /**
+  * Decode every source up to window_end, with the pool for more than a few
+  * Returns MERGE_OK, or the error of the first failed source
+  */
+ static int decode_round(struct merge *m) {
+     pool_run(&m->pool, 0, m->nsrc);
+
+     for (size_t i = 0; i < m->nsrc; i++) {
+         if (m->src[i].status != MERGE_OK) {
+             m->failed = i;
+             return m->src[i].status;
+         }
+     }
+     return MERGE_OK;
+ }
+
+ /* Heap order: earlier next sample first, then the earlier file */
+ static int source_less(const struct merge *m, size_t a, size_t b) {
+     uint64_t ta = m->src[a].buf[m->src[a].pos].wall_ns, tb = m->src[b].buf[m->src[b].pos].wall_ns;
+     return ta < tb || (ta == tb && a < b);
+ }
+
+ static void sift_down(struct merge *m, size_t i) {
+     size_t top = m->heap[i];
+
+     for (;;) {
+         size_t child = 2 * i + 1;
+         if (child >= m->nheap) break;
+         if (child + 1 < m->nheap && source_less(m, m->heap[child + 1], m->heap[child])) child++;
+         if (!source_less(m, m->heap[child], top)) break;
+         m->heap[i] = m->heap[child];
+         i = child;
+     }
+     m->heap[i] = top;
+ }
+
+ /**
+  * Open every recording and start the decode pool, workers threads with
+  * the caller's; interval_ns is the width of the fleet buckets
+  * On error, m->failed is the index of the file at fault
+  */
+ int merge_open(struct merge *m, const char *const *paths, size_t n, uint64_t interval_ns, unsigned workers) {
+     memset(m, 0, sizeof(*m));
+     m->interval_ns = interval_ns;
+     pool_init(&m->pool, workers, 1, decode_claimed, m);
+
+     m->src = calloc(n, sizeof(*m->src));
+     m->heap = calloc(n, sizeof(*m->heap));
+     m->values = calloc(n, sizeof(*m->values));
+     if (m->src == NULL || m->heap == NULL || m->values == NULL) {
+         return MERGE_ERR_NOMEM;
+     }
+     for (size_t i = 0; i < n; i++) {
+         struct merge_source *s = &m->src[i];
+         s->path = paths[i];
+         s->bucket = UINT64_MAX;
+         m->nsrc++;
+         int ret = replay_open(&s->rp, paths[i]);
+         if (ret != RECORD_OK) {
+             m->failed = i;
+             return ret == RECORD_ERR_OPEN ? MERGE_ERR_OPEN : MERGE_ERR_FORMAT;
+         }
+     }
+
+     if (pool_start(&m->pool) != 0) {
+         return MERGE_ERR_THREAD;
+     }
+
+     /* An empty window reads the first sample of every file */
+     m->window_end = 0;
+     return decode_round(m);
+ }
+
+ static int by_value(const void *a, const void *b) {
+     unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+     return x < y ? -1 : x > y;
+ }
+
+ /**
+  * Fill fb with the aggregates of the current interval
+  */
+ static void aggregate(struct merge *m, struct fleet_bucket *fb) {
+     memset(fb, 0, sizeof(*fb));
+     fb->start_ns = m->bucket * m->interval_ns;
+     fb->interval_ns = m->interval_ns;
+
+     for (int k = 0; k < MERGE_METRICS; k++) {
+         size_t n = 0;
+         for (size_t i = 0; i < m->nsrc; i++) {
+             if (m->src[i].bucket == m->bucket) {
+                 m->values[n++] = m->src[i].last.value[k];
+             }
+         }
+         fb->hosts = (unsigned)n;
+         if (n == 0) {
+             continue;
+         }
+
+         qsort(m->values, n, sizeof(*m->values), by_value);
+         for (size_t i = 0; i < n; i++) {
+             fb->sum[k] += m->values[i];
+         }
+         fb->min[k] = m->values[0];
+         fb->max[k] = m->values[n - 1];
+         fb->p50[k] = m->values[(n * 50 + 99) / 100 - 1];
+         fb->p95[k] = m->values[(n * 95 + 99) / 100 - 1];
+     }
+ }
+
+ /**
+  * Produce the next fleet bucket, in wall-clock order
+  * A host's sample stepping back in time counts for the current interval
+  * Returns 1 with fb filled in, 0 after the last bucket, or a MERGE_ERR_*
+  * code negated, with m->failed the file at fault
+  */
+ int merge_next(struct merge *m, struct fleet_bucket *fb) {
+     for (;;) {
+         while (m->nheap > 0) {
+             struct merge_source *s = &m->src[m->heap[0]];
+             const struct merge_point *pt = &s->buf[s->pos];
+             uint64_t bucket = pt->wall_ns / m->interval_ns;
+
+             if (m->have_bucket && bucket > m->bucket) {
+                 aggregate(m, fb);
+                 m->have_bucket = 0;
+                 return 1;
+             }
+             if (!m->have_bucket) {
+                 m->bucket = bucket > m->bucket ? bucket : m->bucket;
+                 m->have_bucket = 1;
+             }
+             s->bucket = m->bucket;
+             s->last = *pt;
+
+             if (++s->pos == s->len) {
+                 m->heap[0] = m->heap[--m->nheap];
+             }
+             if (m->nheap > 0) {
+                 sift_down(m, 0);
+             }
+         }
+
+         /* The window is merged, the next one starts at the earliest pending sample */
+         int pending = 0;
+         uint64_t first = UINT64_MAX;
+         for (size_t i = 0; i < m->nsrc; i++) {
+             if (m->src[i].have_pending) {
+                 pending = 1;
+                 if (m->src[i].pending.wall_ns < first) first = m->src[i].pending.wall_ns;
+             }
+         }
+         if (!pending) {
+             m->skipped = 0;
+             for (size_t i = 0; i < m->nsrc; i++) {
+                 m->skipped += m->src[i].skipped;
+             }
+             if (m->have_bucket) {
+                 aggregate(m, fb);
+                 m->have_bucket = 0;
+                 return 1;
+             }
+             return 0;
+         }
+
+         m->window_end = (first / m->interval_ns + MERGE_WINDOW) * m->interval_ns;
+         int status = decode_round(m);
+         if (status != MERGE_OK) {
+             return -status;
+         }
+         for (size_t i = 0; i < m->nsrc; i++) {
+             if (m->src[i].len > 0) {
+                 m->heap[m->nheap++] = i;
+             }
+         }
+         for (size_t i = m->nheap / 2; i-- > 0;) {
+             sift_down(m, i);
+         }
+     }
+ }
+
+ void merge_close(struct merge *m) {
+     pool_close(&m->pool);
+     for (size_t i = 0; i < m->nsrc; i++) {
+         replay_close(&m->src[i].rp);
+         free(m->src[i].buf);
+     }
+     free(m->src);
+     free(m->heap);
+     free(m->values);
+     m->src = NULL;
+     m->nsrc = 0;
+     m->heap = NULL;
+     m->values = NULL;
+ }
+
+ /**
+  * Column names of the CSV records, in the order merge_render() writes them
+  */
+ void merge_csv_header(struct outbuf *ob) {
+     static const char *const stats[] = {"sum", "min", "p50", "p95", "max"};
+
+     outbuf_puts(ob, "wall_ns,interval_ns,hosts");
+     for (int k = 0; k < MERGE_METRICS; k++) {
+         for (int j = 0; j < 5; j++) {
+             outbuf_append(ob, ",", 1);
+             outbuf_puts(ob, metric_names[k]);
+             outbuf_append(ob, "_", 1);
+             outbuf_puts(ob, stats[j]);
+         }
+     }
+     outbuf_append(ob, "\n", 1);
+ }
+
+ /**
+  * Render one fleet bucket as a table headed by its time and host count,
+  * or as a JSON object or CSV record with the same fields in bytes
+  * Returns RENDER_OK, or a RENDER_ERR_* code
+  */
+ int merge_render(struct outbuf *ob, const struct render_opts *opts, const struct fleet_bucket *fb) {
+     static const char *const header[] = {"sum", "min", "p50", "p95", "max"};
+     char text[128];
+
+     if (opts->format == RENDER_FORMAT_TEXT) {
+         char when[32];
+         time_t secs = (time_t)(fb->start_ns / NSEC_PER_SEC);
+         struct tm tm;
+         if (gmtime_r(&secs, &tm) == NULL || strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S UTC", &tm) == 0) {
+             snprintf(when, sizeof(when), "%llu", (unsigned long long)secs);
+         }
+         snprintf(text, sizeof(text), "Fleet: %s, %u hosts\n", when, fb->hosts);
+         outbuf_puts(ob, text);
+         render_row(ob, "", header, 5);
+
+         for (int k = 0; k < MERGE_METRICS; k++) {
+             char cells[5][MEMORY_STRING_BUFFER_SIZE];
+             const unsigned long long values[] = {fb->sum[k], fb->min[k], fb->p50[k], fb->p95[k], fb->max[k]};
+             const char *row[5];
+             for (int j = 0; j < 5; j++) {
+                 if (formatBytes(values[j], cells[j], sizeof(cells[j]), opts->human, opts->si, opts->unit) < 0) {
+                     return RENDER_ERR_FORMAT;
+                 }
+                 row[j] = cells[j];
+             }
+             render_row(ob, metric_labels[k], row, 5);
+         }
+         return ob->overflow ? RENDER_ERR_OVERFLOW : RENDER_OK;
+     }
+
+     int json = opts->format == RENDER_FORMAT_JSON;
+     snprintf(text, sizeof(text), json ? "{\"wall_ns\":%llu,\"interval_ns\":%llu,\"hosts\":%u" : "%llu,%llu,%u",
+              (unsigned long long)fb->start_ns, (unsigned long long)fb->interval_ns, fb->hosts);
+     outbuf_puts(ob, text);
+     for (int k = 0; k < MERGE_METRICS; k++) {
+         const unsigned long long values[] = {fb->sum[k], fb->min[k], fb->p50[k], fb->p95[k], fb->max[k]};
+         for (int j = 0; j < 5; j++) {
+             if (json) {
+                 snprintf(text, sizeof(text), ",\"%s_%s\":%llu", metric_names[k], header[j], values[j]);
+             } else {
+                 snprintf(text, sizeof(text), ",%llu", values[j]);
+             }
+             outbuf_puts(ob, text);
+         }
+     }
+     outbuf_puts(ob, json ? "}\n" : "\n");
+     return ob->overflow ? RENDER_ERR_OVERFLOW : RENDER_OK;
+ }
+
+ /**
+  * Message for a MERGE_* status
+  */
+ const char *merge_strerror(int status) {
+     switch (status) {
+         case MERGE_OK: return "success";
+         case MERGE_ERR_OPEN: return "cannot open recording";
+         case MERGE_ERR_FORMAT: return "not a recording or corrupt recording";
+         case MERGE_ERR_NOMEM: return "cannot allocate decode buffers";
+         case MERGE_ERR_THREAD: return "cannot start the decode workers";
+         default: return "unknown merge error";
+     }
+ }
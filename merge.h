@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_MERGE_H
+ #define FREE_MERGE_H
+
+ #include <stddef.h>
+ #include <stdint.h>
+
+ #include "pool.h"
+ #include "record.h"
+ #include "render.h"
+
+ /*
+  * Fleet merge of many recordings
+  *
+  * Recordings, one per host, are decoded a window of MERGE_WINDOW intervals
+  * at a time: a pool of workers claims files and decodes and derives each
+  * one's samples in the window into a small per-file buffer. The buffers
+  * are then merged by wall-clock time with a k-way heap. Each host
+  * contributes its last sample in every interval, and every interval with
+  * a sample from any host becomes one fleet bucket: sum, min, percentiles
+  * and max of used, free and swap memory across the hosts. Memory use
+  * depends on the number of files and the window, not on their length;
+  * files are mapped and read front to back.
+  */
+
+ #define MERGE_WINDOW 64             /* Intervals decoded per round */
+ #define MERGE_MAX_WORKERS POOL_MAX_WORKERS
+
+ /* Status codes of the merge, negated by merge_next() */
+ typedef enum {
+     MERGE_OK = 0,
+     MERGE_ERR_OPEN,         /* A recording could not be opened */
+     MERGE_ERR_FORMAT,       /* Not a recording, or a corrupt frame */
+     MERGE_ERR_NOMEM,        /* Could not allocate the decode buffers */
+     MERGE_ERR_THREAD        /* Could not start a worker */
+ } MergeStatus;
+
+ /* Memory figures aggregated across hosts */
+ typedef enum {
+     MERGE_USED,
+     MERGE_FREE,
+     MERGE_AVAILABLE,
+     MERGE_SWAP,
+     MERGE_METRICS
+ } MergeMetric;
+
+ /* One derived sample of one host */
+ struct merge_point {
+     uint64_t wall_ns;
+     unsigned long long value[MERGE_METRICS];
+ };
+
+ struct merge_source {
+     const char *path;
+     struct replay rp;
+     int status;                     /* RECORD_* error of the last decode */
+     int done;                       /* End of file reached */
+     uint64_t skipped;               /* Samples that could not be derived */
+     int have_pending;
+     struct merge_point pending;     /* First sample past the current window */
+     struct merge_point *buf;        /* Samples of the current window */
+     size_t len;
+     size_t pos;
+     size_t size;
+     uint64_t bucket;                /* Interval of last, UINT64_MAX before any */
+     struct merge_point last;        /* Last sample in that interval */
+ };
+
+ /* Aggregates of one interval */
+ struct fleet_bucket {
+     uint64_t start_ns;              /* Wall-clock start of the interval */
+     uint64_t interval_ns;
+     unsigned hosts;                 /* Hosts with a sample in the interval */
+     unsigned long long sum[MERGE_METRICS];
+     unsigned long long min[MERGE_METRICS];
+     unsigned long long p50[MERGE_METRICS];
+     unsigned long long p95[MERGE_METRICS];
+     unsigned long long max[MERGE_METRICS];
+ };
+
+ struct merge {
+     uint64_t interval_ns;
+     struct merge_source *src;
+     size_t nsrc;
+     size_t failed;                  /* Source of the last error */
+     uint64_t skipped;               /* Samples that could not be derived */
+
+     /* k-way merge of the window, sources ordered by their next sample */
+     size_t *heap;
+     size_t nheap;
+     uint64_t window_end;
+     int have_bucket;
+     uint64_t bucket;
+     unsigned long long *values;     /* Scratch for percentiles, one per source */
+
+     struct pool pool;               /* Claims the sources of a round one at a time */
+ };
+
+ int merge_open(struct merge *m, const char *const *paths, size_t n, uint64_t interval_ns, unsigned workers);
+ int merge_next(struct merge *m, struct fleet_bucket *fb);
+ void merge_close(struct merge *m);
+ void merge_csv_header(struct outbuf *ob);
+ int merge_render(struct outbuf *ob, const struct render_opts *opts, const struct fleet_bucket *fb);
+ const char *merge_strerror(int status);
+
+ #endif /* FREE_MERGE_H */
@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "numa.h"
+
+ #include <dirent.h>
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <limits.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <unistd.h>
+
+ #define NODE_DIR "/sys/devices/system/node"
+ #define ZONEINFO_PATH "/proc/zoneinfo"
+
+ /**
+  * Open a file under the fixture root, or the live one without
+  * Returns the descriptor, or -1
+  */
+ static int root_open(const char *root, const char *name) {
+     char path[PATH_MAX];
+
+     int ret = snprintf(path, sizeof(path), "%s%s", root ? root : "", name);
+     if (ret < 0 || (size_t)ret >= sizeof(path)) {
+         return -1;
+     }
+     return open(path, O_RDONLY | O_CLOEXEC);
+ }
+
+ /**
+  * Node id of a "nodeN" directory entry, or -1 for anything else
+  */
+ static int node_id(const char *name) {
+     long id = 0;
+
+     if (strncmp(name, "node", 4) != 0 || name[4] == '\0') {
+         return -1;
+     }
+     for (const char *p = name + 4; *p != '\0'; p++) {
+         if (*p < '0' || *p > '9' || (id = id * 10 + (*p - '0')) > INT_MAX) {
+             return -1;
+         }
+     }
+     return (int)id;
+ }
+
+ /**
+  * Open the meminfo of every node, in node order, and /proc/zoneinfo when
+  * there is one; root is prepended to both, as with --fixture
+  * Returns NUMA_OK, or NUMA_ERR_OPEN when no node could be opened
+  */
+ int numa_open(struct numa *nm, const char *root) {
+     char path[PATH_MAX];
+
+     nm->nnodes = 0;
+     nm->nzones = 0;
+     nm->zoneinfo_fd = -1;
+     long page = sysconf(_SC_PAGESIZE);
+     nm->page_size = page > 0 ? (uint64_t)page : 4096;
+
+     int ret = snprintf(path, sizeof(path), "%s%s", root ? root : "", NODE_DIR);
+     DIR *dir = ret > 0 && (size_t)ret < sizeof(path) ? opendir(path) : NULL;
+     if (dir == NULL) {
+         return NUMA_ERR_OPEN;
+     }
+     struct dirent *de;
+     while ((de = readdir(dir)) != NULL && nm->nnodes < NUMA_MAX_NODES) {
+         int id = node_id(de->d_name);
+         if (id < 0) {
+             continue;
+         }
+         snprintf(path, sizeof(path), "%s/node%d/meminfo", NODE_DIR, id);
+         int fd = root_open(root, path);
+         if (fd < 0) {
+             continue;
+         }
+
+         /* Insert in id order, readdir() order is arbitrary */
+         size_t i = nm->nnodes++;
+         while (i > 0 && nm->node[i - 1].id > id) {
+             nm->node[i] = nm->node[i - 1];
+             i--;
+         }
+         memset(&nm->node[i], 0, sizeof(nm->node[i]));
+         nm->node[i].id = id;
+         nm->node[i].fd = fd;
+     }
+     closedir(dir);
+     if (nm->nnodes == 0) {
+         return NUMA_ERR_OPEN;
+     }
+
+     nm->zoneinfo_fd = root_open(root, ZONEINFO_PATH);
+     return NUMA_OK;
+ }
+
+ /**
+  * Value of the kB figure after a colon, in bytes
+  */
+ static uint64_t kb_value(const char *p, const char *end) {
+     uint64_t value = 0;
+
+     while (p < end && (*p == ' ' || *p == ':')) p++;
+     while (p < end && *p >= '0' && *p <= '9') {
+         value = value * 10 + (uint64_t)(*p++ - '0');
+     }
+     return value * 1024;
+ }
+
+ /**
+  * Parse a node meminfo: "Node 0 MemTotal:       16318320 kB" lines
+  */
+ static void node_parse(struct numa_node *node, const char *buf, size_t len) {
+     const char *p = buf, *end = buf + len;
+
+     node->total = node->free = node->file = node->anon = 0;
+     while (p < end) {
+         const char *eol = memchr(p, '\n', (size_t)(end - p));
+         if (eol == NULL) eol = end;
+
+         /* Skip "Node N " to the key */
+         const char *key = p + 4;
+         while (key < eol && *key == ' ') key++;
+         while (key < eol && *key >= '0' && *key <= '9') key++;
+         while (key < eol && *key == ' ') key++;
+         const char *colon = memchr(key, ':', (size_t)(eol - key));
+
+         if (colon != NULL) {
+             size_t n = (size_t)(colon - key);
+             if (n == 8 && memcmp(key, "MemTotal", 8) == 0) {
+                 node->total = kb_value(colon, eol);
+             } else if (n == 7 && memcmp(key, "MemFree", 7) == 0) {
+                 node->free = kb_value(colon, eol);
+             } else if (n == 9 && memcmp(key, "FilePages", 9) == 0) {
+                 node->file = kb_value(colon, eol);
+             } else if (n == 9 && memcmp(key, "AnonPages", 9) == 0) {
+                 node->anon = kb_value(colon, eol);
+             }
+         }
+         p = eol + 1;
+     }
+ }
+
+ /**
+  * Page count after a zoneinfo label, in bytes
+  */
+ static uint64_t pages_value(const struct numa *nm, const char *p, const char *end) {
+     uint64_t value = 0;
+
+     while (p < end && *p == ' ') p++;
+     while (p < end && *p >= '0' && *p <= '9') {
+         value = value * 10 + (uint64_t)(*p++ - '0');
+     }
+     return value * nm->page_size;
+ }
+
+ /**
+  * Parse one zoneinfo line into the zone it belongs to
+  * Zones start at "Node 0, zone   Normal"; within one, "pages free N",
+  * "min N", "low N", "high N" and "managed N" are kept. Per-CPU lines such
+  * as "high:  378" have a colon and are skipped
+  */
+ static void zone_line(struct numa *nm, const char *p, const char *end, struct numa_zone **zone) {
+     if (end - p > 5 && memcmp(p, "Node ", 5) == 0) {
+         *zone = NULL;
+         if (nm->nzones == NUMA_MAX_ZONES) {
+             return;
+         }
+         const char *name = p + 5;
+         int node = 0;
+         while (name < end && *name >= '0' && *name <= '9') {
+             node = node * 10 + (*name++ - '0');
+         }
+         if (end - name < 7 || memcmp(name, ", zone ", 7) != 0) {
+             return;
+         }
+         name += 7;
+         while (name < end && *name == ' ') name++;
+
+         struct numa_zone *z = &nm->zone[nm->nzones++];
+         memset(z, 0, sizeof(*z));
+         z->node = node;
+         size_t n = (size_t)(end - name) < sizeof(z->name) - 1 ? (size_t)(end - name) : sizeof(z->name) - 1;
+         memcpy(z->name, name, n);
+         z->name[n] = '\0';
+         *zone = z;
+         return;
+     }
+     if (*zone == NULL) {
+         return;
+     }
+
+     while (p < end && *p == ' ') p++;
+     const char *word = p;
+     while (p < end && *p != ' ' && *p != ':') p++;
+     if (p == end || *p == ':') {
+         return;
+     }
+     size_t n = (size_t)(p - word);
+     struct numa_zone *z = *zone;
+     if (n == 5 && memcmp(word, "pages", 5) == 0) {
+         while (p < end && *p == ' ') p++;
+         if (end - p > 4 && memcmp(p, "free", 4) == 0) {
+             z->free = pages_value(nm, p + 4, end);
+         }
+     } else if (n == 3 && memcmp(word, "min", 3) == 0) {
+         z->min = pages_value(nm, p, end);
+     } else if (n == 3 && memcmp(word, "low", 3) == 0) {
+         z->low = pages_value(nm, p, end);
+     } else if (n == 4 && memcmp(word, "high", 4) == 0) {
+         z->high = pages_value(nm, p, end);
+     } else if (n == 7 && memcmp(word, "managed", 7) == 0) {
+         z->managed = pages_value(nm, p, end);
+     }
+ }
+
+ /**
+  * Stream /proc/zoneinfo through nm->buf, dropping zones with no memory
+  */
+ static int zones_read(struct numa *nm) {
+     struct numa_zone *zone = NULL;
+     size_t len = 0;
+     off_t offset = 0;
+     ssize_t got;
+
+     nm->nzones = 0;
+     do {
+         got = pread(nm->zoneinfo_fd, nm->buf + len, sizeof(nm->buf) - len, offset);
+         if (got < 0) {
+             if (errno == EINTR) continue;
+             return NUMA_ERR_READ;
+         }
+         offset += got;
+         len += (size_t)got;
+
+         char *p = nm->buf, *end = nm->buf + len;
+         while (p < end) {
+             char *nl = memchr(p, '\n', (size_t)(end - p));
+             if (nl == NULL) {
+                 if (got > 0) break;
+                 nl = end;
+             }
+             zone_line(nm, p, nl, &zone);
+             p = nl < end ? nl + 1 : end;
+         }
+         len = (size_t)(end - p);
+         if (len == sizeof(nm->buf)) {
+             len = 0;
+         }
+         memmove(nm->buf, p, len);
+     } while (got != 0);
+
+     /* Empty zones, such as Movable without movablecore=, tell nothing */
+     size_t kept = 0;
+     for (size_t i = 0; i < nm->nzones; i++) {
+         if (nm->zone[i].managed > 0) {
+             nm->zone[kept++] = nm->zone[i];
+         }
+     }
+     nm->nzones = kept;
+     return NUMA_OK;
+ }
+
+ /**
+  * Re-read every node, and the zones when /proc/zoneinfo is open
+  * Returns NUMA_OK, or NUMA_ERR_READ
+  */
+ int numa_read(struct numa *nm) {
+     for (size_t i = 0; i < nm->nnodes; i++) {
+         ssize_t len;
+         do {
+             len = pread(nm->node[i].fd, nm->buf, sizeof(nm->buf), 0);
+         } while (len < 0 && errno == EINTR);
+         if (len <= 0) {
+             return NUMA_ERR_READ;
+         }
+         node_parse(&nm->node[i], nm->buf, (size_t)len);
+     }
+     if (nm->zoneinfo_fd >= 0 && zones_read(nm) != NUMA_OK) {
+         /* The node rows stand on their own */
+         nm->nzones = 0;
+     }
+     return NUMA_OK;
+ }
+
+ /**
+  * Number of rows numa_render() goes through: nodes, then zones
+  */
+ size_t numa_rows(const struct numa *nm) {
+     return nm->nnodes + nm->nzones;
+ }
+
+ /**
+  * Share of a node's memory that is free, in percent
+  */
+ static double free_pct(const struct numa_node *node) {
+     return node->total > 0 ? 100.0 * (double)node->free / (double)node->total : 0.0;
+ }
+
+ /**
+  * Append the nodes with the least and the most free memory, the
+  * imbalance -l is after
+  */
+ static void render_imbalance(struct outbuf *ob, const struct numa *nm) {
+     const struct numa_node *lo = &nm->node[0], *hi = &nm->node[0];
+     char text[128];
+
+     for (size_t i = 1; i < nm->nnodes; i++) {
+         if (free_pct(&nm->node[i]) < free_pct(lo)) lo = &nm->node[i];
+         if (free_pct(&nm->node[i]) > free_pct(hi)) hi = &nm->node[i];
+     }
+     snprintf(text, sizeof(text), "Imbalance: node %d has %.1f%% free, node %d has %.1f%%\n",
+              lo->id, free_pct(lo), hi->id, free_pct(hi));
+     outbuf_puts(ob, text);
+ }
+
+ /**
+  * Render the node rows, then the zone rows, from row first: a table with
+  * each zone flagged when it is below a watermark and a closing imbalance
+  * line, or one JSON object. Stops while the buffer still has room
+  * Returns the next row, numa_rows() when done
+  */
+ size_t numa_render(struct outbuf *ob, const struct render_opts *opts, const struct numa *nm, size_t first) {
+     static const char *const node_header[] = {"total", "used", "free", "file", "anon"};
+     static const char *const zone_header[] = {"free", "min", "low", "high", "managed"};
+     size_t rows = numa_rows(nm), i = first;
+     int json = opts->format == RENDER_FORMAT_JSON;
+     char text[256];
+
+     if (opts->format == RENDER_FORMAT_CSV) {
+         return rows;
+     }
+     for (; i < rows && sizeof(ob->data) - ob->len > sizeof(text) + 96; i++) {
+         if (i == 0) {
+             if (json) {
+                 outbuf_puts(ob, "{\"nodes\":[");
+             } else {
+                 render_row(ob, "", node_header, 5);
+             }
+         }
+         if (i < nm->nnodes) {
+             const struct numa_node *node = &nm->node[i];
+             uint64_t used = node->total > node->free ? node->total - node->free : 0;
+             const uint64_t values[] = {node->total, used, node->free, node->file, node->anon};
+             if (json) {
+                 snprintf(text, sizeof(text),
+                          "%s{\"node\":%d,\"total\":%llu,\"used\":%llu,\"free\":%llu,\"file\":%llu,\"anon\":%llu}",
+                          i ? "," : "", node->id, (unsigned long long)values[0], (unsigned long long)values[1],
+                          (unsigned long long)values[2], (unsigned long long)values[3], (unsigned long long)values[4]);
+                 outbuf_puts(ob, text);
+                 continue;
+             }
+             char cells[5][MEMORY_STRING_BUFFER_SIZE], label[16];
+             const char *row[5];
+             for (int k = 0; k < 5; k++) {
+                 if (formatBytes(values[k], cells[k], sizeof(cells[k]), opts->human, opts->si, opts->unit) < 0) {
+                     snprintf(cells[k], sizeof(cells[k]), "?");
+                 }
+                 row[k] = cells[k];
+             }
+             snprintf(label, sizeof(label), "Node%d:", node->id);
+             render_row(ob, label, row, 5);
+             continue;
+         }
+
+         const struct numa_zone *z = &nm->zone[i - nm->nnodes];
+         const char *state = z->free < z->min ? "below min" : z->free < z->low ? "below low" : "";
+         if (json) {
+             snprintf(text, sizeof(text),
+                      "%s{\"node\":%d,\"zone\":\"%s\",\"free\":%llu,\"min\":%llu,\"low\":%llu,\"high\":%llu,"
+                      "\"managed\":%llu}",
+                      i > nm->nnodes ? "," : (i == nm->nnodes ? "],\"zones\":[" : ""), z->node, z->name,
+                      (unsigned long long)z->free, (unsigned long long)z->min, (unsigned long long)z->low,
+                      (unsigned long long)z->high, (unsigned long long)z->managed);
+             outbuf_puts(ob, text);
+             continue;
+         }
+         if (i == nm->nnodes) {
+             outbuf_pad(ob, "Zone", -10);
+             for (int k = 0; k < 5; k++) {
+                 outbuf_append(ob, " ", 1);
+                 outbuf_pad(ob, zone_header[k], 11);
+             }
+             outbuf_append(ob, "\n", 1);
+         }
+         const uint64_t values[] = {z->free, z->min, z->low, z->high, z->managed};
+         snprintf(text, sizeof(text), "%d/%s", z->node, z->name);
+         outbuf_pad(ob, text, -10);
+         for (int k = 0; k < 5; k++) {
+             char cell[MEMORY_STRING_BUFFER_SIZE];
+             if (formatBytes(values[k], cell, sizeof(cell), opts->human, opts->si, opts->unit) < 0) {
+                 snprintf(cell, sizeof(cell), "?");
+             }
+             outbuf_append(ob, " ", 1);
+             outbuf_pad(ob, cell, 11);
+         }
+         if (*state != '\0') {
+             outbuf_puts(ob, "  ");
+             outbuf_puts(ob, state);
+         }
+         outbuf_append(ob, "\n", 1);
+     }
+     if (i == rows) {
+         if (json) {
+             outbuf_puts(ob, nm->nzones > 0 ? "]}\n" : "],\"zones\":[]}\n");
+         } else if (nm->nnodes > 1) {
+             render_imbalance(ob, nm);
+         }
+     }
+     return i;
+ }
+
+ /**
+  * Close the node and zoneinfo descriptors
+  */
+ void numa_close(struct numa *nm) {
+     for (size_t i = 0; i < nm->nnodes; i++) {
+         close(nm->node[i].fd);
+     }
+     nm->nnodes = 0;
+     if (nm->zoneinfo_fd >= 0) {
+         close(nm->zoneinfo_fd);
+         nm->zoneinfo_fd = -1;
+     }
+ }
+
+ /**
+  * Message for a NUMA_* status
+  */
+ const char *numa_strerror(int status) {
+     switch (status) {
+         case NUMA_OK: return "success";
+         case NUMA_ERR_OPEN: return "no NUMA node information in " NODE_DIR;
+         case NUMA_ERR_READ: return "cannot read NUMA node memory";
+         default: return "unknown NUMA error";
+     }
+ }
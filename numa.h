@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_NUMA_H
+ #define FREE_NUMA_H
+
+ #include <stddef.h>
+ #include <stdint.h>
+
+ #include "render.h"
+
+ /*
+  * Per-node and per-zone memory for -l
+  *
+  * Each /sys/devices/system/node/nodeN/meminfo and /proc/zoneinfo is opened
+  * once and re-read with pread() on every sample, like the collector does
+  * /proc/meminfo. zoneinfo grows with the CPU count, so it is streamed
+  * through a fixed buffer and only the zone headers, free pages,
+  * watermarks and managed pages are parsed. Only POSIX is used, so fixture
+  * trees work on any platform.
+  */
+
+ #define NUMA_MAX_NODES 256
+ #define NUMA_MAX_ZONES (5 * NUMA_MAX_NODES)
+ #define NUMA_READ_SIZE 16384
+ #define NUMA_ZONE_NAME_SIZE 16
+
+ /* Status codes of the node reader */
+ typedef enum {
+     NUMA_OK = 0,
+     NUMA_ERR_OPEN,          /* No node directory: not Linux, or no NUMA support */
+     NUMA_ERR_READ           /* A node's meminfo could not be read */
+ } NumaStatus;
+
+ struct numa_node {
+     int id;
+     int fd;                         /* nodeN/meminfo */
+     uint64_t total;                 /* Bytes */
+     uint64_t free;
+     uint64_t file;                  /* Page cache */
+     uint64_t anon;
+ };
+
+ struct numa_zone {
+     int node;
+     char name[NUMA_ZONE_NAME_SIZE];
+     uint64_t free;                  /* Bytes */
+     uint64_t min;                   /* Watermarks: direct reclaim below min, */
+     uint64_t low;                   /* kswapd wakes below low */
+     uint64_t high;                  /* and sleeps again above high */
+     uint64_t managed;
+ };
+
+ struct numa {
+     size_t nnodes;
+     size_t nzones;
+     int zoneinfo_fd;                /* -1 without /proc/zoneinfo */
+     uint64_t page_size;
+     struct numa_node node[NUMA_MAX_NODES];
+     struct numa_zone zone[NUMA_MAX_ZONES];
+     char buf[NUMA_READ_SIZE];
+ };
+
+ int numa_open(struct numa *nm, const char *root);
+ int numa_read(struct numa *nm);
+ size_t numa_rows(const struct numa *nm);
+ size_t numa_render(struct outbuf *ob, const struct render_opts *opts, const struct numa *nm, size_t first);
+ void numa_close(struct numa *nm);
+ const char *numa_strerror(int status);
+
+ #endif /* FREE_NUMA_H */
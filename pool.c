@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "pool.h"
+
+ #include <signal.h>
+ #include <stdlib.h>
+ #include <string.h>
+
+ /**
+  * Pool thread: run the job once per generation until told to quit
+  */
+ static void *worker_main(void *arg) {
+     struct pool_thread *t = arg;
+     struct pool *p = t->pool;
+     uint64_t seen = 0;
+
+     pthread_mutex_lock(&p->lock);
+     for (;;) {
+         while (p->generation == seen && !p->quit) {
+             pthread_cond_wait(&p->start, &p->lock);
+         }
+         if (p->quit) {
+             break;
+         }
+         seen = p->generation;
+         pthread_mutex_unlock(&p->lock);
+
+         p->job(p->ctx, t->index);
+
+         pthread_mutex_lock(&p->lock);
+         if (--p->running == 0) {
+             pthread_cond_signal(&p->done);
+         }
+     }
+     pthread_mutex_unlock(&p->lock);
+     return NULL;
+ }
+
+ /**
+  * Set up a pool of workers threads, the caller's included, that run job
+  * over chunk items at a time; no thread is started yet
+  */
+ void pool_init(struct pool *p, unsigned workers, size_t chunk, pool_job job, void *ctx) {
+     memset(p, 0, sizeof(*p));
+     p->workers = workers < 1 ? 1 : workers > POOL_MAX_WORKERS ? POOL_MAX_WORKERS : workers;
+     p->chunk = chunk;
+     p->job = job;
+     p->ctx = ctx;
+     pthread_mutex_init(&p->lock, NULL);
+     pthread_cond_init(&p->start, NULL);
+     pthread_cond_init(&p->done, NULL);
+ }
+
+ /**
+  * Start the pool threads, which leave signals to the main loop
+  * Returns 0, or -1 when a thread could not be started
+  */
+ int pool_start(struct pool *p) {
+     sigset_t all, old;
+
+     sigfillset(&all);
+     pthread_sigmask(SIG_SETMASK, &all, &old);
+     for (unsigned i = 1; i < p->workers; i++) {
+         p->thread[i].pool = p;
+         p->thread[i].index = i;
+         if (pthread_create(&p->thread[i].thread, NULL, worker_main, &p->thread[i]) != 0) {
+             break;
+         }
+         p->started++;
+     }
+     pthread_sigmask(SIG_SETMASK, &old, NULL);
+     return p->started == p->workers - 1 ? 0 : -1;
+ }
+
+ /**
+  * Run the job over items begin to end, with the threads when the range is
+  * wide enough to be worth waking them, and wait for every worker
+  */
+ void pool_run(struct pool *p, size_t begin, size_t end) {
+     atomic_store(&p->next, begin);
+     p->end = end;
+     if (p->started == 0 || end - begin <= POOL_WAKE_CHUNKS * p->chunk) {
+         p->job(p->ctx, 0);
+         return;
+     }
+
+     pthread_mutex_lock(&p->lock);
+     p->generation++;
+     p->running = p->started;
+     pthread_cond_broadcast(&p->start);
+     pthread_mutex_unlock(&p->lock);
+
+     p->job(p->ctx, 0);
+
+     pthread_mutex_lock(&p->lock);
+     while (p->running > 0) {
+         pthread_cond_wait(&p->done, &p->lock);
+     }
+     pthread_mutex_unlock(&p->lock);
+ }
+
+ /**
+  * Claim the next chunk of the current run into begin to end
+  * Returns 1, or 0 once every item has been claimed
+  */
+ int pool_claim(struct pool *p, size_t *begin, size_t *end) {
+     size_t first = atomic_fetch_add(&p->next, p->chunk);
+     if (first >= p->end) {
+         return 0;
+     }
+     *begin = first;
+     *end = first + p->chunk < p->end ? first + p->chunk : p->end;
+     return 1;
+ }
+
+ /**
+  * Stop and join the threads; also after a failed pool_start()
+  */
+ void pool_close(struct pool *p) {
+     pthread_mutex_lock(&p->lock);
+     p->quit = 1;
+     pthread_cond_broadcast(&p->start);
+     pthread_mutex_unlock(&p->lock);
+     for (unsigned i = 1; i <= p->started; i++) {
+         pthread_join(p->thread[i].thread, NULL);
+     }
+     p->started = 0;
+     pthread_cond_destroy(&p->done);
+     pthread_cond_destroy(&p->start);
+     pthread_mutex_destroy(&p->lock);
+ }
+
+ static char *top_at(const struct top_heap *h, size_t i) {
+     return h->data + i * h->elem;
+ }
+
+ /**
+  * Move e down from the root of the first n entries to its place
+  */
+ static void sift_down(struct top_heap *h, size_t n, const void *e) {
+     size_t i = 0;
+
+     for (;;) {
+         size_t child = 2 * i + 1;
+         if (child >= n) break;
+         if (child + 1 < n && h->less(top_at(h, child + 1), top_at(h, child))) child++;
+         if (!h->less(top_at(h, child), e)) break;
+         memcpy(top_at(h, i), top_at(h, child), h->elem);
+         i = child;
+     }
+     memcpy(top_at(h, i), e, h->elem);
+ }
+
+ /**
+  * Allocate a heap keeping the size largest entries of elem bytes
+  * Returns 0, or -1 when it could not be allocated
+  */
+ int top_init(struct top_heap *h, size_t size, size_t elem, int (*less)(const void *, const void *)) {
+     h->data = calloc(size + 1, elem);
+     h->count = 0;
+     h->size = size;
+     h->elem = elem;
+     h->less = less;
+     return h->data != NULL ? 0 : -1;
+ }
+
+ /**
+  * Offer an entry, kept when the heap has room or it beats the smallest
+  */
+ void top_offer(struct top_heap *h, const void *e) {
+     if (h->count < h->size) {
+         /* Sift up */
+         size_t i = h->count++;
+         while (i > 0 && h->less(e, top_at(h, (i - 1) / 2))) {
+             memcpy(top_at(h, i), top_at(h, (i - 1) / 2), h->elem);
+             i = (i - 1) / 2;
+         }
+         memcpy(top_at(h, i), e, h->elem);
+         return;
+     }
+     if (h->size > 0 && h->less(top_at(h, 0), e)) {
+         sift_down(h, h->count, e);
+     }
+ }
+
+ /**
+  * Sort the entries in place, largest first; the heap order is lost until
+  * count is reset
+  */
+ void top_sort(struct top_heap *h) {
+     char *scratch = top_at(h, h->size);
+
+     for (size_t n = h->count; n > 1; n--) {
+         memcpy(scratch, top_at(h, n - 1), h->elem);
+         memcpy(top_at(h, n - 1), top_at(h, 0), h->elem);
+         sift_down(h, n - 1, scratch);
+     }
+ }
+
+ void top_free(struct top_heap *h) {
+     free(h->data);
+     h->data = NULL;
+     h->count = h->size = 0;
+ }
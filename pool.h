@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_POOL_H
+ #define FREE_POOL_H
+
+ #include <pthread.h>
+ #include <stdatomic.h>
+ #include <stddef.h>
+ #include <stdint.h>
+
+ /*
+  * Worker pool and top-n selection shared by --top, --cgroup-top and --merge
+  *
+  * A pool keeps up to POOL_MAX_WORKERS - 1 threads parked between runs; the
+  * caller is worker 0. pool_run() hands out a range of items, which every
+  * worker claims a chunk at a time with pool_claim() until none are left,
+  * and returns once all of them are done. A range of POOL_WAKE_CHUNKS chunks
+  * or less is not worth waking the threads for and is run by the caller.
+  *
+  * A top heap is a min-heap that keeps the size largest entries offered to
+  * it, allocated once; each worker fills its own and the caller merges them.
+  */
+
+ #define POOL_MAX_WORKERS 8
+ #define POOL_WAKE_CHUNKS 4
+
+ /* Claims and processes items, on every worker of a run */
+ typedef void (*pool_job)(void *ctx, unsigned worker);
+
+ struct pool;
+
+ struct pool_thread {
+     struct pool *pool;
+     unsigned index;
+     pthread_t thread;
+ };
+
+ struct pool {
+     unsigned workers;               /* Including the calling thread */
+     unsigned started;               /* Pool threads running */
+     size_t chunk;                   /* Items claimed at a time */
+     pool_job job;
+     void *ctx;
+
+     /* Items of the current run */
+     _Atomic size_t next;            /* First unclaimed item */
+     size_t end;
+
+     /* Hand-off */
+     pthread_mutex_t lock;
+     pthread_cond_t start;
+     pthread_cond_t done;
+     uint64_t generation;
+     unsigned running;
+     int quit;
+
+     struct pool_thread thread[POOL_MAX_WORKERS];
+ };
+
+ /* Bounded min-heap of fixed-size entries, ordered by less */
+ struct top_heap {
+     char *data;                     /* size entries and one of scratch */
+     size_t count;
+     size_t size;
+     size_t elem;
+     int (*less)(const void *a, const void *b);
+ };
+
+ void pool_init(struct pool *p, unsigned workers, size_t chunk, pool_job job, void *ctx);
+ int pool_start(struct pool *p);
+ void pool_run(struct pool *p, size_t begin, size_t end);
+ int pool_claim(struct pool *p, size_t *begin, size_t *end);
+ void pool_close(struct pool *p);
+
+ int top_init(struct top_heap *h, size_t size, size_t elem, int (*less)(const void *, const void *));
+ void top_offer(struct top_heap *h, const void *e);
+ void top_sort(struct top_heap *h);
+ void top_free(struct top_heap *h);
+
+ #endif /* FREE_POOL_H */
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "pressure.h"
+
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <limits.h>
+ #include <poll.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <unistd.h>
+
+ #ifdef __APPLE__
+ #include <dispatch/dispatch.h>
+ #endif
+
+ #include "hook.h"
+
+ #define PSI_PATH "/proc/pressure/memory"
+ #define PSI_BUFFER_SIZE 256
+
+ #ifdef __APPLE__
+ /**
+  * Dispatch event handler: note the level and wake the waiting loop
+  */
+ static void pressure_event(void *ctx) {
+     struct pressure *p = ctx;
+     unsigned long data = dispatch_source_get_data((dispatch_source_t)p->source);
+     char c = 1;
+
+     atomic_store(&p->kernel_level, (data & DISPATCH_MEMORYPRESSURE_CRITICAL) ? PRESSURE_CRITICAL :
+                                    (data & DISPATCH_MEMORYPRESSURE_WARN) ? PRESSURE_WARN : PRESSURE_NORMAL);
+     if (write(p->wake_fd, &c, 1) < 0) {
+         /* Pipe full: a wake-up is already pending */
+     }
+ }
+ #endif
+
+ /**
+  * Register for pressure notifications, threshold being the share of the
+  * window in percent that tasks may stall before a PSI trigger fires; root
+  * is prepended to /proc paths, as with --fixture
+  * Returns PRESSURE_OK, or PRESSURE_ERR_UNAVAILABLE when the caller has to
+  * poll; the level can still be read then
+  */
+ int pressure_open(struct pressure *p, double threshold, const char *root) {
+     memset(p, 0, sizeof(*p));
+     p->fd = -1;
+     p->psi_fd = -1;
+     p->wake_fd = -1;
+     p->threshold = threshold;
+
+ #ifdef __APPLE__
+     int fds[2];
+     (void)root;
+     if (pipe(fds) != 0) {
+         return PRESSURE_ERR_UNAVAILABLE;
+     }
+     p->fd = fds[0];
+     p->wake_fd = fds[1];
+     for (int i = 0; i < 2; i++) {
+         fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+         fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+     }
+
+     dispatch_source_t source = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+         DISPATCH_MEMORYPRESSURE_NORMAL | DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+         dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+     if (source == NULL) {
+         pressure_close(p);
+         return PRESSURE_ERR_UNAVAILABLE;
+     }
+     dispatch_set_context(source, p);
+     dispatch_source_set_event_handler_f(source, pressure_event);
+     dispatch_resume(source);
+     p->source = source;
+     return PRESSURE_OK;
+ #else
+     char path[PATH_MAX], trigger[64];
+
+     int n = snprintf(path, sizeof(path), "%s%s", root ? root : "", PSI_PATH);
+     if (n < 0 || (size_t)n >= sizeof(path)) {
+         return PRESSURE_ERR_UNAVAILABLE;
+     }
+     p->psi_fd = open(path, O_RDONLY | O_CLOEXEC);
+     if (p->psi_fd < 0) {
+         return PRESSURE_ERR_UNAVAILABLE;
+     }
+
+     /* Fixture files are only read, a trigger needs the kernel's file */
+     if (root != NULL) {
+         return PRESSURE_ERR_UNAVAILABLE;
+     }
+
+     /* The trigger lives as long as the descriptor it was written to */
+     unsigned long long stall_us = (unsigned long long)(threshold / 100.0 * PRESSURE_WINDOW_US);
+     n = snprintf(trigger, sizeof(trigger), "some %llu %llu", stall_us > 0 ? stall_us : 1,
+                  (unsigned long long)PRESSURE_WINDOW_US);
+     p->fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+     if (p->fd < 0 || write(p->fd, trigger, (size_t)n + 1) < 0) {
+         if (p->fd >= 0) close(p->fd);
+         p->fd = -1;
+         return PRESSURE_ERR_UNAVAILABLE;
+     }
+     return PRESSURE_OK;
+ #endif
+ }
+
+ /**
+  * Block until a notification arrives, timeout_ns passes (0 waits for a
+  * notification only) or *stop is set; *notified tells which
+  * Without notifications this sleeps for the timeout
+  * Returns PRESSURE_OK or PRESSURE_ERR_WAIT
+  */
+ int pressure_wait(struct pressure *p, uint64_t timeout_ns, volatile const sig_atomic_t *stop, int *notified) {
+     uint64_t deadline = timeout_ns > 0 ? sched_now_ns() + timeout_ns : 0;
+
+     *notified = 0;
+     if (p->fd < 0) {
+         sched_sleep_until(deadline, stop);
+         return PRESSURE_OK;
+     }
+
+     for (;;) {
+         int wait_ms = -1;
+         if (stop != NULL && *stop) {
+             return PRESSURE_OK;
+         }
+         if (deadline > 0) {
+             uint64_t now = sched_now_ns();
+             if (now >= deadline) {
+                 return PRESSURE_OK;
+             }
+             wait_ms = (int)((deadline - now + 999999) / 1000000);
+         }
+
+         /* PSI triggers signal POLLPRI, the wake-up pipe POLLIN */
+         struct pollfd pfd = {p->fd, p->wake_fd >= 0 ? POLLIN : POLLPRI, 0};
+         int ret = poll(&pfd, 1, wait_ms);
+         if (ret < 0) {
+             if (errno == EINTR) continue;
+             return PRESSURE_ERR_WAIT;
+         }
+         if (ret == 0) {
+             continue;
+         }
+         if (pfd.revents & (POLLERR | POLLNVAL)) {
+             errno = EIO;
+             return PRESSURE_ERR_WAIT;
+         }
+         if (p->wake_fd >= 0) {
+             char drain[64];
+             while (read(p->fd, drain, sizeof(drain)) > 0) {}
+         }
+         *notified = 1;
+         return PRESSURE_OK;
+     }
+ }
+
+ /**
+  * Read the avg10 stall percentages of /proc/pressure/memory
+  */
+ static int read_psi(struct pressure *p) {
+     char buf[PSI_BUFFER_SIZE];
+
+     ssize_t n = pread(p->psi_fd, buf, sizeof(buf) - 1, 0);
+     if (n <= 0) {
+         return -1;
+     }
+     buf[n] = '\0';
+
+     const char *some = strstr(buf, "some avg10=");
+     const char *full = strstr(buf, "full avg10=");
+     if (some == NULL) {
+         return -1;
+     }
+     p->some_avg10 = strtod(some + 11, NULL);
+     p->full_avg10 = full ? strtod(full + 11, NULL) : 0.0;
+     return 0;
+ }
+
+ /**
+  * Current pressure level: the kernel's on macOS, the PSI averages against
+  * the threshold on Linux, a notification counting as at least a warning,
+  * and available memory when neither can be read
+  */
+ int pressure_level(struct pressure *p, const struct mem_values *mv, int notified) {
+     if (p->source != NULL) {
+         return atomic_load(&p->kernel_level);
+     }
+     if (p->psi_fd >= 0 && read_psi(p) == 0) {
+         if (p->full_avg10 >= p->threshold) return PRESSURE_CRITICAL;
+         if (p->some_avg10 >= p->threshold || notified) return PRESSURE_WARN;
+         return PRESSURE_NORMAL;
+     }
+
+     if (mv->total == 0) {
+         return PRESSURE_NORMAL;
+     }
+     unsigned long long available = mv->available * 100 / mv->total;
+     if (available < PRESSURE_FALLBACK_CRITICAL) return PRESSURE_CRITICAL;
+     if (available < PRESSURE_FALLBACK_WARN) return PRESSURE_WARN;
+     return PRESSURE_NORMAL;
+ }
+
+ /**
+  * Start command with /bin/sh, the level and memory values in FREE_PRESSURE
+  * and FREE_TOTAL, FREE_USED, FREE_FREE, FREE_CACHED, FREE_AVAILABLE (bytes)
+  * Returns 0, or -1 with errno set
+  */
+ int pressure_hook(const char *command, int level, const struct mem_values *mv) {
+     char vars[6][HOOK_VAR_SIZE];
+
+     snprintf(vars[0], sizeof(vars[0]), "FREE_PRESSURE=%s", pressure_level_name(level));
+     snprintf(vars[1], sizeof(vars[1]), "FREE_TOTAL=%llu", mv->total);
+     snprintf(vars[2], sizeof(vars[2]), "FREE_USED=%llu", mv->used);
+     snprintf(vars[3], sizeof(vars[3]), "FREE_FREE=%llu", mv->free);
+     snprintf(vars[4], sizeof(vars[4]), "FREE_CACHED=%llu", mv->cached);
+     snprintf(vars[5], sizeof(vars[5]), "FREE_AVAILABLE=%llu", mv->available);
+     return hook_run(command, vars, 6);
+ }
+
+ void pressure_close(struct pressure *p) {
+ #ifdef __APPLE__
+     if (p->source != NULL) {
+         dispatch_source_cancel((dispatch_source_t)p->source);
+         dispatch_release((dispatch_source_t)p->source);
+         p->source = NULL;
+     }
+ #endif
+     if (p->fd >= 0) close(p->fd);
+     if (p->psi_fd >= 0) close(p->psi_fd);
+     if (p->wake_fd >= 0) close(p->wake_fd);
+     p->fd = p->psi_fd = p->wake_fd = -1;
+ }
+
+ const char *pressure_level_name(int level) {
+     switch (level) {
+         case PRESSURE_NORMAL: return "normal";
+         case PRESSURE_WARN: return "warn";
+         case PRESSURE_CRITICAL: return "critical";
+         default: return "unknown";
+     }
+ }
+
+ /**
+  * Message for a PRESSURE_* status
+  */
+ const char *pressure_strerror(int status) {
+     switch (status) {
+         case PRESSURE_OK: return "success";
+         case PRESSURE_ERR_UNAVAILABLE: return "memory pressure notifications unavailable";
+         case PRESSURE_ERR_WAIT: return "waiting for memory pressure notifications failed";
+         default: return "unknown memory pressure error";
+     }
+ }
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_PRESSURE_H
+ #define FREE_PRESSURE_H
+
+ #include <signal.h>
+ #include <stdatomic.h>
+ #include <stdint.h>
+
+ #include "sample.h"
+
+ /*
+  * Memory pressure notifications
+  *
+  * On Linux a PSI trigger on /proc/pressure/memory makes poll() return once
+  * tasks stall on memory for more than the threshold share of a window; the
+  * level comes from the avg10 stall averages. On macOS a dispatch
+  * memory-pressure source reports the kernel's own levels through a pipe.
+  * Without either, the caller polls at a low rate and the level is judged
+  * from available memory.
+  */
+
+ #define PRESSURE_DEFAULT_THRESHOLD 10.0     /* Percent of the window stalled */
+ #define PRESSURE_WINDOW_US 2000000ULL       /* Unprivileged triggers need a multiple of 2 s */
+ #define PRESSURE_FALLBACK_SECONDS 10.0
+ #define PRESSURE_FALLBACK_WARN 20           /* Percent of memory still available */
+ #define PRESSURE_FALLBACK_CRITICAL 5
+
+ typedef enum {
+     PRESSURE_NORMAL = 0,
+     PRESSURE_WARN,
+     PRESSURE_CRITICAL
+ } PressureLevel;
+
+ /* Status codes of pressure_open() and pressure_wait() */
+ typedef enum {
+     PRESSURE_OK = 0,
+     PRESSURE_ERR_UNAVAILABLE,   /* No notifications, poll instead */
+     PRESSURE_ERR_WAIT           /* poll() failed */
+ } PressureStatus;
+
+ struct pressure {
+     int fd;                     /* PSI trigger, or read end of the wake-up pipe; -1 when polling */
+     int psi_fd;                 /* PSI averages, also readable without a trigger */
+     int wake_fd;                /* Write end of the wake-up pipe (macOS) */
+     void *source;               /* Dispatch source (macOS) */
+     _Atomic int kernel_level;   /* Last level the dispatch source reported */
+     double threshold;
+     double some_avg10;          /* Last PSI averages read, percent */
+     double full_avg10;
+ };
+
+ int pressure_open(struct pressure *p, double threshold, const char *root);
+ int pressure_wait(struct pressure *p, uint64_t timeout_ns, volatile const sig_atomic_t *stop, int *notified);
+ int pressure_level(struct pressure *p, const struct mem_values *mv, int notified);
+ int pressure_hook(const char *command, int level, const struct mem_values *mv);
+ void pressure_close(struct pressure *p);
+ const char *pressure_level_name(int level);
+ const char *pressure_strerror(int status);
+
+ #endif /* FREE_PRESSURE_H */
@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "procs.h"
+
+ #include <fcntl.h>
+ #include <limits.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <unistd.h>
+
+ #ifdef __APPLE__
+ #include <libproc.h>
+ #include <sys/resource.h>
+ #else
+ #include <dirent.h>
+ #endif
+
+ /**
+  * Heap order: smaller resident size first, the higher PID losing ties
+  */
+ static int proc_less(const void *a, const void *b) {
+     const struct proc_info *x = a, *y = b;
+     return x->resident < y->resident || (x->resident == y->resident && x->pid > y->pid);
+ }
+
+ #ifdef __APPLE__
+ /**
+  * List every PID into ps->pids
+  */
+ static int list_pids(struct proc_scan *ps) {
+     int n = proc_listallpids(NULL, 0);
+     if (n <= 0) {
+         return PROCS_ERR_OPEN;
+     }
+
+     /* Leave room for processes started between the two calls */
+     size_t want = (size_t)n + (size_t)n / 8 + 16;
+     if (want > ps->pids_size) {
+         int *pids = realloc(ps->pids, want * sizeof(*pids));
+         if (pids == NULL) {
+             return PROCS_ERR_NOMEM;
+         }
+         ps->pids = pids;
+         ps->pids_size = want;
+     }
+     n = proc_listallpids(ps->pids, (int)(ps->pids_size * sizeof(*ps->pids)));
+     if (n <= 0) {
+         return PROCS_ERR_OPEN;
+     }
+     ps->npids = (size_t)n;
+     return PROCS_OK;
+ }
+
+ /**
+  * Resident size and footprint of one process from proc_pid_rusage()
+  * Returns 0, or -1 when the process is gone or not ours to inspect
+  */
+ static int read_resident(struct proc_scan *ps, struct proc_worker *w, int pid, struct proc_info *e) {
+     struct rusage_info_v2 ri;
+
+     (void)ps;
+     (void)w;
+     if (proc_pid_rusage(pid, RUSAGE_INFO_V2, (rusage_info_t *)&ri) != 0) {
+         return -1;
+     }
+     e->pid = pid;
+     e->resident = ri.ri_resident_size;
+     e->footprint = ri.ri_phys_footprint;
+     e->name[0] = '\0';
+     return 0;
+ }
+
+ static void read_details(struct proc_scan *ps, struct proc_info *e) {
+     (void)ps;
+     if (proc_name(e->pid, e->name, sizeof(e->name)) <= 0) {
+         snprintf(e->name, sizeof(e->name), "?");
+     }
+ }
+ #else
+ /**
+  * List the numeric entries of /proc into ps->pids
+  */
+ static int list_pids(struct proc_scan *ps) {
+     struct dirent *de;
+
+     rewinddir(ps->dir);
+     ps->npids = 0;
+     while ((de = readdir(ps->dir)) != NULL) {
+         if (de->d_name[0] < '1' || de->d_name[0] > '9') {
+             continue;
+         }
+         if (ps->npids == ps->pids_size) {
+             size_t size = ps->pids_size ? ps->pids_size * 2 : 1024;
+             int *pids = realloc(ps->pids, size * sizeof(*pids));
+             if (pids == NULL) {
+                 return PROCS_ERR_NOMEM;
+             }
+             ps->pids = pids;
+             ps->pids_size = size;
+         }
+         ps->pids[ps->npids++] = atoi(de->d_name);
+     }
+     return PROCS_OK;
+ }
+
+ /**
+  * Read /proc/<pid>/<file> into buf, NUL-terminated
+  * Returns the length, or -1 when the process is gone
+  */
+ static ssize_t read_proc_file(struct proc_scan *ps, int pid, const char *file, char *buf, size_t size) {
+     char path[32];
+
+     snprintf(path, sizeof(path), "%d/%s", pid, file);
+     int fd = openat(ps->dir_fd, path, O_RDONLY | O_CLOEXEC);
+     if (fd < 0) {
+         return -1;
+     }
+     ssize_t n = read(fd, buf, size - 1);
+     close(fd);
+     if (n < 0) {
+         return -1;
+     }
+     buf[n] = '\0';
+     return n;
+ }
+
+ /**
+  * Resident size of one process, the second field of /proc/<pid>/statm
+  * Returns 0, or -1 when the process is gone
+  */
+ static int read_resident(struct proc_scan *ps, struct proc_worker *w, int pid, struct proc_info *e) {
+     char *end;
+
+     if (read_proc_file(ps, pid, "statm", w->buf, sizeof(w->buf)) <= 0) {
+         return -1;
+     }
+     strtoull(w->buf, &end, 10);
+     unsigned long long pages = strtoull(end, &end, 10);
+     e->pid = pid;
+     e->resident = pages * ps->page_size;
+     e->footprint = 0;
+     e->name[0] = '\0';
+     return 0;
+ }
+
+ /**
+  * Value in bytes of a "Key:   n kB" line of /proc/<pid>/status
+  */
+ static uint64_t status_kb(const char *buf, const char *key) {
+     const char *p = strstr(buf, key);
+     return p ? strtoull(p + strlen(key), NULL, 10) * 1024 : 0;
+ }
+
+ /**
+  * Name and footprint, anonymous resident plus swapped, from /proc/<pid>/status
+  */
+ static void read_details(struct proc_scan *ps, struct proc_info *e) {
+     char *buf = ps->worker[0].buf;
+
+     if (read_proc_file(ps, e->pid, "status", buf, sizeof(ps->worker[0].buf)) <= 0) {
+         snprintf(e->name, sizeof(e->name), "?");
+         return;
+     }
+     const char *name = strncmp(buf, "Name:", 5) == 0 ? buf + 5 : "?";
+     while (*name == '\t' || *name == ' ') name++;
+     size_t len = strcspn(name, "\n");
+     if (len >= sizeof(e->name)) len = sizeof(e->name) - 1;
+     memcpy(e->name, name, len);
+     e->name[len] = '\0';
+     e->footprint = status_kb(buf, "\nRssAnon:") + status_kb(buf, "\nVmSwap:");
+ }
+ #endif
+
+ /**
+  * Pool job: claim chunks of the PID list until none are left
+  */
+ static void scan_chunks(void *ctx, unsigned worker) {
+     struct proc_scan *ps = ctx;
+     struct proc_worker *w = &ps->worker[worker];
+     struct proc_info e;
+     size_t begin, end;
+
+     while (pool_claim(&ps->pool, &begin, &end)) {
+         for (size_t i = begin; i < end; i++) {
+             if (read_resident(ps, w, ps->pids[i], &e) == 0) {
+                 top_offer(&w->heap, &e);
+             }
+         }
+     }
+ }
+
+ /**
+  * Prepare to report the top largest processes with up to workers threads,
+  * the caller's included; root is prepended to /proc, as with --fixture
+  * All memory is allocated here, except the PID list, which grows with the
+  * number of processes
+  */
+ int procs_open(struct proc_scan *ps, unsigned top, unsigned workers, const char *root) {
+     memset(ps, 0, sizeof(*ps));
+     ps->dir_fd = -1;
+     ps->top = top;
+     pool_init(&ps->pool, workers, PROCS_CHUNK, scan_chunks, ps);
+
+     long page = sysconf(_SC_PAGESIZE);
+     ps->page_size = page > 0 ? (uint64_t)page : 4096;
+
+ #ifdef __APPLE__
+     (void)root;
+ #else
+     char path[PATH_MAX];
+     int n = snprintf(path, sizeof(path), "%s/proc", root ? root : "");
+     if (n < 0 || (size_t)n >= sizeof(path) || (ps->dir = opendir(path)) == NULL) {
+         return PROCS_ERR_OPEN;
+     }
+     ps->dir_fd = dirfd(ps->dir);
+ #endif
+
+     ps->worker = calloc(ps->pool.workers, sizeof(*ps->worker));
+     if (ps->worker == NULL || top_init(&ps->best, top, sizeof(struct proc_info), proc_less) != 0) {
+         return PROCS_ERR_NOMEM;
+     }
+     ps->result = (struct proc_info *)ps->best.data;
+     for (unsigned i = 0; i < ps->pool.workers; i++) {
+         if (top_init(&ps->worker[i].heap, top, sizeof(struct proc_info), proc_less) != 0) {
+             return PROCS_ERR_NOMEM;
+         }
+     }
+     return pool_start(&ps->pool) == 0 ? PROCS_OK : PROCS_ERR_THREAD;
+ }
+
+ /**
+  * List the processes and select the largest into ps->result, largest first
+  * Returns PROCS_OK or a PROCS_ERR_* code
+  */
+ int procs_scan(struct proc_scan *ps) {
+     int status = list_pids(ps);
+     if (status != PROCS_OK) {
+         return status;
+     }
+
+     for (unsigned i = 0; i < ps->pool.workers; i++) {
+         ps->worker[i].heap.count = 0;
+     }
+     pool_run(&ps->pool, 0, ps->npids);
+
+     /* Merge the workers' heaps; only the winners are sorted and detailed */
+     ps->best.count = 0;
+     for (unsigned i = 0; i < ps->pool.workers; i++) {
+         const struct proc_info *heap = (const struct proc_info *)ps->worker[i].heap.data;
+         for (size_t j = 0; j < ps->worker[i].heap.count; j++) {
+             top_offer(&ps->best, &heap[j]);
+         }
+     }
+     top_sort(&ps->best);
+     ps->nresult = ps->best.count;
+     for (size_t i = 0; i < ps->nresult; i++) {
+         read_details(ps, &ps->result[i]);
+     }
+     return PROCS_OK;
+ }
+
+ /**
+  * Render the --top process list from entry first on, as a table below the
+  * frame or as one "Top:" line after it
+  * Stops while the buffer still has room for another entry, so a long list
+  * is written in several pieces; returns the index of the next entry, n
+  * once the list is complete
+  */
+ size_t procs_render(struct outbuf *ob, const struct render_opts *opts, const struct proc_info *procs,
+                    size_t n, size_t first) {
+     char pid[16], resident[MEMORY_STRING_BUFFER_SIZE], footprint[MEMORY_STRING_BUFFER_SIZE];
+     size_t i = first;
+
+     if (first == 0) {
+         if (opts->line) {
+             outbuf_puts(ob, "Top:");
+         } else {
+             outbuf_pad(ob, "PID", 7);
+             outbuf_append(ob, " ", 1);
+             outbuf_pad(ob, "resident", 11);
+             outbuf_append(ob, " ", 1);
+             outbuf_pad(ob, "footprint", 11);
+             outbuf_puts(ob, "  command\n");
+         }
+     }
+     for (; i < n && sizeof(ob->data) - ob->len > 2 * PROCS_NAME_SIZE + 64; i++) {
+         const struct proc_info *p = &procs[i];
+         snprintf(pid, sizeof(pid), "%d", p->pid);
+         if (formatBytes(p->resident, resident, sizeof(resident), opts->human, opts->si, opts->unit) < 0) {
+             snprintf(resident, sizeof(resident), "?");
+         }
+         if (formatBytes(p->footprint, footprint, sizeof(footprint), opts->human, opts->si, opts->unit) < 0) {
+             snprintf(footprint, sizeof(footprint), "?");
+         }
+         if (opts->line) {
+             outbuf_puts(ob, i == 0 ? " " : ", ");
+             outbuf_puts(ob, p->name);
+             outbuf_append(ob, "[", 1);
+             outbuf_puts(ob, pid);
+             outbuf_puts(ob, "] ");
+             outbuf_puts(ob, resident);
+         } else {
+             outbuf_pad(ob, pid, 7);
+             outbuf_append(ob, " ", 1);
+             outbuf_pad(ob, resident, 11);
+             outbuf_append(ob, " ", 1);
+             outbuf_pad(ob, footprint, 11);
+             outbuf_puts(ob, "  ");
+             outbuf_puts(ob, p->name);
+             outbuf_append(ob, "\n", 1);
+         }
+     }
+     if (i == n && opts->line) {
+         outbuf_append(ob, "\n", 1);
+     }
+     return i;
+ }
+
+ void procs_close(struct proc_scan *ps) {
+     pool_close(&ps->pool);
+     if (ps->worker != NULL) {
+         for (unsigned i = 0; i < ps->pool.workers; i++) {
+             top_free(&ps->worker[i].heap);
+         }
+         free(ps->worker);
+         ps->worker = NULL;
+     }
+     top_free(&ps->best);
+     free(ps->pids);
+     ps->result = NULL;
+     ps->pids = NULL;
+ #ifndef __APPLE__
+     if (ps->dir != NULL) {
+         closedir(ps->dir);
+         ps->dir = NULL;
+     }
+ #endif
+ }
+
+ /**
+  * Message for a PROCS_* status
+  */
+ const char *procs_strerror(int status) {
+     switch (status) {
+         case PROCS_OK: return "success";
+         case PROCS_ERR_OPEN: return "cannot list processes";
+         case PROCS_ERR_NOMEM: return "cannot allocate the process list";
+         case PROCS_ERR_THREAD: return "cannot start the process scan workers";
+         default: return "unknown process scan error";
+     }
+ }
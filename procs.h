@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_PROCS_H
+ #define FREE_PROCS_H
+
+ #include <stddef.h>
+ #include <stdint.h>
+
+ #include "pool.h"
+ #include "render.h"
+
+ /*
+  * Largest processes by resident memory
+  *
+  * PIDs are listed once per scan, then a small pool of workers claims them
+  * in chunks. Each worker reads the resident size of its PIDs into its own
+  * buffer and keeps its n largest in a min-heap, so nothing is allocated
+  * per process and nothing is sorted but the final n. Details such as the
+  * footprint and name are only read for those n.
+  */
+
+ #define PROCS_MAX_TOP 1000
+ #define PROCS_MAX_WORKERS POOL_MAX_WORKERS
+ #define PROCS_CHUNK 64              /* PIDs a worker claims at a time */
+ #define PROCS_READ_SIZE 4096
+ #define PROCS_NAME_SIZE 32
+
+ /* Status codes of the process scanner */
+ typedef enum {
+     PROCS_OK = 0,
+     PROCS_ERR_OPEN,         /* Processes could not be listed */
+     PROCS_ERR_NOMEM,        /* Could not allocate the PID list or heaps */
+     PROCS_ERR_THREAD        /* Could not start a worker */
+ } ProcsStatus;
+
+ struct proc_info {
+     int pid;
+     uint64_t resident;              /* Bytes */
+     uint64_t footprint;             /* Bytes of private memory, resident or swapped */
+     char name[PROCS_NAME_SIZE];
+ };
+
+ struct proc_worker {
+     struct top_heap heap;           /* The largest, top entries this worker saw */
+     char buf[PROCS_READ_SIZE];
+ };
+
+ struct proc_scan {
+     unsigned top;
+     uint64_t page_size;
+     void *dir;                      /* Open /proc directory (Linux) */
+     int dir_fd;
+
+     /* PID list of the current scan, grown but never shrunk */
+     int *pids;
+     size_t npids;
+     size_t pids_size;
+
+     struct pool pool;               /* Claims the PID list PROCS_CHUNK at a time */
+     struct proc_worker *worker;     /* One per pool worker */
+     struct top_heap best;           /* The workers' heaps merged */
+     struct proc_info *result;       /* Largest first after procs_scan() */
+     size_t nresult;
+ };
+
+ int procs_open(struct proc_scan *ps, unsigned top, unsigned workers, const char *root);
+ int procs_scan(struct proc_scan *ps);
+ size_t procs_render(struct outbuf *ob, const struct render_opts *opts, const struct proc_info *procs,
+                    size_t n, size_t first);
+ void procs_close(struct proc_scan *ps);
+ const char *procs_strerror(int status);
+
+ #endif /* FREE_PROCS_H */
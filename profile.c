@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "profile.h"
+
+ #include <stdio.h>
+ #include <sys/resource.h>
+ #include <sys/time.h>
+
+ #include "sched.h"
+
+ static double tv_seconds(const struct timeval *tv) {
+     return (double)tv->tv_sec + (double)tv->tv_usec / 1e6;
+ }
+
+ /**
+  * Name the stages, the kernel calls after the collector's backend, and
+  * note the CPU time spent starting up
+  */
+ void profile_init(struct profile *prof, const struct collector *col) {
+     struct rusage ru;
+
+     prof->start_ns = sched_now_ns();
+     prof->start_cpu = getrusage(RUSAGE_SELF, &ru) == 0 ? tv_seconds(&ru.ru_utime) + tv_seconds(&ru.ru_stime) : 0;
+     prof->names[PROFILE_ITERATION] = "iteration";
+     prof->names[PROFILE_COLLECT] = "collect";
+     for (int call = 0; call < COLLECT_CALLS; call++) {
+         prof->names[PROFILE_CALL + call] = collect_call_name(col, call);
+     }
+     prof->names[PROFILE_OUTPUT] = "output";
+     prof->names[PROFILE_RENDER] = "render";
+     prof->names[PROFILE_WRITE] = "write";
+     prof->names[PROFILE_TOP] = "process scan";
+ }
+
+ void profile_add(struct profile *prof, int stage, uint64_t start_ns, uint64_t end_ns) {
+     stats_series_add(&prof->stage[stage], end_ns > start_ns ? end_ns - start_ns : 0);
+ }
+
+ /**
+  * Add the kernel calls made by the last collect_sample()
+  */
+ void profile_add_calls(struct profile *prof, const struct collector *col) {
+     for (int call = 0; call < COLLECT_CALLS; call++) {
+         if (col->calls_made & (1u << call)) {
+             stats_series_add(&prof->stage[PROFILE_CALL + call], col->call_ns[call]);
+         }
+     }
+ }
+
+ static void outbuf_us(struct outbuf *ob, unsigned long long ns) {
+     char cell[MEMORY_STRING_BUFFER_SIZE];
+     snprintf(cell, sizeof(cell), "%.3fus", (double)ns / 1000.0);
+     outbuf_append(ob, " ", 1);
+     outbuf_pad(ob, cell, 12);
+ }
+
+ /**
+  * Render the p50/p99/max breakdown of every stage that ran, then the CPU
+  * time and peak resident size of the process; the CPU share is that of
+  * the run since profile_init()
+  * Returns RENDER_OK, or RENDER_ERR_OVERFLOW
+  */
+ int profile_render(struct outbuf *ob, const struct profile *prof) {
+     char cell[MEMORY_STRING_BUFFER_SIZE];
+
+     outbuf_pad(ob, "Stage", -34);
+     outbuf_pad(ob, "count", 10);
+     outbuf_puts(ob, "          p50          p99          max\n");
+     for (int i = 0; i < PROFILE_STAGES; i++) {
+         const struct stats_series *s = &prof->stage[i];
+         if (s->count == 0) {
+             continue;
+         }
+         snprintf(cell, sizeof(cell), "%llu", (unsigned long long)s->count);
+         outbuf_pad(ob, prof->names[i], -34);
+         outbuf_pad(ob, cell, 10);
+         outbuf_us(ob, stats_percentile(s, 50));
+         outbuf_us(ob, stats_percentile(s, 99));
+         outbuf_us(ob, s->max);
+         outbuf_append(ob, "\n", 1);
+     }
+
+     struct rusage ru;
+     if (getrusage(RUSAGE_SELF, &ru) == 0) {
+         double user = tv_seconds(&ru.ru_utime), sys = tv_seconds(&ru.ru_stime);
+         double wall = (double)(sched_now_ns() - prof->start_ns) / NSEC_PER_SEC;
+ #ifdef __APPLE__
+         unsigned long long rss = (unsigned long long)ru.ru_maxrss;
+ #else
+         unsigned long long rss = (unsigned long long)ru.ru_maxrss * 1024;
+ #endif
+         char line[160], rssStr[MEMORY_STRING_BUFFER_SIZE];
+         if (formatBytes(rss, rssStr, sizeof(rssStr), 1, 0, 1) < 0) {
+             snprintf(rssStr, sizeof(rssStr), "%llu B", rss);
+         }
+         double run = user + sys - prof->start_cpu;
+         snprintf(line, sizeof(line), "Self: %.3fs user, %.3fs system, %.2f%% CPU over %.3fs, max RSS %s\n",
+                  user, sys, wall > 0 && run > 0 ? run / wall * 100.0 : 0.0, wall, rssStr);
+         outbuf_puts(ob, line);
+     }
+     return ob->overflow ? RENDER_ERR_OVERFLOW : RENDER_OK;
+ }
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_PROFILE_H
+ #define FREE_PROFILE_H
+
+ #include <stdint.h>
+
+ #include "collect.h"
+ #include "render.h"
+ #include "stats.h"
+
+ /*
+  * Self-profiling of the sampling loop
+  *
+  * Each stage of an iteration is timed with the monotonic clock and the
+  * durations go into the same fixed-bucket histograms as --stats, so
+  * profiling a long run costs no allocation and constant memory. The kernel
+  * calls of the backend are taken from the collector's own call timing.
+  * Every stage has a single writer: the sampling loop, or the output thread
+  * for rendering and writing when the output is queued.
+  */
+
+ /* Stages of one iteration, rows of the profile */
+ typedef enum {
+     PROFILE_ITERATION,      /* Wake-up to the end of the iteration, waiting excluded */
+     PROFILE_COLLECT,        /* collect_sample() */
+     PROFILE_CALL,           /* Each kernel call, COLLECT_CALLS entries */
+     PROFILE_OUTPUT = PROFILE_CALL + COLLECT_CALLS,  /* Print, queue, record or publish the sample */
+     PROFILE_RENDER,         /* Derive and format a frame */
+     PROFILE_WRITE,          /* write() the frame */
+     PROFILE_TOP,            /* --top process scan */
+     PROFILE_STAGES
+ } ProfileStage;
+
+ struct profile {
+     uint64_t start_ns;
+     double start_cpu;               /* User and system seconds at profile_init() */
+     const char *names[PROFILE_STAGES];
+     struct stats_series stage[PROFILE_STAGES];
+ };
+
+ void profile_init(struct profile *prof, const struct collector *col);
+ void profile_add(struct profile *prof, int stage, uint64_t start_ns, uint64_t end_ns);
+ void profile_add_calls(struct profile *prof, const struct collector *col);
+ int profile_render(struct outbuf *ob, const struct profile *prof);
+
+ #endif /* FREE_PROFILE_H */
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "queue.h"
+
+ #include <stdlib.h>
+ #include <string.h>
+ #include <time.h>
+
+ #include "sched.h"
+
+ #define QUEUE_POLL_NS 100000000ULL  /* A blocked push re-checks the stop flag this often */
+
+ /**
+  * Wake the other side if it is parked; the caller's index store and this
+  * load are both sequentially consistent, so a side that saw no progress
+  * before parking is always seen waiting here
+  */
+ static void wake(struct sample_queue *q, _Atomic int *waiting, pthread_cond_t *cond) {
+     if (atomic_load(waiting)) {
+         pthread_mutex_lock(&q->lock);
+         pthread_cond_signal(cond);
+         pthread_mutex_unlock(&q->lock);
+     }
+ }
+
+ /**
+  * Writer thread: write samples in order until the queue is closed and empty
+  */
+ static void *writer_main(void *arg) {
+     struct sample_queue *q = arg;
+     uint64_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+     for (;;) {
+         if (tail == atomic_load_explicit(&q->head, memory_order_acquire)) {
+             pthread_mutex_lock(&q->lock);
+             atomic_store(&q->writer_waiting, 1);
+             while (tail == atomic_load(&q->head) && !atomic_load(&q->closed)) {
+                 pthread_cond_wait(&q->not_empty, &q->lock);
+             }
+             atomic_store(&q->writer_waiting, 0);
+             pthread_mutex_unlock(&q->lock);
+             if (tail == atomic_load(&q->head)) {
+                 break;
+             }
+         }
+
+         int ret = q->write(q->slots + (tail & q->mask) * q->elem, q->ctx);
+         atomic_store(&q->tail, ++tail);
+         if (ret != 0) {
+             q->status = ret;
+             atomic_store(&q->failed, 1);
+         }
+         wake(q, &q->loop_waiting, &q->not_full);
+         if (ret != 0) {
+             break;
+         }
+     }
+     return NULL;
+ }
+
+ /**
+  * Allocate a ring of size samples of elem bytes, rounded up to a power of
+  * two, and start the writer thread with signals blocked so they reach the
+  * sampling loop; SIGPIPE stays deliverable, a closed pipe ends the program
+  * as before
+  */
+ int queue_start(struct sample_queue *q, unsigned size, size_t elem, QueueOverflowPolicy policy,
+                 queue_writer write, void *ctx) {
+     uint64_t slots = 1;
+     sigset_t all, old;
+
+     memset(q, 0, sizeof(*q));
+     while (slots < size) slots <<= 1;
+     q->mask = slots - 1;
+     q->policy = policy;
+     q->elem = elem;
+     q->write = write;
+     q->ctx = ctx;
+     q->slots = calloc(slots, elem);
+     if (q->slots == NULL) {
+         return QUEUE_ERR_NOMEM;
+     }
+     pthread_mutex_init(&q->lock, NULL);
+     pthread_cond_init(&q->not_empty, NULL);
+     pthread_cond_init(&q->not_full, NULL);
+
+     sigfillset(&all);
+     sigdelset(&all, SIGPIPE);
+     pthread_sigmask(SIG_SETMASK, &all, &old);
+     int ret = pthread_create(&q->thread, NULL, writer_main, q);
+     pthread_sigmask(SIG_SETMASK, &old, NULL);
+     if (ret != 0) {
+         return QUEUE_ERR_THREAD;
+     }
+     q->started = 1;
+     return QUEUE_OK;
+ }
+
+ /**
+  * Copy a sample into the ring for the writer thread
+  * Returns QUEUE_OK, QUEUE_DROPPED when the queue is full under the drop
+  * policy or *stop was set while waiting, or QUEUE_ERR_WRITER
+  */
+ int queue_push(struct sample_queue *q, const void *sample, volatile const sig_atomic_t *stop) {
+     uint64_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+     if (atomic_load(&q->failed)) {
+         return QUEUE_ERR_WRITER;
+     }
+     if (head - atomic_load_explicit(&q->tail, memory_order_acquire) > q->mask) {
+         if (q->policy == QUEUE_OVERFLOW_DROP) {
+             q->dropped++;
+             return QUEUE_DROPPED;
+         }
+
+         /* Wait for a free slot, waking now and then to honour a stop request */
+         q->waits++;
+         pthread_mutex_lock(&q->lock);
+         atomic_store(&q->loop_waiting, 1);
+         while (head - atomic_load(&q->tail) > q->mask && !atomic_load(&q->failed) &&
+                !(stop != NULL && *stop)) {
+             struct timespec ts;
+             clock_gettime(CLOCK_REALTIME, &ts);
+             uint64_t ns = (uint64_t)ts.tv_nsec + QUEUE_POLL_NS;
+             ts.tv_sec += (time_t)(ns / NSEC_PER_SEC);
+             ts.tv_nsec = (long)(ns % NSEC_PER_SEC);
+             pthread_cond_timedwait(&q->not_full, &q->lock, &ts);
+         }
+         atomic_store(&q->loop_waiting, 0);
+         pthread_mutex_unlock(&q->lock);
+
+         if (atomic_load(&q->failed)) {
+             return QUEUE_ERR_WRITER;
+         }
+         if (head - atomic_load(&q->tail) > q->mask) {
+             q->dropped++;
+             return QUEUE_DROPPED;
+         }
+     }
+
+     memcpy(q->slots + (head & q->mask) * q->elem, sample, q->elem);
+     atomic_store(&q->head, head + 1);
+     uint64_t depth = head + 1 - atomic_load_explicit(&q->tail, memory_order_relaxed);
+     if (depth > q->max_depth) q->max_depth = depth;
+     wake(q, &q->writer_waiting, &q->not_empty);
+     return QUEUE_OK;
+ }
+
+ /**
+  * Let the writer thread drain what is queued, then stop it and free the ring
+  * Returns QUEUE_OK, or QUEUE_ERR_WRITER with the writer's return value in
+  * q->status
+  */
+ int queue_finish(struct sample_queue *q) {
+     if (q->started) {
+         pthread_mutex_lock(&q->lock);
+         atomic_store(&q->closed, 1);
+         pthread_cond_signal(&q->not_empty);
+         pthread_mutex_unlock(&q->lock);
+         pthread_join(q->thread, NULL);
+         q->started = 0;
+     }
+     if (q->slots != NULL) {
+         pthread_cond_destroy(&q->not_full);
+         pthread_cond_destroy(&q->not_empty);
+         pthread_mutex_destroy(&q->lock);
+         free(q->slots);
+         q->slots = NULL;
+     }
+     return atomic_load(&q->failed) ? QUEUE_ERR_WRITER : QUEUE_OK;
+ }
+
+ /**
+  * Message for a QUEUE_* status
+  */
+ const char *queue_strerror(int status) {
+     switch (status) {
+         case QUEUE_OK: return "success";
+         case QUEUE_DROPPED: return "output queue full, sample dropped";
+         case QUEUE_ERR_NOMEM: return "cannot allocate the output queue";
+         case QUEUE_ERR_THREAD: return "cannot start the output thread";
+         case QUEUE_ERR_WRITER: return "output failed";
+         default: return "unknown output queue error";
+     }
+ }
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_QUEUE_H
+ #define FREE_QUEUE_H
+
+ #include <pthread.h>
+ #include <signal.h>
+ #include <stdatomic.h>
+ #include <stddef.h>
+ #include <stdint.h>
+
+ /*
+  * Output queue
+  *
+  * The sampling loop pushes samples, raw counters or libfreemem snapshots
+  * of one fixed size, into a single-producer, single-consumer ring and a
+  * writer thread formats and prints them, so a
+  * slow pipe or a paused terminal cannot delay the next deadline. The ring
+  * indexes are atomics on separate cache lines; the mutex and condition
+  * variables are only used to park a side that has nothing to do.
+  */
+
+ #define QUEUE_DEFAULT_SIZE 1024
+ #define QUEUE_MAX_SIZE 65536
+ #define QUEUE_CACHE_LINE 64
+
+ /* What the sampling loop does when the writer is a full queue behind */
+ typedef enum {
+     QUEUE_OVERFLOW_BLOCK,   /* Wait for the writer, deadlines may be missed */
+     QUEUE_OVERFLOW_DROP     /* Drop the new sample and count it */
+ } QueueOverflowPolicy;
+
+ /* Status codes of the output queue */
+ typedef enum {
+     QUEUE_OK = 0,
+     QUEUE_DROPPED,          /* Queue full, the sample was dropped */
+     QUEUE_ERR_NOMEM,        /* Could not allocate the ring */
+     QUEUE_ERR_THREAD,       /* Could not start the writer thread */
+     QUEUE_ERR_WRITER        /* The writer stopped on an error */
+ } QueueStatus;
+
+ /* Called on the writer thread for each sample, non-zero stops the writer */
+ typedef int (*queue_writer)(const void *sample, void *ctx);
+
+ struct sample_queue {
+     /* Written by the sampling loop */
+     _Alignas(QUEUE_CACHE_LINE) _Atomic uint64_t head;       /* Samples pushed */
+     uint64_t dropped;
+     uint64_t waits;                 /* Pushes that had to wait for the writer */
+     uint64_t max_depth;
+
+     /* Written by the writer thread */
+     _Alignas(QUEUE_CACHE_LINE) _Atomic uint64_t tail;       /* Samples written */
+     _Atomic int failed;
+     int status;                     /* Return value of the writer that failed */
+
+     /* Parking */
+     _Alignas(QUEUE_CACHE_LINE) _Atomic int writer_waiting;
+     _Atomic int loop_waiting;
+     _Atomic int closed;
+     pthread_mutex_t lock;
+     pthread_cond_t not_empty;
+     pthread_cond_t not_full;
+
+     uint64_t mask;                  /* Slots - 1, slots is a power of two */
+     QueueOverflowPolicy policy;
+     char *slots;
+     size_t elem;                    /* Bytes per slot */
+     queue_writer write;
+     void *ctx;
+     pthread_t thread;
+     int started;
+ };
+
+ int queue_start(struct sample_queue *q, unsigned size, size_t elem, QueueOverflowPolicy policy,
+                 queue_writer write, void *ctx);
+ int queue_push(struct sample_queue *q, const void *sample, volatile const sig_atomic_t *stop);
+ int queue_finish(struct sample_queue *q);
+ const char *queue_strerror(int status);
+
+ #endif /* FREE_QUEUE_H */
@@ -0,0 +1,395 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "record.h"
+
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <string.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+
+ /* Counters stored per frame, in file order; only ever append to this list */
+ static const size_t record_fields[] = {
+     offsetof(struct mem_counters, page_size),
+     offsetof(struct mem_counters, mem_total),
+     offsetof(struct mem_counters, free_count),
+     offsetof(struct mem_counters, speculative_count),
+     offsetof(struct mem_counters, wire_count),
+     offsetof(struct mem_counters, internal_page_count),
+     offsetof(struct mem_counters, purgeable_count),
+     offsetof(struct mem_counters, external_page_count),
+     offsetof(struct mem_counters, swap_total),
+     offsetof(struct mem_counters, swap_used),
+     offsetof(struct mem_counters, swap_avail),
+     offsetof(struct mem_counters, commit_limit),
+     offsetof(struct mem_counters, committed),
+     offsetof(struct mem_counters, pageins),
+     offsetof(struct mem_counters, pageouts),
+     offsetof(struct mem_counters, faults),
+     offsetof(struct mem_counters, cow_faults),
+     offsetof(struct mem_counters, compressions),
+     offsetof(struct mem_counters, decompressions),
+     offsetof(struct mem_counters, swapins),
+     offsetof(struct mem_counters, swapouts),
+     offsetof(struct mem_counters, event_bits),
+     offsetof(struct mem_counters, event_page_size),
+     offsetof(struct mem_counters, compressor_page_count),
+     offsetof(struct mem_counters, reserve_count),
+     offsetof(struct mem_counters, available_count),
+     offsetof(struct mem_counters, available_known)
+ };
+
+ #define RECORD_FIELD_COUNT (sizeof(record_fields) / sizeof(record_fields[0]))
+
+ static uint64_t field_get(const struct mem_counters *c, size_t i) {
+     uint64_t value;
+     memcpy(&value, (const char *)c + record_fields[i], sizeof(value));
+     return value;
+ }
+
+ static void field_set(struct mem_counters *c, size_t i, uint64_t value) {
+     memcpy((char *)c + record_fields[i], &value, sizeof(value));
+ }
+
+ /* Map signed deltas to small unsigned values: 0, -1, 1, -2, ... */
+ static uint64_t zigzag(uint64_t delta) {
+     return (delta << 1) ^ (uint64_t)-(int64_t)(delta >> 63);
+ }
+
+ static uint64_t unzigzag(uint64_t value) {
+     return (value >> 1) ^ (uint64_t)-(int64_t)(value & 1);
+ }
+
+ /**
+  * Append an LEB128 varint, returns the new position
+  */
+ static size_t put_varint(unsigned char *buf, size_t pos, uint64_t value) {
+     while (value >= 0x80) {
+         buf[pos++] = (unsigned char)(value | 0x80);
+         value >>= 7;
+     }
+     buf[pos++] = (unsigned char)value;
+     return pos;
+ }
+
+ /**
+  * Read an LEB128 varint from [*pos, end), returns -1 if truncated or too long
+  */
+ static int get_varint(const unsigned char *buf, size_t *pos, size_t end, uint64_t *value) {
+     uint64_t result = 0;
+
+     for (int shift = 0; shift < 64 && *pos < end; shift += 7) {
+         unsigned char byte = buf[(*pos)++];
+         result |= (uint64_t)(byte & 0x7f) << shift;
+         if ((byte & 0x80) == 0) {
+             *value = result;
+             return 0;
+         }
+     }
+     return -1;
+ }
+
+ static int write_all(int fd, const unsigned char *buf, size_t len) {
+     while (len > 0) {
+         ssize_t n = write(fd, buf, len);
+         if (n < 0) {
+             if (errno == EINTR) continue;
+             return -1;
+         }
+         buf += n;
+         len -= (size_t)n;
+     }
+     return 0;
+ }
+
+ /**
+  * Open path for appending, writing the header if the file is new
+  * An existing file must be a recording with the same version; one written
+  * by an older build keeps its field count, newer counters are left out
+  */
+ int record_open(struct recorder *rec, const char *path) {
+     unsigned char header[RECORD_HEADER_SIZE];
+     struct stat st;
+
+     memset(rec, 0, sizeof(*rec));
+     rec->fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+     if (rec->fd < 0 || fstat(rec->fd, &st) != 0) {
+         return RECORD_ERR_OPEN;
+     }
+
+     if (st.st_size == 0) {
+         memcpy(header, RECORD_MAGIC, 8);
+         header[8] = RECORD_VERSION;
+         header[9] = (unsigned char)RECORD_FIELD_COUNT;
+         if (write_all(rec->fd, header, sizeof(header)) != 0) {
+             return RECORD_ERR_WRITE;
+         }
+         rec->fields = RECORD_FIELD_COUNT;
+         return RECORD_OK;
+     }
+
+     if (pread(rec->fd, header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+         memcmp(header, RECORD_MAGIC, 8) != 0) {
+         return RECORD_ERR_FORMAT;
+     }
+     if (header[8] != RECORD_VERSION || header[9] > RECORD_FIELD_COUNT) {
+         return RECORD_ERR_VERSION;
+     }
+     rec->fields = header[9];
+     return RECORD_OK;
+ }
+
+ /**
+  * Encode one sample as a keyframe or delta frame and append it with a
+  * single write()
+  */
+ int record_append(struct recorder *rec, const struct mem_sample *sample) {
+     unsigned char payload[RECORD_FRAME_MAX - 16];
+     const struct sched_tick *tick = &sample->tick;
+     const struct sched_tick *prev = &rec->prev.tick;
+     int keyframe = rec->frames % RECORD_KEYFRAME_INTERVAL == 0 || tick->actual_ns < prev->actual_ns;
+     size_t n = 0;
+
+     if (keyframe) {
+         n = put_varint(payload, n, rec->frames == 0 ? RECORD_FLAG_SESSION : 0);
+         n = put_varint(payload, n, sample->valid);
+         n = put_varint(payload, n, tick->actual_ns);
+         n = put_varint(payload, n, tick->actual_ns - tick->scheduled_ns);
+         n = put_varint(payload, n, sample->wall_ns);
+         n = put_varint(payload, n, tick->seq);
+         for (size_t i = 0; i < rec->fields; i++) {
+             n = put_varint(payload, n, field_get(&sample->counters, i));
+         }
+     } else {
+         uint64_t mono_step = tick->actual_ns - prev->actual_ns;
+         n = put_varint(payload, n, sample->valid);
+         n = put_varint(payload, n, mono_step);
+         n = put_varint(payload, n, tick->actual_ns - tick->scheduled_ns);
+         n = put_varint(payload, n, zigzag((sample->wall_ns - rec->prev.wall_ns) - mono_step));
+         n = put_varint(payload, n, tick->seq - prev->seq);
+         for (size_t i = 0; i < rec->fields; i++) {
+             n = put_varint(payload, n, zigzag(field_get(&sample->counters, i) -
+                                               field_get(&rec->prev.counters, i)));
+         }
+     }
+
+     size_t len = 0;
+     rec->buf[len++] = keyframe ? 'K' : 'D';
+     len = put_varint(rec->buf, len, n);
+     memcpy(rec->buf + len, payload, n);
+     len += n;
+
+     if (write_all(rec->fd, rec->buf, len) != 0) {
+         return RECORD_ERR_WRITE;
+     }
+     rec->prev = *sample;
+     rec->frames++;
+     return RECORD_OK;
+ }
+
+ int record_close(struct recorder *rec) {
+     int ret = 0;
+
+     if (rec->fd >= 0) {
+         ret = close(rec->fd);
+         rec->fd = -1;
+     }
+     return ret;
+ }
+
+ /**
+  * Map a recording read-only and check its header
+  */
+ int replay_open(struct replay *rp, const char *path) {
+     struct stat st;
+
+     memset(rp, 0, sizeof(*rp));
+     int fd = open(path, O_RDONLY | O_CLOEXEC);
+     if (fd < 0) {
+         return RECORD_ERR_OPEN;
+     }
+     if (fstat(fd, &st) != 0) {
+         close(fd);
+         return RECORD_ERR_OPEN;
+     }
+     if (st.st_size < RECORD_HEADER_SIZE) {
+         close(fd);
+         return RECORD_ERR_FORMAT;
+     }
+
+     void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+     close(fd);
+     if (map == MAP_FAILED) {
+         return RECORD_ERR_OPEN;
+     }
+     rp->data = map;
+     rp->size = (size_t)st.st_size;
+
+     if (memcmp(rp->data, RECORD_MAGIC, 8) != 0) {
+         return RECORD_ERR_FORMAT;
+     }
+     if (rp->data[8] != RECORD_VERSION) {
+         return RECORD_ERR_VERSION;
+     }
+     rp->fields = rp->data[9];
+     rp->pos = RECORD_HEADER_SIZE;
+     return RECORD_OK;
+ }
+
+ /**
+  * Decode the next frame into sample
+  * Counters beyond what this build knows are skipped, missing ones stay 0
+  * Returns 1 when a sample was decoded, 0 at the end of the file,
+  * RECORD_ERR_FORMAT (negated) for a corrupt frame
+  */
+ int replay_next(struct replay *rp, struct mem_sample *sample, unsigned *flags) {
+     uint64_t len, valid, mono, late, wall, seq, value;
+
+     if (rp->pos >= rp->size) {
+         return 0;
+     }
+
+     unsigned char type = rp->data[rp->pos++];
+     if (get_varint(rp->data, &rp->pos, rp->size, &len) != 0 || len > rp->size - rp->pos) {
+         return -RECORD_ERR_FORMAT;
+     }
+     size_t pos = rp->pos, end = rp->pos + (size_t)len;
+     rp->pos = end;
+
+     *flags = 0;
+     if (type == 'K') {
+         uint64_t frame_flags;
+         if (get_varint(rp->data, &pos, end, &frame_flags) != 0 ||
+             get_varint(rp->data, &pos, end, &valid) != 0 ||
+             get_varint(rp->data, &pos, end, &mono) != 0 ||
+             get_varint(rp->data, &pos, end, &late) != 0 ||
+             get_varint(rp->data, &pos, end, &wall) != 0 ||
+             get_varint(rp->data, &pos, end, &seq) != 0) {
+             return -RECORD_ERR_FORMAT;
+         }
+         memset(sample, 0, sizeof(*sample));
+         for (size_t i = 0; i < rp->fields; i++) {
+             if (get_varint(rp->data, &pos, end, &value) != 0) {
+                 return -RECORD_ERR_FORMAT;
+             }
+             if (i < RECORD_FIELD_COUNT) field_set(&sample->counters, i, value);
+         }
+         *flags = (unsigned)frame_flags;
+     } else if (type == 'D' && rp->have_prev) {
+         uint64_t mono_step, wall_skew, seq_step;
+         if (get_varint(rp->data, &pos, end, &valid) != 0 ||
+             get_varint(rp->data, &pos, end, &mono_step) != 0 ||
+             get_varint(rp->data, &pos, end, &late) != 0 ||
+             get_varint(rp->data, &pos, end, &wall_skew) != 0 ||
+             get_varint(rp->data, &pos, end, &seq_step) != 0) {
+             return -RECORD_ERR_FORMAT;
+         }
+         *sample = rp->prev;
+         mono = rp->prev.tick.actual_ns + mono_step;
+         wall = rp->prev.wall_ns + mono_step + unzigzag(wall_skew);
+         seq = rp->prev.tick.seq + seq_step;
+         for (size_t i = 0; i < rp->fields; i++) {
+             if (get_varint(rp->data, &pos, end, &value) != 0) {
+                 return -RECORD_ERR_FORMAT;
+             }
+             if (i < RECORD_FIELD_COUNT) {
+                 field_set(&sample->counters, i, field_get(&rp->prev.counters, i) + unzigzag(value));
+             }
+         }
+     } else {
+         return -RECORD_ERR_FORMAT;
+     }
+
+     /* Recordings from before available_known only kept a non-zero estimate */
+     if (rp->fields < RECORD_FIELD_COUNT && sample->counters.available_count > 0) {
+         sample->counters.available_known = 1;
+     }
+     sample->valid = (unsigned)valid;
+     sample->tick.actual_ns = mono;
+     sample->tick.scheduled_ns = mono - late;
+     sample->tick.seq = seq;
+     sample->wall_ns = wall;
+     rp->prev = *sample;
+     rp->have_prev = 1;
+     return 1;
+ }
+
+ /**
+  * Position the reader on the last keyframe at or before wall_ns, skipping
+  * delta frames by their length without decoding them
+  * Returns 0 on success, -RECORD_ERR_FORMAT for a corrupt frame
+  */
+ int replay_seek(struct replay *rp, uint64_t wall_ns) {
+     size_t pos = RECORD_HEADER_SIZE, target = RECORD_HEADER_SIZE;
+
+     while (pos < rp->size) {
+         size_t frame = pos;
+         unsigned char type = rp->data[pos++];
+         uint64_t len, skip, frame_wall;
+
+         if (get_varint(rp->data, &pos, rp->size, &len) != 0 || len > rp->size - pos) {
+             return -RECORD_ERR_FORMAT;
+         }
+         if (type == 'K') {
+             /* flags, valid, mono, lateness, then wall-clock */
+             size_t p = pos, end = pos + (size_t)len;
+             if (get_varint(rp->data, &p, end, &skip) != 0 ||
+                 get_varint(rp->data, &p, end, &skip) != 0 ||
+                 get_varint(rp->data, &p, end, &skip) != 0 ||
+                 get_varint(rp->data, &p, end, &skip) != 0 ||
+                 get_varint(rp->data, &p, end, &frame_wall) != 0) {
+                 return -RECORD_ERR_FORMAT;
+             }
+             if (frame_wall > wall_ns) break;
+             target = frame;
+         }
+         pos += (size_t)len;
+     }
+
+     rp->pos = target;
+     rp->have_prev = 0;
+     return 0;
+ }
+
+ void replay_close(struct replay *rp) {
+     if (rp->data != NULL) {
+         munmap((void *)rp->data, rp->size);
+         rp->data = NULL;
+     }
+ }
+
+ /**
+  * Message for a RECORD_* status
+  */
+ const char *record_strerror(int status) {
+     if (status < 0) status = -status;
+     switch (status) {
+         case RECORD_OK: return "success";
+         case RECORD_ERR_OPEN: return "cannot open recording";
+         case RECORD_ERR_FORMAT: return "not a recording or corrupt frame";
+         case RECORD_ERR_VERSION: return "recording made by an incompatible version";
+         case RECORD_ERR_WRITE: return "cannot write recording";
+         default: return "unknown recording error";
+     }
+ }
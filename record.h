@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_RECORD_H
+ #define FREE_RECORD_H
+
+ #include <stddef.h>
+ #include <stdint.h>
+
+ #include "sample.h"
+
+ /*
+  * Recording file format
+  *
+  *   header:  "FREEREC" '\0', version byte, field count byte
+  *   frames:  type byte ('K' keyframe, 'D' delta), varint payload length, payload
+  *
+  * A keyframe holds flags, valid, the actual monotonic time, lateness
+  * (actual - scheduled), wall-clock time, tick sequence and every counter as
+  * absolute varints. A delta frame holds valid, the monotonic step, lateness,
+  * the wall-clock step minus the monotonic step (zigzag), the sequence step
+  * and the zigzag delta of every counter against the previous frame.
+  * Keyframes are written every RECORD_KEYFRAME_INTERVAL frames and whenever a
+  * recording session starts, so a reader can start decoding at any of them.
+  */
+
+ #define RECORD_MAGIC "FREEREC"
+ #define RECORD_VERSION 1
+ #define RECORD_HEADER_SIZE 10
+ #define RECORD_KEYFRAME_INTERVAL 600
+ #define RECORD_FRAME_MAX 512
+
+ /* Keyframe flags */
+ #define RECORD_FLAG_SESSION (1u << 0)   /* First frame of a recording session */
+
+ /* Status codes of the recorder and the replay reader */
+ typedef enum {
+     RECORD_OK = 0,
+     RECORD_ERR_OPEN,        /* File could not be opened or mapped */
+     RECORD_ERR_FORMAT,      /* Not a recording, or a corrupt frame */
+     RECORD_ERR_VERSION,     /* Recorded by an incompatible version */
+     RECORD_ERR_WRITE        /* Write failed */
+ } RecordStatus;
+
+ struct recorder {
+     int fd;
+     unsigned fields;                /* Counter fields per frame in this file */
+     uint64_t frames;                /* Frames written this session */
+     struct mem_sample prev;
+     unsigned char buf[RECORD_FRAME_MAX];
+ };
+
+ struct replay {
+     const unsigned char *data;      /* Whole file, mapped read-only */
+     size_t size;
+     size_t pos;
+     unsigned fields;                /* Counter fields per frame in this file */
+     int have_prev;
+     struct mem_sample prev;
+ };
+
+ int record_open(struct recorder *rec, const char *path);
+ int record_append(struct recorder *rec, const struct mem_sample *sample);
+ int record_close(struct recorder *rec);
+
+ int replay_open(struct replay *rp, const char *path);
+ int replay_next(struct replay *rp, struct mem_sample *sample, unsigned *flags);
+ int replay_seek(struct replay *rp, uint64_t wall_ns);
+ void replay_close(struct replay *rp);
+ const char *record_strerror(int status);
+
+ #endif /* FREE_RECORD_H */
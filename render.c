@@ -0,0 +1,549 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "render.h"
+
+ #include <errno.h>
+ #include <limits.h>
+ #include <stddef.h>
+ #include <stdio.h>
+ #include <string.h>
+ #include <unistd.h>
+
+ /* Unit suffixes */
+ static const char *const suffixesHuman[] = {"B", "Ki", "Mi", "Gi", "Ti", "Pi"};
+ static const char *const suffixes[] = {"B", "KB", "MB", "GB", "TB", "PB"};
+
+ /* Powers of the unit divisors, up to the largest unit */
+ static const unsigned long long pow1024[] = {
+     1ULL, 1024ULL, 1048576ULL, 1073741824ULL, 1099511627776ULL, 1125899906842624ULL
+ };
+ static const unsigned long long pow1000[] = {
+     1ULL, 1000ULL, 1000000ULL, 1000000000ULL, 1000000000000ULL, 1000000000000000ULL
+ };
+
+ /* Values from 2^53 up are not exact as a double, leave them to snprintf */
+ #define EXACT_DOUBLE_LIMIT (1ULL << 53)
+
+ /**
+  * Margin within which the double arithmetic of the snprintf path may land on
+  * the other side of a rounding or unit boundary than the exact integer math
+  * Division by 1000 rounds, so allow a relative error of 2^-42; division by
+  * 1024 is exact and only true ties are ambiguous
+  */
+ static unsigned long long unsafe_margin(unsigned long long bytes, int si) {
+     return si ? (bytes >> 42) + 1 : 0;
+ }
+
+ /**
+  * Write the decimal digits of value to buffer, returns the number of digits
+  */
+ static int format_u64(unsigned long long value, char *buffer) {
+     char digits[20];
+     int n = 0;
+
+     do {
+         digits[n++] = (char)('0' + value % 10);
+         value /= 10;
+     } while (value != 0);
+
+     for (int i = 0; i < n; i++) {
+         buffer[i] = digits[n - 1 - i];
+     }
+     return n;
+ }
+
+ /**
+  * Fixed-point equivalent of snprintf("%.2f %s", bytes / divisor^index, suffix)
+  * Returns the formatted length, 0 when the value sits too close to a rounding
+  * boundary to be sure of matching snprintf, -1 when it does not fit
+  */
+ static int format_fixed(unsigned long long bytes, int si, int index, const char *suffix,
+                         char *buffer, int bufferSize) {
+     unsigned long long divisor = si ? pow1000[index] : pow1024[index];
+     unsigned long long whole = bytes / divisor;
+     unsigned long long scaled = (bytes % divisor) * 100;   /* Below 2^57 */
+     unsigned long long hundredths = scaled / divisor;
+     unsigned long long rest = scaled % divisor;
+
+     /* Distance of the remainder from the half-way point, in 1/(2*divisor) */
+     unsigned long long twice = rest * 2;
+     unsigned long long delta = twice > divisor ? twice - divisor : divisor - twice;
+     if (delta == 0 || delta <= unsafe_margin(bytes, si)) {
+         return 0;
+     }
+
+     /* Ties were excluded above, so rounding up past the half-way point is exact */
+     if (twice > divisor && ++hundredths == 100) {
+         hundredths = 0;
+         whole++;
+     }
+
+     char text[MEMORY_STRING_BUFFER_SIZE];
+     int n = format_u64(whole, text);
+     text[n++] = '.';
+     text[n++] = (char)('0' + hundredths / 10);
+     text[n++] = (char)('0' + hundredths % 10);
+     text[n++] = ' ';
+     size_t suffix_len = strlen(suffix);
+     memcpy(text + n, suffix, suffix_len);
+     n += (int)suffix_len;
+
+     if (n >= bufferSize) {
+         return -1;
+     }
+     memcpy(buffer, text, (size_t)n);
+     buffer[n] = '\0';
+     return n;
+ }
+
+ /**
+  * Reference implementation through a double, used for the rare values the
+  * fixed-point path cannot decide exactly
+  */
+ static int format_double(unsigned long long bytes, int si, int index, int human, const char *suffix,
+                          char *buffer, int bufferSize) {
+     double result = (double)bytes;
+     unsigned long divisor = si ? 1000 : 1024;
+
+     if (human) {
+         /* Repeat the scaling loop so the double sees the same divisions */
+         index = 0;
+         while (result > divisor && index < 5) {
+             result /= divisor;
+             index++;
+         }
+         suffix = suffixesHuman[index];
+     } else {
+         for (int i = 0; i < index; i++) {
+             result /= divisor;
+         }
+     }
+
+     int ret = snprintf(buffer, bufferSize, "%.2f %s", result, suffix);
+     if (ret < 0 || ret >= bufferSize) {
+         return -1;
+     }
+     return ret;
+ }
+
+ /**
+  * Formats byte values into human-readable strings with appropriate units
+  * Uses integer fixed-point scaling; the output is identical to
+  * snprintf("%.2f %s") on the scaled double, which remains the fallback
+  * for values that land on a rounding tie or beyond 2^53
+  * Returns 0 on success, -1 on error
+  */
+ int formatBytes(unsigned long long bytes, char *buffer, int bufferSize, int human, int si, int unit) {
+     if (buffer == NULL || bufferSize <= 0) {
+         return -1;
+     }
+
+     /* Validate unit parameter */
+     if (unit < 0 || unit > 5) {
+         unit = 0; /* Default to bytes on invalid input */
+     }
+
+     int suffixIndex = unit;
+     int exact = bytes < EXACT_DOUBLE_LIMIT;
+
+     if (human) {
+         /* Scale while the value exceeds one divisor, as the double loop does */
+         const unsigned long long *powers = si ? pow1000 : pow1024;
+         suffixIndex = 0;
+         while (suffixIndex < 5) {
+             unsigned long long limit = powers[suffixIndex + 1];
+             unsigned long long gap = bytes > limit ? bytes - limit : limit - bytes;
+             if (gap != 0 && gap <= unsafe_margin(bytes, si)) {
+                 exact = 0;
+             }
+             if (bytes <= limit) {
+                 break;
+             }
+             suffixIndex++;
+         }
+     }
+
+     const char *suffix = human ? suffixesHuman[suffixIndex] : suffixes[suffixIndex];
+     int ret = exact ? format_fixed(bytes, si, suffixIndex, suffix, buffer, bufferSize) : 0;
+     if (ret == 0) {
+         ret = format_double(bytes, si, suffixIndex, human, suffix, buffer, bufferSize);
+     }
+
+     if (ret < 0) {
+         /* Handle truncation safely */
+         strncpy(buffer, "ERROR", bufferSize - 1);
+         buffer[bufferSize - 1] = '\0';
+         return -1;
+     }
+     return 0;
+ }
+
+ /**
+  * Empty the buffer for the next frame
+  */
+ void outbuf_reset(struct outbuf *ob) {
+     ob->len = 0;
+     ob->overflow = 0;
+ }
+
+ /**
+  * Append n bytes, flagging overflow instead of truncating mid-frame
+  */
+ void outbuf_append(struct outbuf *ob, const char *s, size_t n) {
+     if (n > sizeof(ob->data) - ob->len) {
+         ob->overflow = 1;
+         return;
+     }
+     memcpy(ob->data + ob->len, s, n);
+     ob->len += n;
+ }
+
+ void outbuf_puts(struct outbuf *ob, const char *s) {
+     outbuf_append(ob, s, strlen(s));
+ }
+
+ /**
+  * Append s padded with spaces like printf's %*s: right-aligned for a
+  * positive width, left-aligned for a negative one
+  */
+ void outbuf_pad(struct outbuf *ob, const char *s, int width) {
+     static const char spaces[] = "                                ";
+     size_t len = strlen(s);
+     size_t target = (size_t)(width < 0 ? -width : width);
+     size_t fill = len < target ? target - len : 0;
+
+     if (width < 0) {
+         outbuf_append(ob, s, len);
+     }
+     while (fill > 0) {
+         size_t chunk = fill < sizeof(spaces) - 1 ? fill : sizeof(spaces) - 1;
+         outbuf_append(ob, spaces, chunk);
+         fill -= chunk;
+     }
+     if (width >= 0) {
+         outbuf_append(ob, s, len);
+     }
+ }
+
+ /**
+  * Write the whole buffer to fd and empty it
+  * Returns 0 on success, -1 with errno set on error
+  */
+ int outbuf_write(struct outbuf *ob, int fd) {
+     size_t done = 0;
+
+     while (done < ob->len) {
+         ssize_t n = write(fd, ob->data + done, ob->len - done);
+         if (n < 0) {
+             if (errno == EINTR) continue;
+             return -1;
+         }
+         done += (size_t)n;
+     }
+     outbuf_reset(ob);
+     return 0;
+ }
+
+ /**
+  * Append one table row: "%-7s" label followed by " %11s" cells
+  */
+ void render_row(struct outbuf *ob, const char *label, const char *const *cells, int ncells) {
+     outbuf_pad(ob, label, -7);
+     for (int i = 0; i < ncells; i++) {
+         outbuf_append(ob, " ", 1);
+         outbuf_pad(ob, cells[i], 11);
+     }
+     outbuf_append(ob, "\n", 1);
+ }
+
+ /**
+  * Render one frame of the standard, wide or single-line output into ob
+  * Returns RENDER_OK, or a RENDER_ERR_* code; with RENDER_ERR_TOTAL the
+  * frame is complete apart from the Total line
+  */
+ int render_frame(struct outbuf *ob, const struct render_opts *opts, const struct mem_values *mv) {
+     int human = opts->human, si = opts->si, unit = opts->unit;
+     int status = RENDER_OK;
+
+     /* Formatting memory sizes with consistent buffer sizes */
+     char totalStr[MEMORY_STRING_BUFFER_SIZE], usedStr[MEMORY_STRING_BUFFER_SIZE],
+          freeStr[MEMORY_STRING_BUFFER_SIZE], cachedStr[MEMORY_STRING_BUFFER_SIZE],
+          appStr[MEMORY_STRING_BUFFER_SIZE], availableStr[MEMORY_STRING_BUFFER_SIZE];
+     char swapTotalStr[MEMORY_STRING_BUFFER_SIZE], swapUsedStr[MEMORY_STRING_BUFFER_SIZE],
+          swapFreeStr[MEMORY_STRING_BUFFER_SIZE];
+
+     if (formatBytes(mv->total, totalStr, sizeof(totalStr), human, si, unit) < 0 ||
+         formatBytes(mv->used, usedStr, sizeof(usedStr), human, si, unit) < 0 ||
+         formatBytes(mv->free, freeStr, sizeof(freeStr), human, si, unit) < 0 ||
+         formatBytes(mv->cached, cachedStr, sizeof(cachedStr), human, si, unit) < 0 ||
+         formatBytes(mv->available, availableStr, sizeof(availableStr), human, si, unit) < 0 ||
+         formatBytes(mv->swap_total, swapTotalStr, sizeof(swapTotalStr), human, si, unit) < 0 ||
+         formatBytes(mv->swap_used, swapUsedStr, sizeof(swapUsedStr), human, si, unit) < 0 ||
+         formatBytes(mv->swap_free, swapFreeStr, sizeof(swapFreeStr), human, si, unit) < 0) {
+         return RENDER_ERR_FORMAT;
+     }
+
+     if (opts->line) {
+         /* Single line output format, Linux free-like */
+         outbuf_puts(ob, "Mem: ");
+         outbuf_puts(ob, totalStr);
+         outbuf_puts(ob, " total, ");
+         outbuf_puts(ob, usedStr);
+         outbuf_puts(ob, " used, ");
+         outbuf_puts(ob, freeStr);
+         outbuf_puts(ob, " free, 0B shared, ");
+         outbuf_puts(ob, cachedStr);
+         outbuf_puts(ob, " buff/cache, ");
+         outbuf_puts(ob, availableStr);
+         outbuf_puts(ob, " available\nSwap: ");
+         outbuf_puts(ob, swapTotalStr);
+         outbuf_puts(ob, " total, ");
+         outbuf_puts(ob, swapUsedStr);
+         outbuf_puts(ob, " used, ");
+         outbuf_puts(ob, swapFreeStr);
+         outbuf_puts(ob, " free\n");
+         return ob->overflow ? RENDER_ERR_OVERFLOW : RENDER_OK;
+     }
+
+     const char *swapCells[] = {swapTotalStr, swapUsedStr, swapFreeStr};
+     if (opts->wide) {
+         /* Linux free -w format; app and cached memory stand in for buffers and cache */
+         if (formatBytes(mv->app, appStr, sizeof(appStr), human, si, unit) < 0) {
+             return RENDER_ERR_FORMAT;
+         }
+         const char *header[] = {"total", "used", "free", "shared", "buffers", "cache", "available"};
+         const char *memCells[] = {totalStr, usedStr, freeStr, "0B", appStr, cachedStr, availableStr};
+         render_row(ob, "", header, 7);
+         render_row(ob, "Mem:", memCells, 7);
+     } else {
+         /* Standard Linux free format */
+         const char *header[] = {"total", "used", "free", "shared", "buff/cache", "available"};
+         const char *memCells[] = {totalStr, usedStr, freeStr, "0B", cachedStr, availableStr};
+         render_row(ob, "", header, 6);
+         render_row(ob, "Mem:", memCells, 6);
+     }
+     render_row(ob, "Swap:", swapCells, 3);
+
+     /* Optional: total statistics (matching Linux free -t format) */
+     if (opts->total) {
+         if (ULLONG_MAX - mv->total < mv->swap_total) {
+             status = RENDER_ERR_TOTAL;
+         } else {
+             char totalTotalStr[MEMORY_STRING_BUFFER_SIZE];
+             char totalUsedStr[MEMORY_STRING_BUFFER_SIZE];
+             char totalFreeStr[MEMORY_STRING_BUFFER_SIZE];
+
+             if (formatBytes(mv->total + mv->swap_total, totalTotalStr, sizeof(totalTotalStr), human, si, unit) < 0 ||
+                 formatBytes(mv->used + mv->swap_used, totalUsedStr, sizeof(totalUsedStr), human, si, unit) < 0 ||
+                 formatBytes(mv->free + mv->swap_free, totalFreeStr, sizeof(totalFreeStr), human, si, unit) < 0) {
+                 return RENDER_ERR_FORMAT;
+             }
+
+             /* Match the column width of the main output */
+             const char *totalCells[] = {totalTotalStr, totalUsedStr, totalFreeStr, "", "", "", ""};
+             render_row(ob, "Total:", totalCells, opts->wide ? 7 : 6);
+         }
+     }
+
+     /* Optional: memory commitment information (matching Linux free -v format) */
+     if (opts->committed) {
+         char commitLimitStr[MEMORY_STRING_BUFFER_SIZE], committedStr[MEMORY_STRING_BUFFER_SIZE];
+         char percentStr[MEMORY_STRING_BUFFER_SIZE];
+
+         if (formatBytes(mv->commit_limit, commitLimitStr, sizeof(commitLimitStr), human, si, unit) < 0 ||
+             formatBytes(mv->committed, committedStr, sizeof(committedStr), human, si, unit) < 0) {
+             return RENDER_ERR_FORMAT;
+         }
+
+         /* Calculate percentage - Linux free shows "% of limit" */
+         double percent = 0;
+         if (mv->commit_limit > 0) {
+             percent = ((double)mv->committed / mv->commit_limit) * 100.0;
+         }
+         snprintf(percentStr, sizeof(percentStr), "%.1f", percent);
+
+         outbuf_pad(ob, "Mem. Limit:", -15);
+         outbuf_append(ob, " ", 1);
+         outbuf_pad(ob, commitLimitStr, 11);
+         outbuf_append(ob, "\n", 1);
+         outbuf_pad(ob, "Committed:", -15);
+         outbuf_append(ob, " ", 1);
+         outbuf_pad(ob, committedStr, 11);
+         outbuf_puts(ob, " = ");
+         outbuf_puts(ob, percentStr);
+         outbuf_puts(ob, "% of limit\n");
+     }
+
+     if (ob->overflow) {
+         return RENDER_ERR_OVERFLOW;
+     }
+     return status;
+ }
+
+ /* Fields of the machine-readable formats, in bytes, after the timestamps */
+ static const struct {
+     const char *name;
+     size_t offset;
+ } value_fields[] = {
+     {"total", offsetof(struct mem_values, total)},
+     {"used", offsetof(struct mem_values, used)},
+     {"free", offsetof(struct mem_values, free)},
+     {"cached", offsetof(struct mem_values, cached)},
+     {"app", offsetof(struct mem_values, app)},
+     {"wired", offsetof(struct mem_values, wired)},
+     {"swap_total", offsetof(struct mem_values, swap_total)},
+     {"swap_used", offsetof(struct mem_values, swap_used)},
+     {"swap_free", offsetof(struct mem_values, swap_free)},
+     {"commit_limit", offsetof(struct mem_values, commit_limit)},
+     {"committed", offsetof(struct mem_values, committed)},
+     {"available", offsetof(struct mem_values, available)}
+ };
+ #define VALUE_FIELD_COUNT (sizeof(value_fields) / sizeof(value_fields[0]))
+
+ static void outbuf_u64(struct outbuf *ob, unsigned long long value) {
+     char digits[20];
+     outbuf_append(ob, digits, (size_t)format_u64(value, digits));
+ }
+
+ static unsigned long long value_field(const struct mem_values *mv, size_t i) {
+     return *(const unsigned long long *)((const char *)mv + value_fields[i].offset);
+ }
+
+ /**
+  * Render a sample as one JSON object on a line of its own
+  */
+ static void render_json(struct outbuf *ob, const struct mem_sample *sample, const struct mem_values *mv) {
+     outbuf_puts(ob, "{\"seq\":");
+     outbuf_u64(ob, sample->tick.seq);
+     outbuf_puts(ob, ",\"mono_ns\":");
+     outbuf_u64(ob, sample->tick.actual_ns);
+     outbuf_puts(ob, ",\"wall_ns\":");
+     outbuf_u64(ob, sample->wall_ns);
+     outbuf_puts(ob, ",\"interval_ns\":");
+     outbuf_u64(ob, sample->tick.interval_ns);
+     for (size_t i = 0; i < VALUE_FIELD_COUNT; i++) {
+         outbuf_puts(ob, ",\"");
+         outbuf_puts(ob, value_fields[i].name);
+         outbuf_puts(ob, "\":");
+         outbuf_u64(ob, value_field(mv, i));
+     }
+     outbuf_append(ob, "}\n", 2);
+ }
+
+ /**
+  * Column names of the CSV records, in the order render_sample() writes them
+  */
+ void render_csv_header(struct outbuf *ob) {
+     outbuf_puts(ob, "seq,mono_ns,wall_ns,interval_ns");
+     for (size_t i = 0; i < VALUE_FIELD_COUNT; i++) {
+         outbuf_append(ob, ",", 1);
+         outbuf_puts(ob, value_fields[i].name);
+     }
+     outbuf_append(ob, "\n", 1);
+ }
+
+ static void render_csv(struct outbuf *ob, const struct mem_sample *sample, const struct mem_values *mv) {
+     outbuf_u64(ob, sample->tick.seq);
+     outbuf_append(ob, ",", 1);
+     outbuf_u64(ob, sample->tick.actual_ns);
+     outbuf_append(ob, ",", 1);
+     outbuf_u64(ob, sample->wall_ns);
+     outbuf_append(ob, ",", 1);
+     outbuf_u64(ob, sample->tick.interval_ns);
+     for (size_t i = 0; i < VALUE_FIELD_COUNT; i++) {
+         outbuf_append(ob, ",", 1);
+         outbuf_u64(ob, value_field(mv, i));
+     }
+     outbuf_append(ob, "\n", 1);
+ }
+
+ /**
+  * Render one sample in the format selected by opts; the machine-readable
+  * formats carry raw byte counts and the sample's timestamps
+  * Returns the render_frame() status for text, RENDER_OK or
+  * RENDER_ERR_OVERFLOW otherwise
+  */
+ int render_sample(struct outbuf *ob, const struct render_opts *opts, const struct mem_sample *sample,
+                   const struct mem_values *mv) {
+     switch (opts->format) {
+         case RENDER_FORMAT_JSON:
+             render_json(ob, sample, mv);
+             break;
+         case RENDER_FORMAT_CSV:
+             render_csv(ob, sample, mv);
+             break;
+         default:
+             return render_frame(ob, opts, mv);
+     }
+     return ob->overflow ? RENDER_ERR_OVERFLOW : RENDER_OK;
+ }
+
+ /**
+  * Render one frame of --rates output, in the table or single-line format
+  * Returns RENDER_OK, or RENDER_ERR_OVERFLOW
+  */
+ int render_rates(struct outbuf *ob, const struct render_opts *opts, const struct mem_rates *mr) {
+     static const char *const names[] = {
+         "pageins", "pageouts", "faults", "cow_faults", "compressed", "decompress", "swapins", "swapouts"
+     };
+     const double values[] = {
+         mr->pageins, mr->pageouts, mr->faults, mr->cow_faults,
+         mr->compressions, mr->decompressions, mr->swapins, mr->swapouts
+     };
+     char cells[8][MEMORY_STRING_BUFFER_SIZE];
+     const char *row[8];
+
+     for (int i = 0; i < 8; i++) {
+         snprintf(cells[i], sizeof(cells[i]), "%.1f", values[i]);
+         row[i] = cells[i];
+     }
+
+     if (opts->line) {
+         outbuf_puts(ob, "Rates:");
+         for (int i = 0; i < 8; i++) {
+             outbuf_puts(ob, i == 0 ? " " : ", ");
+             outbuf_puts(ob, cells[i]);
+             outbuf_puts(ob, " ");
+             outbuf_puts(ob, names[i]);
+             outbuf_puts(ob, "/s");
+         }
+         outbuf_append(ob, "\n", 1);
+     } else {
+         render_row(ob, "", names, 8);
+         render_row(ob, "Rate/s:", row, 8);
+     }
+     return ob->overflow ? RENDER_ERR_OVERFLOW : RENDER_OK;
+ }
+
+ /**
+  * Tag the frame that follows with the sampling interval: a line of its own
+  * above a table, a prefix of a single-line frame
+  */
+ void render_interval(struct outbuf *ob, const struct render_opts *opts, uint64_t interval_ns) {
+     char cell[MEMORY_STRING_BUFFER_SIZE];
+
+     snprintf(cell, sizeof(cell), "%.3fs", (double)interval_ns / NSEC_PER_SEC);
+     outbuf_puts(ob, "Interval: ");
+     outbuf_puts(ob, cell);
+     outbuf_append(ob, opts->line ? " " : "\n", 1);
+ }
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_RENDER_H
+ #define FREE_RENDER_H
+
+ #include <stddef.h>
+
+ #include "sample.h"
+
+ #define MEMORY_STRING_BUFFER_SIZE 32
+ #define FRAME_BUFFER_SIZE 4096
+
+ /* Status codes of render_frame() */
+ typedef enum {
+     RENDER_OK = 0,
+     RENDER_ERR_FORMAT,          /* A value could not be formatted */
+     RENDER_ERR_OVERFLOW,        /* The frame did not fit in the buffer */
+     RENDER_ERR_TOTAL            /* -t sums overflowed, Total line left out */
+ } RenderStatus;
+
+ /* Output formats */
+ typedef enum {
+     RENDER_FORMAT_TEXT = 0,     /* Table, or one line with -L */
+     RENDER_FORMAT_JSON,         /* One JSON object per sample (NDJSON) */
+     RENDER_FORMAT_CSV           /* One CSV record per sample after a header */
+ } RenderFormat;
+
+ /* Display options shared by every output format */
+ struct render_opts {
+     int human;
+     int si;
+     int unit;
+     int wide;
+     int line;
+     int total;
+     int committed;
+     int format;                 /* RenderFormat */
+ };
+
+ /* Reusable output buffer, a whole frame is written with one write() */
+ struct outbuf {
+     size_t len;
+     int overflow;               /* Set when an append did not fit */
+     char data[FRAME_BUFFER_SIZE];
+ };
+
+ int formatBytes(unsigned long long bytes, char *buffer, int bufferSize, int human, int si, int unit);
+
+ void outbuf_reset(struct outbuf *ob);
+ void outbuf_append(struct outbuf *ob, const char *s, size_t n);
+ void outbuf_puts(struct outbuf *ob, const char *s);
+ void outbuf_pad(struct outbuf *ob, const char *s, int width);
+ int outbuf_write(struct outbuf *ob, int fd);
+
+ void render_row(struct outbuf *ob, const char *label, const char *const *cells, int ncells);
+ int render_frame(struct outbuf *ob, const struct render_opts *opts, const struct mem_values *mv);
+ int render_sample(struct outbuf *ob, const struct render_opts *opts, const struct mem_sample *sample,
+                   const struct mem_values *mv);
+ void render_csv_header(struct outbuf *ob);
+ int render_rates(struct outbuf *ob, const struct render_opts *opts, const struct mem_rates *mr);
+ void render_interval(struct outbuf *ob, const struct render_opts *opts, uint64_t interval_ns);
+
+ #endif /* FREE_RENDER_H */
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "sample.h"
+
+ #include <limits.h>
+
+ /**
+  * Memory that can be handed out without swapping: the kernel's own
+  * estimate as it reports it, even 0, where it has one. Otherwise free
+  * pages above the reserve, all of the purgeable memory and the file-backed
+  * pages less whichever is smaller of half of them or the reserve, as the
+  * working set keeps some of them in use, and never more than what wired,
+  * application and compressed memory leave of the total
+  */
+ static unsigned long long derive_available(const struct mem_counters *c, const struct mem_values *v) {
+     unsigned long long page_size = c->page_size;
+     uint64_t reserve = c->reserve_count, file = c->external_page_count;
+
+     /* Linux wire_count holds Unevictable, which AnonPages also counts, so
+      * capping MemAvailable would take mlocked memory off twice */
+     if (c->available_known) {
+         return c->available_count * page_size;
+     }
+     uint64_t pages = (c->free_count > reserve ? c->free_count - reserve : 0) + c->purgeable_count + file -
+                      (file / 2 < reserve ? file / 2 : reserve);
+     unsigned long long available = pages > ULLONG_MAX / page_size ? ULLONG_MAX : pages * page_size;
+
+     unsigned long long pinned = v->wired + v->app;
+     unsigned long long compressed = c->compressor_page_count * page_size;
+     pinned = pinned < v->wired || ULLONG_MAX - pinned < compressed ? ULLONG_MAX : pinned + compressed;
+     unsigned long long limit = v->total > pinned ? v->total - pinned : 0;
+     return available < limit ? available : limit;
+ }
+
+ /**
+  * Derive the displayed memory values from raw counters
+  * Returns DERIVE_OK on success or a DERIVE_ERR_* code
+  */
+ int sample_derive(const struct mem_counters *c, struct mem_values *v) {
+     unsigned long long page_size = c->page_size;
+
+     /* Validate memory counts to prevent integer overflow */
+     if (c->free_count < c->speculative_count) {
+         return DERIVE_ERR_COUNTS;
+     }
+
+     /* Check for potential integer overflow */
+     if (page_size == 0 ||
+         c->free_count > ULLONG_MAX / page_size ||
+         c->wire_count > ULLONG_MAX / page_size ||
+         c->internal_page_count > ULLONG_MAX / page_size ||
+         c->purgeable_count + c->external_page_count < c->purgeable_count ||
+         c->purgeable_count + c->external_page_count > ULLONG_MAX / page_size ||
+         c->compressor_page_count > ULLONG_MAX / page_size ||
+         c->available_count > ULLONG_MAX / page_size) {
+         return DERIVE_ERR_OVERFLOW;
+     }
+
+     v->total = c->mem_total;
+     v->free = (c->free_count - c->speculative_count) * page_size;
+     v->wired = c->wire_count * page_size;
+     v->app = c->internal_page_count > c->purgeable_count ?
+              (c->internal_page_count - c->purgeable_count) * page_size : 0;
+     v->cached = (c->purgeable_count + c->external_page_count) * page_size;
+
+     /* Guard against overflow in subtraction */
+     if (v->free + v->cached < v->free || v->total < v->free + v->cached) {
+         return DERIVE_ERR_TOTAL;
+     }
+     v->used = v->total - v->free - v->cached;
+     v->available = derive_available(c, v);
+
+     v->swap_total = c->swap_total;
+     v->swap_used = c->swap_used;
+     v->swap_free = c->swap_avail;
+
+     if (c->commit_limit > 0) {
+         /* Linux: CommitLimit and Committed_AS */
+         v->commit_limit = c->commit_limit;
+         v->committed = c->committed;
+         v->uncommitted = c->commit_limit > c->committed ? c->commit_limit - c->committed : 0;
+     } else {
+         /* macOS: the commit limit is the swap file set, as reported by VM_SWAPUSAGE */
+         v->commit_limit = c->swap_total;
+         v->committed = c->swap_used;
+         v->uncommitted = c->swap_avail;
+     }
+
+     return DERIVE_OK;
+ }
+
+ /**
+  * Increase of a cumulative counter that wraps at 2^bits
+  */
+ static uint64_t counter_delta(uint64_t prev, uint64_t cur, uint64_t bits) {
+     uint64_t mask = bits == 0 || bits >= 64 ? UINT64_MAX : (1ULL << bits) - 1;
+     return (cur - prev) & mask;
+ }
+
+ /**
+  * Per-second event rates between two samples of the same host, over their
+  * monotonic interval; page-ins and page-outs are converted to the pages
+  * the other paging events count
+  * Returns DERIVE_OK, or DERIVE_ERR_COUNTS if either sample lacks the event
+  * counters or no time passed between them
+  */
+ int sample_rates(const struct mem_sample *prev, const struct mem_sample *cur, struct mem_rates *r) {
+     const struct mem_counters *a = &prev->counters, *b = &cur->counters;
+
+     if (!(prev->valid & cur->valid & SAMPLE_EVENTS) || cur->tick.actual_ns <= prev->tick.actual_ns ||
+         b->event_page_size == 0) {
+         return DERIVE_ERR_COUNTS;
+     }
+
+     double seconds = (double)(cur->tick.actual_ns - prev->tick.actual_ns) / NSEC_PER_SEC;
+     double per_page = (double)b->page_size / (double)b->event_page_size;
+     uint64_t bits = b->event_bits;
+
+     r->seconds = seconds;
+     r->pageins = (double)counter_delta(a->pageins, b->pageins, bits) * per_page / seconds;
+     r->pageouts = (double)counter_delta(a->pageouts, b->pageouts, bits) * per_page / seconds;
+     r->faults = (double)counter_delta(a->faults, b->faults, bits) / seconds;
+     r->cow_faults = (double)counter_delta(a->cow_faults, b->cow_faults, bits) / seconds;
+     r->compressions = (double)counter_delta(a->compressions, b->compressions, bits) / seconds;
+     r->decompressions = (double)counter_delta(a->decompressions, b->decompressions, bits) / seconds;
+     r->swapins = (double)counter_delta(a->swapins, b->swapins, bits) / seconds;
+     r->swapouts = (double)counter_delta(a->swapouts, b->swapouts, bits) / seconds;
+     return DERIVE_OK;
+ }
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_SAMPLE_H
+ #define FREE_SAMPLE_H
+
+ #include <stdint.h>
+
+ #include "sched.h"
+
+ /* Which groups of counters a sample holds */
+ #define SAMPLE_VM   (1u << 0)   /* Page counts (HOST_VM_INFO64, /proc/meminfo) */
+ #define SAMPLE_SWAP (1u << 1)   /* Swap usage and commit accounting */
+ #define SAMPLE_EVENTS (1u << 2) /* Paging, fault and compressor event counters */
+
+ /* Status codes of sample_derive() */
+ typedef enum {
+     DERIVE_OK = 0,
+     DERIVE_ERR_COUNTS,      /* Inconsistent page counts */
+     DERIVE_ERR_OVERFLOW,    /* Page counts too large to convert to bytes */
+     DERIVE_ERR_TOTAL        /* Free and cached memory exceed the total */
+ } DeriveStatus;
+
+ /* Raw counters of one sample, page counts use the vm_statistics64 names */
+ struct mem_counters {
+     /* Static host facts */
+     uint64_t page_size;
+     uint64_t mem_total;             /* Bytes */
+
+     /* Page counts */
+     uint64_t free_count;
+     uint64_t speculative_count;
+     uint64_t wire_count;
+     uint64_t internal_page_count;
+     uint64_t purgeable_count;
+     uint64_t external_page_count;
+     uint64_t compressor_page_count; /* Pages holding compressed memory, 0 without a compressor */
+     uint64_t reserve_count;         /* Free pages the kernel keeps back for itself */
+     uint64_t available_count;       /* The kernel's own estimate (MemAvailable) */
+     uint64_t available_known;       /* 1 when available_count was reported, even as 0 */
+
+     /* Swap usage in bytes */
+     uint64_t swap_total;
+     uint64_t swap_used;
+     uint64_t swap_avail;
+
+     /* Commit accounting in bytes, 0 where the platform has none */
+     uint64_t commit_limit;
+     uint64_t committed;
+
+     /* Cumulative event counts, wrapping at 2^event_bits */
+     uint64_t pageins;               /* In page_size units */
+     uint64_t pageouts;
+     uint64_t faults;
+     uint64_t cow_faults;            /* 0 where the platform has none */
+     uint64_t compressions;          /* Pages, in event_page_size units from here on */
+     uint64_t decompressions;
+     uint64_t swapins;
+     uint64_t swapouts;
+     uint64_t event_bits;
+     uint64_t event_page_size;
+ };
+
+ /* One sample as taken by the collector */
+ struct mem_sample {
+     struct sched_tick tick;
+     uint64_t wall_ns;               /* Wall-clock time of the sample */
+     unsigned valid;                 /* SAMPLE_* groups filled in */
+     struct mem_counters counters;
+ };
+
+ /* Values shown by the output formats, in bytes */
+ struct mem_values {
+     unsigned long long total;
+     unsigned long long used;
+     unsigned long long free;
+     unsigned long long cached;
+     unsigned long long app;
+     unsigned long long wired;
+     unsigned long long available;   /* Memory that can be handed out without swapping */
+     unsigned long long swap_total;
+     unsigned long long swap_used;
+     unsigned long long swap_free;
+     unsigned long long commit_limit;
+     unsigned long long committed;
+     unsigned long long uncommitted;
+ };
+
+ /* Per-second event rates between two samples, paging in event_page_size pages */
+ struct mem_rates {
+     double seconds;                 /* Interval the rates cover */
+     double pageins;
+     double pageouts;
+     double faults;
+     double cow_faults;
+     double compressions;
+     double decompressions;
+     double swapins;
+     double swapouts;
+ };
+
+ int sample_derive(const struct mem_counters *c, struct mem_values *v);
+ int sample_rates(const struct mem_sample *prev, const struct mem_sample *cur, struct mem_rates *r);
+
+ #endif /* FREE_SAMPLE_H */
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "sched.h"
+
+ #include <errno.h>
+ #include <math.h>
+ #include <time.h>
+
+ /**
+  * Current monotonic time in nanoseconds
+  */
+ uint64_t sched_now_ns(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+ }
+
+ /**
+  * Current wall-clock time in nanoseconds since the epoch
+  */
+ uint64_t sched_wall_ns(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_REALTIME, &ts);
+     return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+ }
+ 
+ /**
+  * Sleep until an absolute monotonic deadline
+  * Returns 0 when the deadline was reached, -1 with errno set to EINTR
+  * when a signal interrupted the sleep
+  */
+ static int sleep_until(uint64_t deadline_ns, uint64_t now_ns) {
+     struct timespec ts;
+ #if defined(__linux__)
+     /* Absolute sleep, immune to the time spent computing the remainder */
+     (void)now_ns;
+     ts.tv_sec = (time_t)(deadline_ns / NSEC_PER_SEC);
+     ts.tv_nsec = (long)(deadline_ns % NSEC_PER_SEC);
+     int ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+     if (ret != 0) {
+         errno = ret;
+         return -1;
+     }
+ #else
+     /* No clock_nanosleep on macOS: sleep for the remainder, the caller re-checks */
+     uint64_t remaining = deadline_ns - now_ns;
+     ts.tv_sec = (time_t)(remaining / NSEC_PER_SEC);
+     ts.tv_nsec = (long)(remaining % NSEC_PER_SEC);
+     if (nanosleep(&ts, NULL) != 0) {
+         return -1;
+     }
+ #endif
+     return 0;
+ }
+
+ /**
+  * Sleep until an absolute monotonic deadline, resuming after signals
+  * Returns 0 when the deadline was reached, -1 with errno set to EINTR
+  * when interrupted and *stop became non-zero
+  */
+ int sched_sleep_until(uint64_t deadline_ns, volatile const sig_atomic_t *stop) {
+     uint64_t now = sched_now_ns();
+ 
+     while (now < deadline_ns) {
+         if (sleep_until(deadline_ns, now) != 0 && stop != NULL && *stop) {
+             return -1;
+         }
+         now = sched_now_ns();
+     }
+     return 0;
+ }
+ 
+ /**
+  * Fold one lateness value into the running jitter statistics
+  */
+ static void stats_add(struct sched_stats *stats, uint64_t late_ns) {
+     stats->samples++;
+     if (stats->samples == 1 || late_ns < stats->min_ns) stats->min_ns = late_ns;
+     if (late_ns > stats->max_ns) stats->max_ns = late_ns;
+
+     double delta = (double)late_ns - stats->mean_ns;
+     stats->mean_ns += delta / (double)stats->samples;
+     stats->m2 += delta * ((double)late_ns - stats->mean_ns);
+ }
+
+ /**
+  * Initialize a scheduler whose first deadline is now
+  */
+ void sched_init(struct scheduler *sched, uint64_t interval_ns, SchedMissedPolicy policy) {
+     sched->interval_ns = interval_ns > 0 ? interval_ns : 1;
+     sched->start_ns = sched_now_ns();
+     sched->base_seq = 0;
+     sched->seq = 0;
+     sched->policy = policy;
+     sched->stats = (struct sched_stats){0};
+ }
+
+ /**
+  * Block until the next deadline and describe it in tick
+  * Deadlines are start + (seq - base_seq) * interval, so time spent between
+  * calls never accumulates as drift
+  * Returns 0 on success, -1 with errno set to EINTR if interrupted;
+  * calling again resumes waiting for the same deadline
+  */
+ int sched_wait(struct scheduler *sched, struct sched_tick *tick) {
+     uint64_t deadline = sched_deadline(sched);
+     uint64_t now = sched_now_ns();
+
+     /* A whole interval has passed since the deadline: it was missed */
+     if (sched->policy == SCHED_MISSED_SKIP && now >= deadline + sched->interval_ns) {
+         uint64_t next = sched->base_seq + (now - sched->start_ns) / sched->interval_ns + 1;
+         sched->stats.missed += next - sched->seq;
+         sched->seq = next;
+         deadline = sched_deadline(sched);
+     }
+
+     while (now < deadline) {
+         if (sleep_until(deadline, now) != 0) {
+             return -1;
+         }
+         now = sched_now_ns();
+     }
+
+     uint64_t late = now - deadline;
+     if (sched->policy == SCHED_MISSED_CATCHUP && late >= sched->interval_ns) {
+         sched->stats.missed++;
+     }
+     stats_add(&sched->stats, late);
+
+     tick->seq = sched->seq;
+     tick->scheduled_ns = deadline;
+     tick->actual_ns = now;
+     tick->interval_ns = sched->interval_ns;
+     sched->seq++;
+     return 0;
+ }
+
+ /**
+  * Absolute monotonic time of the next deadline, before any skipping
+  */
+ uint64_t sched_deadline(const struct scheduler *sched) {
+     return sched->start_ns + (sched->seq - sched->base_seq) * sched->interval_ns;
+ }
+
+ /**
+  * Change the interval from the next deadline on, which becomes the last
+  * deadline plus the new interval; deadline numbers keep counting
+  */
+ void sched_set_interval(struct scheduler *sched, uint64_t interval_ns) {
+     if (sched->seq > sched->base_seq) {
+         sched->start_ns += (sched->seq - 1 - sched->base_seq) * sched->interval_ns;
+         sched->base_seq = sched->seq - 1;
+     }
+     sched->interval_ns = interval_ns > 0 ? interval_ns : 1;
+ }
+
+ /**
+  * Standard deviation of the recorded jitter
+  */
+ double sched_stddev_ns(const struct sched_stats *stats) {
+     if (stats->samples < 2) return 0.0;
+     return sqrt(stats->m2 / (double)(stats->samples - 1));
+ }
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_SCHED_H
+ #define FREE_SCHED_H
+
+ #include <signal.h>
+ #include <stdint.h>
+
+ #define NSEC_PER_SEC 1000000000ULL
+
+ /* What to do when one or more deadlines have already passed */
+ typedef enum {
+     SCHED_MISSED_SKIP,      /* Drop missed ticks, resume on the next future deadline */
+     SCHED_MISSED_CATCHUP    /* Fire missed ticks back to back until caught up */
+ } SchedMissedPolicy;
+
+ /* Timing of a single sample */
+ struct sched_tick {
+     uint64_t seq;           /* Deadline number, counts skipped deadlines too */
+     uint64_t scheduled_ns;  /* Absolute monotonic deadline */
+     uint64_t actual_ns;     /* Absolute monotonic wake-up time */
+     uint64_t interval_ns;   /* Interval in effect when the deadline was set */
+ };
+
+ /* Running jitter statistics (actual - scheduled) */
+ struct sched_stats {
+     uint64_t samples;
+     uint64_t missed;        /* Deadlines skipped or fired late by a full interval */
+     uint64_t min_ns;
+     uint64_t max_ns;
+     double mean_ns;
+     double m2;              /* Sum of squared deviations (Welford) */
+ };
+
+ struct scheduler {
+     uint64_t interval_ns;
+     uint64_t start_ns;      /* Time of deadline base_seq */
+     uint64_t base_seq;
+     uint64_t seq;           /* Number of the next deadline */
+     SchedMissedPolicy policy;
+     struct sched_stats stats;
+ };
+
+ uint64_t sched_now_ns(void);
+ uint64_t sched_wall_ns(void);
+ int sched_sleep_until(uint64_t deadline_ns, volatile const sig_atomic_t *stop);
+ void sched_init(struct scheduler *sched, uint64_t interval_ns, SchedMissedPolicy policy);
+ int sched_wait(struct scheduler *sched, struct sched_tick *tick);
+ uint64_t sched_deadline(const struct scheduler *sched);
+ void sched_set_interval(struct scheduler *sched, uint64_t interval_ns);
+ double sched_stddev_ns(const struct sched_stats *stats);
+
+ #endif /* FREE_SCHED_H */
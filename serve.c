@@ -0,0 +1,492 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "serve.h"
+
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <netdb.h>
+ #include <poll.h>
+ #include <stdarg.h>
+ #include <stdio.h>
+ #include <string.h>
+ #include <sys/socket.h>
+ #include <sys/types.h>
+ #include <unistd.h>
+
+ #ifdef MSG_NOSIGNAL
+ #define SEND_FLAGS MSG_NOSIGNAL
+ #else
+ #define SEND_FLAGS 0            /* macOS: SO_NOSIGPIPE is set on each socket instead */
+ #endif
+
+ #define RESPONSE_404 "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\n\r\nNot Found\n"
+ #define RESPONSE_405 "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET, HEAD\r\nContent-Length: 0\r\n\r\n"
+ #define RESPONSE_400 "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+ #define RESPONSE_503 "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\nContent-Length: 0\r\n\r\n"
+
+ /* Exposition text being rendered */
+ struct metrics {
+     char *buf;
+     size_t len;
+     size_t size;
+     int overflow;
+ };
+
+ static int set_nonblocking(int fd) {
+     int flags = fcntl(fd, F_GETFL);
+     if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0 || fcntl(fd, F_SETFD, FD_CLOEXEC) != 0) {
+         return -1;
+     }
+ #ifdef SO_NOSIGPIPE
+     int one = 1;
+     setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+ #endif
+     return 0;
+ }
+
+ /**
+  * Bind and listen on ADDR:PORT; an empty ADDR listens on every address
+  * and IPv6 addresses are written in brackets, as in [::1]:9100
+  */
+ int serve_open(struct server *srv, const char *address) {
+     struct addrinfo hints, *res, *ai;
+     char host[256];
+
+     memset(srv, 0, sizeof(*srv));
+     srv->listen_fd = -1;
+     srv->current = -1;
+     for (int i = 0; i < SERVE_MAX_CONNS; i++) {
+         srv->conns[i].fd = -1;
+     }
+
+     const char *colon = strrchr(address, ':');
+     if (colon == NULL || colon[1] == '\0') {
+         return SERVE_ERR_ADDRESS;
+     }
+     size_t host_len = (size_t)(colon - address);
+     if (host_len >= 2 && address[0] == '[' && address[host_len - 1] == ']') {
+         address++;
+         host_len -= 2;
+     }
+     if (host_len >= sizeof(host)) {
+         return SERVE_ERR_ADDRESS;
+     }
+     memcpy(host, address, host_len);
+     host[host_len] = '\0';
+
+     memset(&hints, 0, sizeof(hints));
+     hints.ai_family = AF_UNSPEC;
+     hints.ai_socktype = SOCK_STREAM;
+     hints.ai_flags = AI_PASSIVE;
+     if (getaddrinfo(host_len > 0 ? host : NULL, colon + 1, &hints, &res) != 0) {
+         return SERVE_ERR_ADDRESS;
+     }
+
+     for (ai = res; ai != NULL && srv->listen_fd < 0; ai = ai->ai_next) {
+         int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+         if (fd < 0) {
+             continue;
+         }
+         int one = 1;
+         setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+         if (bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || listen(fd, 128) != 0 || set_nonblocking(fd) != 0) {
+             close(fd);
+             continue;
+         }
+         srv->listen_fd = fd;
+     }
+     freeaddrinfo(res);
+
+     return srv->listen_fd >= 0 ? SERVE_OK : SERVE_ERR_LISTEN;
+ }
+
+ static void metric(struct metrics *m, const char *name, const char *type, const char *help,
+                    const char *format, ...) {
+     va_list args;
+
+     if (m->overflow) {
+         return;
+     }
+     int n = snprintf(m->buf + m->len, m->size - m->len, "# HELP %s %s\n# TYPE %s %s\n%s ",
+                      name, help, name, type, name);
+     if (n >= 0 && (size_t)n < m->size - m->len) {
+         m->len += (size_t)n;
+         va_start(args, format);
+         n = vsnprintf(m->buf + m->len, m->size - m->len, format, args);
+         va_end(args);
+     }
+     if (n < 0 || (size_t)n >= m->size - m->len) {
+         m->overflow = 1;
+         return;
+     }
+     m->len += (size_t)n;
+ }
+
+ static void gauge(struct metrics *m, const char *name, const char *help, unsigned long long value) {
+     metric(m, name, "gauge", help, "%llu\n", value);
+ }
+
+ static void counter(struct metrics *m, const char *name, const char *help, unsigned long long value) {
+     metric(m, name, "counter", help, "%llu\n", value);
+ }
+
+ /**
+  * Render the response for a sample into the buffer no connection is using
+  * Returns SERVE_OK, SERVE_ERR_BUSY if a slow client still holds it, or
+  * SERVE_ERR_OVERFLOW
+  */
+ int serve_publish(struct server *srv, const struct mem_sample *sample, const struct mem_values *mv) {
+     const struct mem_counters *c = &sample->counters;
+     char body[SERVE_RESPONSE_SIZE];
+     struct metrics m = {body, 0, sizeof(body), 0};
+
+     int target = srv->current == 0 ? 1 : 0;
+     struct serve_response *resp = &srv->responses[target];
+     if (resp->users > 0) {
+         return SERVE_ERR_BUSY;
+     }
+
+     if (sample->valid & SAMPLE_VM) {
+         gauge(&m, "free_memory_total_bytes", "Physical memory.", mv->total);
+         gauge(&m, "free_memory_used_bytes", "Memory in use, total minus free and cached.", mv->used);
+         gauge(&m, "free_memory_free_bytes", "Unused memory.", mv->free);
+         gauge(&m, "free_memory_cached_bytes", "Purgeable and file-backed memory (buff/cache).", mv->cached);
+         gauge(&m, "free_memory_app_bytes", "Anonymous application memory.", mv->app);
+         gauge(&m, "free_memory_wired_bytes", "Memory that cannot be paged out.", mv->wired);
+         gauge(&m, "free_memory_available_bytes", "Memory that can be handed out without swapping.", mv->available);
+     }
+     if (sample->valid & SAMPLE_SWAP) {
+         gauge(&m, "free_swap_total_bytes", "Swap space.", mv->swap_total);
+         gauge(&m, "free_swap_used_bytes", "Swap space in use.", mv->swap_used);
+         gauge(&m, "free_swap_free_bytes", "Unused swap space.", mv->swap_free);
+         gauge(&m, "free_commit_limit_bytes", "Memory that can be committed.", mv->commit_limit);
+         gauge(&m, "free_committed_bytes", "Memory committed.", mv->committed);
+     }
+     if (sample->valid & SAMPLE_EVENTS) {
+         gauge(&m, "free_page_size_bytes", "Unit of the page-in and page-out counters.", c->page_size);
+         counter(&m, "free_pageins_total", "Pages read in from backing store.", c->pageins);
+         counter(&m, "free_pageouts_total", "Pages written out to backing store.", c->pageouts);
+         counter(&m, "free_faults_total", "Page faults.", c->faults);
+         counter(&m, "free_cow_faults_total", "Copy-on-write faults.", c->cow_faults);
+         counter(&m, "free_compressions_total", "Pages compressed.", c->compressions);
+         counter(&m, "free_decompressions_total", "Pages decompressed.", c->decompressions);
+         counter(&m, "free_swapins_total", "Pages swapped in.", c->swapins);
+         counter(&m, "free_swapouts_total", "Pages swapped out.", c->swapouts);
+     }
+     metric(&m, "free_sample_timestamp_seconds", "gauge", "Wall-clock time of the sample.",
+            "%llu.%03llu\n", (unsigned long long)(sample->wall_ns / NSEC_PER_SEC),
+            (unsigned long long)(sample->wall_ns % NSEC_PER_SEC / 1000000));
+     if (m.overflow) {
+         return SERVE_ERR_OVERFLOW;
+     }
+
+     int n = snprintf(resp->data, sizeof(resp->data),
+                      "HTTP/1.1 200 OK\r\n"
+                      "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                      "Content-Length: %zu\r\n"
+                      "Cache-Control: no-store\r\n\r\n", m.len);
+     if (n < 0 || (size_t)n + m.len > sizeof(resp->data)) {
+         return SERVE_ERR_OVERFLOW;
+     }
+     memcpy(resp->data + n, body, m.len);
+     resp->head_len = (size_t)n;
+     resp->len = (size_t)n + m.len;
+     srv->current = target;
+     return SERVE_OK;
+ }
+
+ static void conn_close(struct serve_conn *conn) {
+     if (conn->resp != NULL) {
+         conn->resp->users--;
+         conn->resp = NULL;
+     }
+     close(conn->fd);
+     conn->fd = -1;
+ }
+
+ /**
+  * Case-insensitive search for "Connection: close" among the headers
+  */
+ static int wants_close(const char *req, size_t len) {
+     static const char name[] = "\nconnection:";
+     static const char value[] = "close";
+
+     for (size_t i = 0; i + sizeof(name) - 1 <= len; i++) {
+         size_t k = 0;
+         while (k < sizeof(name) - 1 && (req[i + k] | 0x20) == (name[k] | 0x20)) k++;
+         if (k < sizeof(name) - 1) {
+             continue;
+         }
+         for (size_t j = i + k; j + sizeof(value) - 1 <= len && req[j] != '\r' && req[j] != '\n'; j++) {
+             size_t v = 0;
+             while (v < sizeof(value) - 1 && (req[j + v] | 0x20) == value[v]) v++;
+             if (v == sizeof(value) - 1) {
+                 return 1;
+             }
+         }
+     }
+     return 0;
+ }
+
+ static void conn_respond(struct serve_conn *conn, const char *data, size_t len) {
+     conn->out = data;
+     conn->out_len = len;
+     conn->out_pos = 0;
+ }
+
+ /**
+  * Pick the response to a complete request at the start of the input
+  * Returns 1 if a request was taken, 0 if more input is needed
+  */
+ static int conn_request(struct server *srv, struct serve_conn *conn) {
+     char *end = NULL;
+
+     for (size_t i = 0; i + 4 <= conn->in_len; i++) {
+         if (memcmp(conn->in + i, "\r\n\r\n", 4) == 0) {
+             end = conn->in + i + 4;
+             break;
+         }
+     }
+     if (end == NULL) {
+         if (conn->in_len == sizeof(conn->in)) {
+             conn->close_after = 1;
+             conn->in_len = 0;
+             conn_respond(conn, RESPONSE_400, sizeof(RESPONSE_400) - 1);
+             return 1;
+         }
+         return 0;
+     }
+
+     size_t req_len = (size_t)(end - conn->in);
+     const char *line_end = memchr(conn->in, '\r', req_len);
+     int head = req_len > 5 && memcmp(conn->in, "HEAD ", 5) == 0;
+     int get = req_len > 4 && memcmp(conn->in, "GET ", 4) == 0;
+     const char *target = conn->in + (head ? 5 : 4);
+     size_t target_len = 0;
+     while (target + target_len < line_end && target[target_len] != ' ' && target[target_len] != '?') {
+         target_len++;
+     }
+
+     /* HTTP/1.0 clients get one response per connection */
+     conn->close_after = line_end - conn->in < 8 || memcmp(line_end - 8, "HTTP/1.1", 8) != 0 ||
+                         wants_close(conn->in, req_len);
+
+     if (!get && !head) {
+         conn_respond(conn, RESPONSE_405, sizeof(RESPONSE_405) - 1);
+     } else if (!(target_len == 1 || (target_len == 8 && memcmp(target, "/metrics", 8) == 0)) ||
+                target[0] != '/') {
+         conn_respond(conn, RESPONSE_404, sizeof(RESPONSE_404) - 1);
+     } else if (srv->current < 0) {
+         conn_respond(conn, RESPONSE_503, sizeof(RESPONSE_503) - 1);
+     } else {
+         struct serve_response *resp = &srv->responses[srv->current];
+         conn->resp = resp;
+         resp->users++;
+         srv->scrapes++;
+         conn_respond(conn, resp->data, head ? resp->head_len : resp->len);
+     }
+
+     /* Keep pipelined requests that follow */
+     conn->in_len -= req_len;
+     memmove(conn->in, end, conn->in_len);
+     return 1;
+ }
+
+ /**
+  * Write as much of the response as the socket takes; once complete, go on
+  * with a pipelined request or close
+  * Returns 0 to keep the connection, -1 to close it
+  */
+ static int conn_write(struct server *srv, struct serve_conn *conn) {
+     while (conn->out != NULL) {
+         while (conn->out_pos < conn->out_len) {
+             ssize_t n = send(conn->fd, conn->out + conn->out_pos, conn->out_len - conn->out_pos, SEND_FLAGS);
+             if (n < 0) {
+                 if (errno == EINTR) continue;
+                 return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+             }
+             conn->out_pos += (size_t)n;
+         }
+
+         conn->out = NULL;
+         if (conn->resp != NULL) {
+             conn->resp->users--;
+             conn->resp = NULL;
+         }
+         if (conn->close_after) {
+             return -1;
+         }
+         conn_request(srv, conn);
+     }
+     return 0;
+ }
+
+ /**
+  * Read what the client sent and answer complete requests
+  * Returns 0 to keep the connection, -1 to close it
+  */
+ static int conn_read(struct server *srv, struct serve_conn *conn) {
+     for (;;) {
+         ssize_t n = recv(conn->fd, conn->in + conn->in_len, sizeof(conn->in) - conn->in_len, 0);
+         if (n < 0) {
+             if (errno == EINTR) continue;
+             if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+             break;
+         }
+         if (n == 0) {
+             return -1;
+         }
+         conn->in_len += (size_t)n;
+         if (conn->in_len == sizeof(conn->in)) {
+             break;
+         }
+     }
+
+     if (conn_request(srv, conn)) {
+         return conn_write(srv, conn);
+     }
+     return 0;
+ }
+
+ static void accept_conns(struct server *srv, uint64_t now) {
+     for (int i = 0; i < SERVE_MAX_CONNS; i++) {
+         struct serve_conn *conn = &srv->conns[i];
+         if (conn->fd >= 0) {
+             continue;
+         }
+
+         int fd = accept(srv->listen_fd, NULL, NULL);
+         if (fd < 0) {
+             return;
+         }
+         if (set_nonblocking(fd) != 0) {
+             close(fd);
+             continue;
+         }
+         memset(conn, 0, offsetof(struct serve_conn, in));
+         conn->fd = fd;
+         conn->active_ns = now;
+     }
+ }
+
+ /**
+  * Answer scrapes until the monotonic deadline, returning up to a
+  * millisecond early so the caller's scheduler sleeps the remainder exactly
+  * Returns SERVE_OK at the deadline or when *stop is set, SERVE_ERR_POLL
+  */
+ int serve_poll(struct server *srv, uint64_t deadline_ns, volatile const sig_atomic_t *stop) {
+     struct pollfd fds[SERVE_MAX_CONNS + 1];
+     int slots[SERVE_MAX_CONNS + 1];
+
+     for (;;) {
+         uint64_t now = sched_now_ns();
+         if ((stop != NULL && *stop) || now + 1000000 > deadline_ns) {
+             return SERVE_OK;
+         }
+
+         nfds_t nfds = 0;
+         int free_slot = 0;
+         for (int i = 0; i < SERVE_MAX_CONNS; i++) {
+             struct serve_conn *conn = &srv->conns[i];
+             if (conn->fd < 0) {
+                 free_slot = 1;
+                 continue;
+             }
+             if (now - conn->active_ns > SERVE_IDLE_NS) {
+                 conn_close(conn);
+                 free_slot = 1;
+                 continue;
+             }
+             fds[nfds].fd = conn->fd;
+             fds[nfds].events = conn->out != NULL ? POLLOUT : POLLIN;
+             slots[nfds++] = i;
+         }
+         if (free_slot) {
+             fds[nfds].fd = srv->listen_fd;
+             fds[nfds].events = POLLIN;
+             slots[nfds++] = -1;
+         }
+
+         /* Wake at least once a second for the idle timeout */
+         uint64_t wait_ms = (deadline_ns - now) / 1000000;
+         int ret = poll(fds, nfds, wait_ms > 1000 ? 1000 : (int)wait_ms);
+         if (ret < 0) {
+             if (errno == EINTR) continue;
+             return SERVE_ERR_POLL;
+         }
+
+         now = sched_now_ns();
+         for (nfds_t k = 0; k < nfds && ret > 0; k++) {
+             if (fds[k].revents == 0) {
+                 continue;
+             }
+             ret--;
+             if (slots[k] < 0) {
+                 accept_conns(srv, now);
+                 continue;
+             }
+
+             struct serve_conn *conn = &srv->conns[slots[k]];
+             int keep;
+             if (fds[k].revents & POLLOUT) {
+                 keep = conn_write(srv, conn);
+             } else if (fds[k].revents & (POLLIN | POLLHUP)) {
+                 keep = conn_read(srv, conn);
+             } else {
+                 keep = -1;
+             }
+             if (keep != 0) {
+                 conn_close(conn);
+             } else {
+                 conn->active_ns = now;
+             }
+         }
+     }
+ }
+
+ void serve_close(struct server *srv) {
+     for (int i = 0; i < SERVE_MAX_CONNS; i++) {
+         if (srv->conns[i].fd >= 0) {
+             conn_close(&srv->conns[i]);
+         }
+     }
+     if (srv->listen_fd >= 0) {
+         close(srv->listen_fd);
+         srv->listen_fd = -1;
+     }
+ }
+
+ /**
+  * Message for a SERVE_* status
+  */
+ const char *serve_strerror(int status) {
+     switch (status) {
+         case SERVE_OK: return "success";
+         case SERVE_ERR_ADDRESS: return "invalid address, expected ADDR:PORT";
+         case SERVE_ERR_LISTEN: return "cannot listen on address";
+         case SERVE_ERR_BUSY: return "previous response still being sent";
+         case SERVE_ERR_OVERFLOW: return "metrics do not fit the response buffer";
+         case SERVE_ERR_POLL: return "poll failed";
+         default: return "unknown exporter error";
+     }
+ }
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_SERVE_H
+ #define FREE_SERVE_H
+
+ #include <signal.h>
+ #include <stddef.h>
+ #include <stdint.h>
+
+ #include "sample.h"
+
+ /*
+  * Prometheus exporter
+  *
+  * After each sample the whole HTTP response, headers and exposition text,
+  * is rendered once into a buffer. Scrapes are answered from a poll() loop
+  * over non-blocking sockets by writing that buffer as is, so a scrape
+  * costs no kernel queries and no formatting. Two response buffers
+  * alternate, so a connection still writing the previous one keeps a
+  * consistent copy while the next sample is published.
+  */
+
+ #define SERVE_MAX_CONNS 64
+ #define SERVE_REQUEST_SIZE 2048
+ #define SERVE_RESPONSE_SIZE 8192
+ #define SERVE_IDLE_NS (30 * NSEC_PER_SEC)
+
+ /* Status codes of the exporter */
+ typedef enum {
+     SERVE_OK = 0,
+     SERVE_ERR_ADDRESS,      /* ADDR:PORT could not be parsed or resolved */
+     SERVE_ERR_LISTEN,       /* Could not bind or listen */
+     SERVE_ERR_BUSY,         /* Both responses in use, sample not published */
+     SERVE_ERR_OVERFLOW,     /* The metrics did not fit the response buffer */
+     SERVE_ERR_POLL          /* poll() failed */
+ } ServeStatus;
+
+ struct serve_response {
+     size_t len;
+     size_t head_len;                /* Headers only, for HEAD */
+     unsigned users;                 /* Connections still writing it */
+     char data[SERVE_RESPONSE_SIZE];
+ };
+
+ struct serve_conn {
+     int fd;                         /* -1 when the slot is free */
+     size_t in_len;
+     const char *out;                /* Response being written, NULL while reading */
+     size_t out_len;
+     size_t out_pos;
+     struct serve_response *resp;    /* Published response held by out */
+     int close_after;
+     uint64_t active_ns;             /* Last progress, for the idle timeout */
+     char in[SERVE_REQUEST_SIZE];
+ };
+
+ struct server {
+     int listen_fd;
+     int current;                    /* Index of the latest response, -1 before the first */
+     uint64_t scrapes;
+     struct serve_response responses[2];
+     struct serve_conn conns[SERVE_MAX_CONNS];
+ };
+
+ int serve_open(struct server *srv, const char *address);
+ int serve_publish(struct server *srv, const struct mem_sample *sample, const struct mem_values *mv);
+ int serve_poll(struct server *srv, uint64_t deadline_ns, volatile const sig_atomic_t *stop);
+ void serve_close(struct server *srv);
+ const char *serve_strerror(int status);
+
+ #endif /* FREE_SERVE_H */
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "shm.h"
+
+ #include <errno.h>
+ #include <fcntl.h>
+ #include <limits.h>
+ #include <sched.h>
+ #include <signal.h>
+ #include <stdio.h>
+ #include <string.h>
+ #include <sys/file.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+
+ #if ATOMIC_LLONG_LOCK_FREE != 2
+ #error "the snapshot ring needs lock-free 64-bit atomics"
+ #endif
+
+ /* Slots start on their own cache line so readers do not share lines */
+ #define SHM_SLOT_SIZE ((sizeof(struct shm_slot) + SHM_CACHE_LINE - 1) & ~(size_t)(SHM_CACHE_LINE - 1))
+
+ static struct shm_slot *slot_at(const struct shm_ring *ring, uint64_t number) {
+     uint64_t index = number & (ring->header->slot_count - 1);
+     return (struct shm_slot *)(ring->slots + index * ring->header->slot_size);
+ }
+
+ /**
+  * Create the ring file and map it for writing
+  * The file is built under a temporary name and renamed into place, so
+  * readers never map a half-initialized header; an flock() on the file
+  * keeps a second daemon from publishing into it
+  */
+ int shm_create(struct shm_ring *ring, const char *path, uint32_t slot_count, uint64_t interval_ns) {
+     char tmp[PATH_MAX];
+
+     memset(ring, 0, sizeof(*ring));
+     ring->fd = -1;
+
+     /* Refuse to replace a ring another daemon still holds */
+     int old = open(path, O_RDONLY | O_CLOEXEC);
+     if (old >= 0) {
+         int busy = flock(old, LOCK_EX | LOCK_NB) != 0 && errno == EWOULDBLOCK;
+         close(old);
+         if (busy) {
+             return SHM_ERR_BUSY;
+         }
+     }
+
+     while (slot_count & (slot_count - 1)) {
+         slot_count &= slot_count - 1;       /* Round down to a power of two */
+     }
+     if (slot_count == 0) {
+         slot_count = SHM_DEFAULT_SLOTS;
+     }
+
+     int ret = snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long)getpid());
+     if (ret < 0 || (size_t)ret >= sizeof(tmp)) {
+         return SHM_ERR_OPEN;
+     }
+
+     ring->size = sizeof(struct shm_header) + (size_t)slot_count * SHM_SLOT_SIZE;
+     ring->fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+     if (ring->fd < 0) {
+         return SHM_ERR_OPEN;
+     }
+     if (flock(ring->fd, LOCK_EX | LOCK_NB) != 0 || ftruncate(ring->fd, (off_t)ring->size) != 0) {
+         unlink(tmp);
+         return SHM_ERR_OPEN;
+     }
+
+     void *map = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+     if (map == MAP_FAILED) {
+         unlink(tmp);
+         return SHM_ERR_OPEN;
+     }
+     ring->header = map;
+     ring->slots = (unsigned char *)map + sizeof(struct shm_header);
+
+     /* The file is zero-filled: every slot starts with an even sequence */
+     memcpy(ring->header->magic, SHM_MAGIC, 8);
+     ring->header->version = SHM_VERSION;
+     ring->header->slot_count = slot_count;
+     ring->header->slot_size = (uint32_t)SHM_SLOT_SIZE;
+     ring->header->writer_pid = (uint32_t)getpid();
+     ring->header->interval_ns = interval_ns;
+     atomic_store_explicit(&ring->header->published, 0, memory_order_release);
+
+     if (rename(tmp, path) != 0) {
+         unlink(tmp);
+         return SHM_ERR_OPEN;
+     }
+     return SHM_OK;
+ }
+
+ /**
+  * Publish one snapshot into the next slot
+  */
+ void shm_publish(struct shm_ring *ring, const struct mem_sample *sample) {
+     uint64_t number = atomic_load_explicit(&ring->header->published, memory_order_relaxed);
+     struct shm_slot *slot = slot_at(ring, number);
+     uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+     atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+     atomic_thread_fence(memory_order_release);
+     slot->number = number;
+     slot->sample = *sample;
+     atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+
+     atomic_store_explicit(&ring->header->published, number + 1, memory_order_release);
+ }
+
+ /**
+  * Map an existing ring read-only
+  */
+ int shm_attach(struct shm_ring *ring, const char *path) {
+     struct stat st;
+
+     memset(ring, 0, sizeof(*ring));
+     ring->fd = -1;
+
+     int fd = open(path, O_RDONLY | O_CLOEXEC);
+     if (fd < 0) {
+         return SHM_ERR_OPEN;
+     }
+     if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct shm_header)) {
+         close(fd);
+         return SHM_ERR_FORMAT;
+     }
+
+     void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+     close(fd);
+     if (map == MAP_FAILED) {
+         return SHM_ERR_OPEN;
+     }
+     ring->header = map;
+     ring->slots = (unsigned char *)map + sizeof(struct shm_header);
+     ring->size = (size_t)st.st_size;
+
+     const struct shm_header *h = ring->header;
+     if (memcmp(h->magic, SHM_MAGIC, 8) != 0 || h->version != SHM_VERSION ||
+         h->slot_size != SHM_SLOT_SIZE || h->slot_count == 0 ||
+         (h->slot_count & (h->slot_count - 1)) != 0 ||
+         ring->size < sizeof(struct shm_header) + (size_t)h->slot_count * SHM_SLOT_SIZE) {
+         return SHM_ERR_FORMAT;
+     }
+     return SHM_OK;
+ }
+
+ /**
+  * Number of snapshots published so far; the latest is this minus one
+  */
+ uint64_t shm_published(const struct shm_ring *ring) {
+     return atomic_load_explicit(&ring->header->published, memory_order_acquire);
+ }
+
+ /**
+  * Copy snapshot number into sample without blocking the writer
+  * Returns SHM_OK, SHM_ERR_GONE if the slot already holds a newer one, or
+  * SHM_ERR_TORN if the writer was killed or stopped inside the slot
+  */
+ int shm_read(const struct shm_ring *ring, uint64_t number, struct mem_sample *sample) {
+     struct shm_slot *slot = slot_at(ring, number);
+     unsigned long spins = 0, rounds = 0;
+
+     for (;;) {
+         uint64_t before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+         if (before & 1) {
+             /* Writer inside, it is never there for long unless it died there */
+             if (++spins < SHM_SPIN_LIMIT) {
+                 continue;
+             }
+             spins = 0;
+             pid_t writer = (pid_t)ring->header->writer_pid;
+             if ((kill(writer, 0) != 0 && errno == ESRCH) || ++rounds >= SHM_SPIN_ROUNDS) {
+                 return SHM_ERR_TORN;
+             }
+             sched_yield();
+             continue;
+         }
+         uint64_t held = slot->number;
+         *sample = slot->sample;
+         atomic_thread_fence(memory_order_acquire);
+         uint64_t after = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+         if (before == after) {
+             return held == number ? SHM_OK : SHM_ERR_GONE;
+         }
+     }
+ }
+
+ void shm_close(struct shm_ring *ring) {
+     if (ring->header != NULL) {
+         munmap(ring->header, ring->size);
+         ring->header = NULL;
+     }
+     if (ring->fd >= 0) {
+         close(ring->fd);
+         ring->fd = -1;
+     }
+ }
+
+ /**
+  * Message for a SHM_* status
+  */
+ const char *shm_strerror(int status) {
+     switch (status) {
+         case SHM_OK: return "success";
+         case SHM_ERR_OPEN: return "cannot open snapshot ring";
+         case SHM_ERR_FORMAT: return "not a snapshot ring of this version";
+         case SHM_ERR_BUSY: return "another daemon is publishing to this file";
+         case SHM_ERR_EMPTY: return "no snapshot published yet";
+         case SHM_ERR_GONE: return "snapshot already overwritten";
+         case SHM_ERR_TORN: return "the daemon stopped halfway through writing a snapshot";
+         default: return "unknown snapshot ring error";
+     }
+ }
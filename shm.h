@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_SHM_H
+ #define FREE_SHM_H
+
+ #include <stdatomic.h>
+ #include <stddef.h>
+ #include <stdint.h>
+
+ #include "sample.h"
+
+ /*
+  * Snapshot ring shared through an mmap'd file
+  *
+  * One daemon writes, any number of readers map the file read-only.
+  * Every slot is guarded by a sequence lock: the writer makes the slot's
+  * sequence odd, copies the sample in, then makes it even again, and only
+  * then bumps the header's published count. A reader copies a slot between
+  * two reads of its sequence and retries if they differ or are odd, so
+  * reading never blocks the writer and needs no system calls.
+  */
+
+ #define SHM_MAGIC "FREESHM"
+ #define SHM_VERSION 3
+ #define SHM_DEFAULT_SLOTS 4096
+ #define SHM_CACHE_LINE 64
+ #define SHM_SPIN_LIMIT 100000       /* Odd sequences seen before checking on the writer */
+ #define SHM_SPIN_ROUNDS 1000        /* Checks before giving up on a live but stuck writer */
+
+ /* Status codes of the snapshot ring */
+ typedef enum {
+     SHM_OK = 0,
+     SHM_ERR_OPEN,           /* File could not be created, opened or mapped */
+     SHM_ERR_FORMAT,         /* Not a snapshot ring, or a different layout */
+     SHM_ERR_BUSY,           /* Another daemon is publishing to the file */
+     SHM_ERR_EMPTY,          /* Nothing published yet */
+     SHM_ERR_GONE,           /* The requested snapshot was overwritten */
+     SHM_ERR_TORN            /* The writer died or stalled halfway through a slot */
+ } ShmStatus;
+
+ struct shm_header {
+     char magic[8];
+     uint32_t version;
+     uint32_t slot_count;            /* Power of two */
+     uint32_t slot_size;
+     uint32_t writer_pid;
+     uint64_t interval_ns;           /* Sampling interval of the daemon */
+     _Atomic uint64_t published;     /* Snapshots published so far */
+     char pad[SHM_CACHE_LINE - 40];
+ };
+
+ struct shm_slot {
+     _Atomic uint64_t seq;           /* Odd while the writer is inside */
+     uint64_t number;                /* Which snapshot the slot holds */
+     struct mem_sample sample;
+ };
+
+ struct shm_ring {
+     struct shm_header *header;
+     unsigned char *slots;
+     size_t size;                    /* Bytes mapped */
+     int fd;                         /* Writer only, holds the lock */
+ };
+
+ int shm_create(struct shm_ring *ring, const char *path, uint32_t slot_count, uint64_t interval_ns);
+ void shm_publish(struct shm_ring *ring, const struct mem_sample *sample);
+ int shm_attach(struct shm_ring *ring, const char *path);
+ uint64_t shm_published(const struct shm_ring *ring);
+ int shm_read(const struct shm_ring *ring, uint64_t number, struct mem_sample *sample);
+ void shm_close(struct shm_ring *ring);
+ const char *shm_strerror(int status);
+
+ #endif /* FREE_SHM_H */
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "stats.h"
+
+ #include <math.h>
+ #include <stdio.h>
+
+ static const char *const series_labels[STATS_SERIES] = {"Used:", "Free:", "Avail:", "Cached:", "Swap:"};
+
+ /**
+  * Histogram bucket of a value
+  */
+ static unsigned bucket_of(unsigned long long v) {
+     if (v < STATS_SUB_COUNT) {
+         return (unsigned)v;
+     }
+     unsigned msb = 63u - (unsigned)__builtin_clzll(v);
+     unsigned shift = msb - STATS_SUB_BITS;
+     return (shift + 1) * STATS_SUB_COUNT + (unsigned)((v >> shift) & (STATS_SUB_COUNT - 1));
+ }
+
+ /**
+  * Middle of the value range a bucket covers
+  */
+ static unsigned long long bucket_value(unsigned index) {
+     if (index < STATS_SUB_COUNT) {
+         return index;
+     }
+     unsigned shift = index / STATS_SUB_COUNT - 1;
+     unsigned long long low = (unsigned long long)(STATS_SUB_COUNT + index % STATS_SUB_COUNT) << shift;
+     return low + ((1ULL << shift) >> 1);
+ }
+
+ /**
+  * Add one value to a series
+  */
+ void stats_series_add(struct stats_series *s, unsigned long long v) {
+     if (s->count == 0 || v < s->min) s->min = v;
+     if (s->count == 0 || v > s->max) s->max = v;
+     s->count++;
+
+     double delta = (double)v - s->mean;
+     s->mean += delta / (double)s->count;
+     s->m2 += delta * ((double)v - s->mean);
+
+     s->buckets[bucket_of(v)]++;
+ }
+
+ /**
+  * Add one derived sample to every series
+  */
+ void stats_add(struct stats *st, const struct sched_tick *tick, const struct mem_values *mv) {
+     if (st->series[STATS_USED].count == 0) {
+         st->first_ns = tick->actual_ns;
+     }
+     st->last_ns = tick->actual_ns;
+
+     stats_series_add(&st->series[STATS_USED], mv->used);
+     stats_series_add(&st->series[STATS_FREE], mv->free);
+     stats_series_add(&st->series[STATS_AVAILABLE], mv->available);
+     stats_series_add(&st->series[STATS_CACHED], mv->cached);
+     stats_series_add(&st->series[STATS_SWAP], mv->swap_used);
+ }
+
+ /**
+  * Value below which p percent of the samples fall, within one bucket,
+  * clamped to the exact min and max
+  */
+ unsigned long long stats_percentile(const struct stats_series *s, double p) {
+     if (s->count == 0) {
+         return 0;
+     }
+
+     uint64_t rank = (uint64_t)ceil(p / 100.0 * (double)s->count);
+     if (rank == 0) rank = 1;
+
+     uint64_t seen = 0;
+     for (unsigned i = 0; i < STATS_BUCKETS; i++) {
+         seen += s->buckets[i];
+         if (seen >= rank) {
+             unsigned long long v = bucket_value(i);
+             return v < s->min ? s->min : v > s->max ? s->max : v;
+         }
+     }
+     return s->max;
+ }
+
+ double stats_stddev(const struct stats_series *s) {
+     return s->count > 1 ? sqrt(s->m2 / (double)(s->count - 1)) : 0.0;
+ }
+
+ /**
+  * Render the summary table in the selected unit, one row per series
+  * Returns RENDER_OK, or a RENDER_ERR_* code
+  */
+ int stats_render(struct outbuf *ob, const struct render_opts *opts, const struct stats *st) {
+     static const char *const header[] = {"min", "mean", "max", "stddev", "p50", "p95", "p99"};
+     char cells[7][MEMORY_STRING_BUFFER_SIZE];
+     const char *row[7];
+     char line[96];
+
+     render_row(ob, "", header, 7);
+     for (int i = 0; i < STATS_SERIES; i++) {
+         const struct stats_series *s = &st->series[i];
+         unsigned long long values[7] = {
+             s->min, (unsigned long long)(s->mean + 0.5), s->max,
+             (unsigned long long)(stats_stddev(s) + 0.5),
+             stats_percentile(s, 50), stats_percentile(s, 95), stats_percentile(s, 99)
+         };
+
+         for (int j = 0; j < 7; j++) {
+             if (formatBytes(values[j], cells[j], sizeof(cells[j]), opts->human, opts->si, opts->unit) < 0) {
+                 return RENDER_ERR_FORMAT;
+             }
+             row[j] = cells[j];
+         }
+         render_row(ob, series_labels[i], row, 7);
+     }
+
+     snprintf(line, sizeof(line), "Samples: %llu over %.1fs\n",
+              (unsigned long long)st->series[STATS_USED].count,
+              (double)(st->last_ns - st->first_ns) / NSEC_PER_SEC);
+     outbuf_puts(ob, line);
+     return ob->overflow ? RENDER_ERR_OVERFLOW : RENDER_OK;
+ }
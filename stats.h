@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_STATS_H
+ #define FREE_STATS_H
+
+ #include <stdint.h>
+
+ #include "render.h"
+ #include "sample.h"
+
+ /*
+  * Streaming statistics over an unbounded run in constant memory
+  *
+  * Each series keeps min, max and a Welford mean/variance, plus a
+  * log-linear histogram for percentiles: values below 256 get exact
+  * buckets, larger ones 256 buckets per power of two, so a percentile is
+  * off by less than 0.2% of the value whatever the run length. Only the
+  * buckets in use are ever touched, which keeps the resident size small.
+  */
+
+ #define STATS_SUB_BITS 8
+ #define STATS_SUB_COUNT (1u << STATS_SUB_BITS)
+ #define STATS_BUCKETS ((64 - STATS_SUB_BITS + 1) * STATS_SUB_COUNT)
+
+ /* The figures tracked, rows of the summary */
+ typedef enum {
+     STATS_USED,
+     STATS_FREE,
+     STATS_AVAILABLE,
+     STATS_CACHED,
+     STATS_SWAP,
+     STATS_SERIES
+ } StatsSeries;
+
+ struct stats_series {
+     uint64_t count;
+     unsigned long long min;
+     unsigned long long max;
+     double mean;
+     double m2;
+     uint64_t buckets[STATS_BUCKETS];
+ };
+
+ struct stats {
+     uint64_t first_ns;              /* Monotonic time of the first sample */
+     uint64_t last_ns;
+     struct stats_series series[STATS_SERIES];
+ };
+
+ void stats_series_add(struct stats_series *s, unsigned long long v);
+ void stats_add(struct stats *st, const struct sched_tick *tick, const struct mem_values *mv);
+ unsigned long long stats_percentile(const struct stats_series *s, double p);
+ double stats_stddev(const struct stats_series *s);
+ int stats_render(struct outbuf *ob, const struct render_opts *opts, const struct stats *st);
+
+ #endif /* FREE_STATS_H */
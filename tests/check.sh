@@ -0,0 +1,174 @@
+#!/bin/sh
+# Regression checks: run free on the fixture trees under tests/fixtures
+# and compare fields of its --json output, and of its --serve metrics,
+# with the expected byte counts.
+# Usage: tests/check.sh [path to free]
+
+FREE=${1:-./free}
+DIR=$(dirname "$0")/fixtures
+failed=0
+passed=0
+
+# expect fixture field value [free options...]
+expect() {
+    fixture=$1 field=$2 want=$3
+    shift 3
+    got=$("$FREE" --fixture "$DIR/$fixture" -b --json "$@" | sed -n "s/.*\"$field\":\([0-9]*\).*/\1/p")
+    if [ "$got" = "$want" ]; then
+        passed=$((passed + 1))
+    else
+        echo "FAIL: $fixture $*: $field is '$got', expected $want"
+        failed=$((failed + 1))
+    fi
+}
+
+# match fixture text [free options...]: some output line holds text
+match() {
+    fixture=$1 want=$2
+    shift 2
+    if "$FREE" --fixture "$DIR/$fixture" -b "$@" | grep -F -q -e "$want"; then
+        passed=$((passed + 1))
+    else
+        echo "FAIL: $fixture $*: no '$want' in the output"
+        failed=$((failed + 1))
+    fi
+}
+
+# refuse fixture [free options...]: the options are rejected
+refuse() {
+    fixture=$1
+    shift
+    if "$FREE" --fixture "$DIR/$fixture" -b "$@" >/dev/null 2>&1; then
+        echo "FAIL: $fixture $*: accepted"
+        failed=$((failed + 1))
+    else
+        passed=$((passed + 1))
+    fi
+}
+
+# /proc/meminfo without Buffers, Cached, SReclaimable or the commit keys
+expect meminfo-missing total 8192000000
+expect meminfo-missing free 3072000000
+expect meminfo-missing cached 0
+expect meminfo-missing app 2048000000
+expect meminfo-missing swap_used 256000000
+
+# Keys past the 8 KiB read buffer and a line longer than it
+expect meminfo-large free 4096000000
+expect meminfo-large cached 2457600000
+expect meminfo-large app 6144000000
+expect meminfo-large commit_limit 10240000000
+expect meminfo-large committed 7168000000
+
+# available: the kernel's MemAvailable as it is when there is one, even 0
+# and even with mlocked memory in both Unevictable and AnonPages, otherwise
+# free plus the file pages (no reserve or purgeable memory in meminfo),
+# never more than what wired and application memory leave of the total
+expect available available 3584000000
+expect available-mlocked available 3072000000
+expect available-zero available 0
+expect available-estimate available 3276800000
+expect available-capped available 1843200000
+
+# A group under a limit of its parent: free and reclaimable cache under the
+# limit, less any zswap pool
+expect cgroup total 4000000000 --cgroup app.slice/web.service
+expect cgroup free 1000000000 --cgroup app.slice/web.service
+expect cgroup available 1950000000 --cgroup app.slice/web.service
+expect cgroup available 1700000000 --cgroup app.slice/batch.service
+
+# Two NUMA nodes, and a zoneinfo longer than the read buffer with an empty
+# Movable zone and a Normal zone below its min watermark
+match numa '{"node":0,"total":8192000000,"used":7168000000,"free":1024000000,"file":2048000000,"anon":4096000000}' -l --json
+match numa '{"node":1,"total":8192000000,"used":3072000000,"free":5120000000,"file":2048000000,"anon":1024000000}' -l --json
+match numa '"zones":[{"node":0,"zone":"DMA",' -l --json
+match numa '},{"node":0,"zone":"Normal",' -l --json
+match numa '},{"node":1,"zone":"Normal",' -l --json
+match numa 'below min' -l
+match numa 'Imbalance: node 0 has 12.5% free, node 1 has 62.5%' -l
+refuse numa -l --csv
+
+# The --serve endpoint: one scrape, then two requests pipelined on one
+# keep-alive connection, each answered with the fixture's gauges
+if command -v python3 >/dev/null 2>&1; then
+    port=$(python3 -c 'import socket; s = socket.socket(); s.bind(("127.0.0.1", 0)); print(s.getsockname()[1])')
+    "$FREE" --fixture "$DIR/serve" --serve "127.0.0.1:$port" -s 0.1 >/dev/null 2>&1 &
+    server=$!
+
+    # scrape requests: send that many GETs at once, the last asking to close,
+    # and print everything read back; retried until the first sample is out
+    scrape() {
+        python3 - "$port" "$1" <<'EOF'
+import socket, sys, time
+port, n = int(sys.argv[1]), int(sys.argv[2])
+get = "GET /metrics HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+for attempt in range(50):
+    try:
+        s = socket.create_connection(("127.0.0.1", port), timeout=5)
+        s.sendall(((get + "\r\n") * (n - 1) + get + "Connection: close\r\n\r\n").encode())
+        data = b""
+        while True:
+            chunk = s.recv(65536)
+            if not chunk:
+                break
+            data += chunk
+        s.close()
+        if data.startswith(b"HTTP/1.1 200 "):
+            break
+    except OSError:
+        pass
+    time.sleep(0.1)
+sys.stdout.write(data.decode(errors="replace").replace("\r", ""))
+EOF
+    }
+
+    # gauge output metric value [responses]: that many responses have it
+    gauge() {
+        got=$(printf '%s\n' "$1" | grep -c -x -e "$2 $3")
+        if [ "$got" = "${4:-1}" ]; then
+            passed=$((passed + 1))
+        else
+            echo "FAIL: serve: $2 is $3 in $got responses, expected ${4:-1}"
+            failed=$((failed + 1))
+        fi
+    }
+
+    # responses output count
+    responses() {
+        got=$(printf '%s\n' "$1" | grep -c -x -e 'HTTP/1.1 200 OK')
+        if [ "$got" = "$2" ]; then
+            passed=$((passed + 1))
+        else
+            echo "FAIL: serve: $got responses, expected $2"
+            failed=$((failed + 1))
+        fi
+    }
+
+    out=$(scrape 1)
+    responses "$out" 1
+    gauge "$out" free_memory_total_bytes 8192000000
+    gauge "$out" free_memory_used_bytes 4915200000
+    gauge "$out" free_memory_free_bytes 1024000000
+    gauge "$out" free_memory_cached_bytes 2252800000
+    gauge "$out" free_memory_app_bytes 4096000000
+    gauge "$out" free_memory_wired_bytes 81920000
+    gauge "$out" free_memory_available_bytes 3584000000
+    gauge "$out" free_swap_total_bytes 2048000000
+    gauge "$out" free_swap_used_bytes 512000000
+    gauge "$out" free_swap_free_bytes 1536000000
+    gauge "$out" free_commit_limit_bytes 6144000000
+    gauge "$out" free_committed_bytes 5120000000
+
+    out=$(scrape 2)
+    responses "$out" 2
+    gauge "$out" free_memory_available_bytes 3584000000 2
+    gauge "$out" free_swap_used_bytes 512000000 2
+
+    kill "$server" 2>/dev/null
+    wait "$server" 2>/dev/null
+else
+    echo "SKIP: serve: no python3"
+fi
+
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]
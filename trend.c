@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #include "trend.h"
+
+ #include <math.h>
+ #include <stdio.h>
+ #include <string.h>
+
+ #include "hook.h"
+
+ void trend_init(struct trend *tr, double horizon_minutes, double jump_pct) {
+     memset(tr, 0, sizeof(*tr));
+     tr->horizon = horizon_minutes * 60.0;
+     tr->jump = jump_pct / 100.0;
+ }
+
+ /**
+  * Move the time origin dt seconds forward and age the sums, then add x
+  * at the new origin
+  */
+ static void fit_add(struct trend_series *s, double dt, double decay, double x) {
+     s->stt = (s->stt - 2.0 * dt * s->st + dt * dt * s->sw) * decay;
+     s->stx = (s->stx - dt * s->sx) * decay;
+     s->st = (s->st - dt * s->sw) * decay;
+     s->sx *= decay;
+     s->sw *= decay;
+
+     s->sw += 1.0;
+     s->sx += x;
+ }
+
+ /**
+  * Slope of the fitted line in units per second and its value now
+  * Returns 0, or -1 while the samples cannot define a line
+  */
+ static int fit_line(const struct trend_series *s, double *slope, double *level) {
+     double den = s->sw * s->stt - s->st * s->st;
+     if (den <= 0.0 || s->sw <= 0.0) {
+         return -1;
+     }
+     *slope = (s->sw * s->stx - s->st * s->sx) / den;
+     *level = (s->sx - *slope * s->st) / s->sw;
+     return 0;
+ }
+
+ /**
+  * Add one sample of one figure, appending any event it raises
+  */
+ static size_t series_update(struct trend *tr, int metric, double dt, double span, double x, double capacity,
+                             uint64_t wall_ns, struct trend_event *events) {
+     struct trend_series *s = &tr->series[metric];
+     size_t n = 0;
+
+     if (capacity <= 0.0) {
+         return 0;
+     }
+
+     /* Jumps are measured against the average before this sample, which
+      * then restarts from the new level so a step alerts once */
+     if (s->samples > 0 && tr->jump > 0.0 && fabs(x - s->ewma) >= tr->jump * capacity) {
+         struct trend_event *ev = &events[n++];
+         memset(ev, 0, sizeof(*ev));
+         ev->type = TREND_EVENT_JUMP;
+         ev->metric = metric;
+         ev->wall_ns = wall_ns;
+         ev->value = x;
+         ev->capacity = capacity;
+         ev->delta = x - s->ewma;
+     }
+     if (s->samples == 0 || n > 0) {
+         s->ewma = x;
+     } else {
+         double a = exp(-dt / TREND_EWMA_SECONDS);
+         s->ewma = a * s->ewma + (1.0 - a) * x;
+     }
+     fit_add(s, dt, exp(-dt / TREND_FIT_SECONDS), x);
+     s->samples++;
+
+     double slope, level;
+     if (s->samples < TREND_MIN_SAMPLES || span < TREND_MIN_SPAN || fit_line(s, &slope, &level) != 0) {
+         return n;
+     }
+     double exhaustion = slope > 0.0 ? (capacity - (level < capacity ? level : capacity)) / slope : INFINITY;
+     if (!s->growing && exhaustion < tr->horizon) {
+         struct trend_event *ev = &events[n++];
+         memset(ev, 0, sizeof(*ev));
+         ev->type = TREND_EVENT_GROWTH;
+         ev->metric = metric;
+         ev->wall_ns = wall_ns;
+         ev->value = x;
+         ev->capacity = capacity;
+         ev->rate = slope;
+         ev->exhaustion = exhaustion;
+         s->growing = 1;
+     } else if (s->growing && exhaustion >= 2.0 * tr->horizon) {
+         s->growing = 0;
+     }
+     return n;
+ }
+
+ /**
+  * Add a sample to every figure
+  * Returns the number of events raised into events, which has room for
+  * TREND_MAX_EVENTS
+  */
+ size_t trend_update(struct trend *tr, const struct mem_sample *sample, const struct mem_values *mv,
+                     struct trend_event *events) {
+     uint64_t now = sample->tick.actual_ns;
+     double dt = 0.0;
+     size_t n = 0;
+
+     if (!tr->have_prev) {
+         tr->first_ns = now;
+         tr->have_prev = 1;
+     } else if (now > tr->prev_ns) {
+         dt = (double)(now - tr->prev_ns) / NSEC_PER_SEC;
+     }
+     tr->prev_ns = now;
+     double span = (double)(now - tr->first_ns) / NSEC_PER_SEC;
+
+     n += series_update(tr, TREND_USED, dt, span, (double)mv->used, (double)mv->total, sample->wall_ns, events + n);
+     n += series_update(tr, TREND_SWAP, dt, span, (double)mv->swap_used, (double)mv->swap_total, sample->wall_ns,
+                        events + n);
+     n += series_update(tr, TREND_COMPRESSED, dt, span,
+                        (double)sample->counters.compressor_page_count * (double)sample->counters.page_size,
+                        (double)mv->total, sample->wall_ns, events + n);
+     return n;
+ }
+
+ /**
+  * Render an event as a line of its own, or as a JSON object with the
+  * figures in bytes
+  * Returns RENDER_OK, or a RENDER_ERR_* code
+  */
+ int trend_render(struct outbuf *ob, const struct render_opts *opts, const struct trend_event *ev) {
+     char line[256], value[MEMORY_STRING_BUFFER_SIZE], capacity[MEMORY_STRING_BUFFER_SIZE];
+     char change[MEMORY_STRING_BUFFER_SIZE];
+     double amount = ev->type == TREND_EVENT_GROWTH ? ev->rate : fabs(ev->delta);
+
+     if (opts->format == RENDER_FORMAT_JSON) {
+         int n = snprintf(line, sizeof(line), "{\"event\":\"%s\",\"metric\":\"%s\",\"wall_ns\":%llu,\"value\":%.0f,\"capacity\":%.0f",
+                          trend_event_name(ev->type), trend_metric_name(ev->metric),
+                          (unsigned long long)ev->wall_ns, ev->value, ev->capacity);
+         if (ev->type == TREND_EVENT_GROWTH) {
+             snprintf(line + n, sizeof(line) - (size_t)n, ",\"rate\":%.0f,\"exhaustion_s\":%.0f}\n",
+                      ev->rate, ev->exhaustion);
+         } else {
+             snprintf(line + n, sizeof(line) - (size_t)n, ",\"delta\":%.0f}\n", ev->delta);
+         }
+         outbuf_puts(ob, line);
+         return ob->overflow ? RENDER_ERR_OVERFLOW : RENDER_OK;
+     }
+
+     if (formatBytes((unsigned long long)ev->value, value, sizeof(value), opts->human, opts->si, opts->unit) < 0 ||
+         formatBytes((unsigned long long)ev->capacity, capacity, sizeof(capacity), opts->human, opts->si,
+                     opts->unit) < 0 ||
+         formatBytes((unsigned long long)amount, change, sizeof(change), opts->human, opts->si, opts->unit) < 0) {
+         return RENDER_ERR_FORMAT;
+     }
+     if (ev->type == TREND_EVENT_GROWTH) {
+         snprintf(line, sizeof(line), "Alert: %s memory growing by %s/s, %s of %s, full in %.1f min\n",
+                  trend_metric_name(ev->metric), change, value, capacity, ev->exhaustion / 60.0);
+     } else {
+         snprintf(line, sizeof(line), "Alert: %s memory jumped by %s%s to %s of %s\n",
+                  trend_metric_name(ev->metric), ev->delta < 0 ? "-" : "+", change, value, capacity);
+     }
+     outbuf_puts(ob, line);
+     return ob->overflow ? RENDER_ERR_OVERFLOW : RENDER_OK;
+ }
+
+ /**
+  * Start command with /bin/sh, the event in FREE_EVENT, FREE_METRIC,
+  * FREE_VALUE and FREE_CAPACITY (bytes), and FREE_RATE (bytes per second)
+  * and FREE_EXHAUSTION (seconds) for growth or FREE_DELTA (bytes) for jumps
+  * Returns 0, or -1 with errno set
+  */
+ int trend_hook(const char *command, const struct trend_event *ev) {
+     char vars[6][HOOK_VAR_SIZE];
+     size_t n = 0;
+
+     snprintf(vars[n++], sizeof(vars[0]), "FREE_EVENT=%s", trend_event_name(ev->type));
+     snprintf(vars[n++], sizeof(vars[0]), "FREE_METRIC=%s", trend_metric_name(ev->metric));
+     snprintf(vars[n++], sizeof(vars[0]), "FREE_VALUE=%.0f", ev->value);
+     snprintf(vars[n++], sizeof(vars[0]), "FREE_CAPACITY=%.0f", ev->capacity);
+     if (ev->type == TREND_EVENT_GROWTH) {
+         snprintf(vars[n++], sizeof(vars[0]), "FREE_RATE=%.0f", ev->rate);
+         snprintf(vars[n++], sizeof(vars[0]), "FREE_EXHAUSTION=%.0f", ev->exhaustion);
+     } else {
+         snprintf(vars[n++], sizeof(vars[0]), "FREE_DELTA=%.0f", ev->delta);
+     }
+     return hook_run(command, vars, n);
+ }
+
+ const char *trend_metric_name(int metric) {
+     switch (metric) {
+         case TREND_USED: return "used";
+         case TREND_SWAP: return "swap";
+         case TREND_COMPRESSED: return "compressed";
+         default: return "unknown";
+     }
+ }
+
+ const char *trend_event_name(int type) {
+     switch (type) {
+         case TREND_EVENT_GROWTH: return "growth";
+         case TREND_EVENT_JUMP: return "jump";
+         default: return "unknown";
+     }
+ }
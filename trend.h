@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2025 Mohamed Elashri
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ #ifndef FREE_TREND_H
+ #define FREE_TREND_H
+
+ #include <stddef.h>
+ #include <stdint.h>
+
+ #include "render.h"
+ #include "sample.h"
+
+ /*
+  * Online leak-trend and jump detection
+  *
+  * Each tracked figure keeps an exponentially weighted moving average and
+  * an exponentially weighted least-squares line through its samples, five
+  * running sums with times relative to the latest sample. Both forget with
+  * a time constant, so an update is O(1) whatever the run length. The line
+  * projects when the figure reaches its capacity: a growth event is raised
+  * once when that is nearer than the horizon, and cleared when it moves
+  * beyond twice the horizon. A jump event is raised when a sample moves
+  * away from the short-term average by more than a share of the capacity.
+  */
+
+ #define TREND_DEFAULT_JUMP 10.0     /* Percent of capacity */
+ #define TREND_FIT_SECONDS 300.0     /* Time constant of the regression */
+ #define TREND_EWMA_SECONDS 30.0     /* Time constant of the average */
+ #define TREND_MIN_SAMPLES 10        /* Before any growth projection */
+ #define TREND_MIN_SPAN 30.0         /* Seconds of history before any projection */
+ #define TREND_MAX_EVENTS (2 * TREND_METRICS)
+
+ /* The figures tracked */
+ typedef enum {
+     TREND_USED,             /* Used memory, of the total */
+     TREND_SWAP,             /* Used swap, of the swap total */
+     TREND_COMPRESSED,       /* Compressor memory (zswap in a cgroup), of the total */
+     TREND_METRICS
+ } TrendMetric;
+
+ typedef enum {
+     TREND_EVENT_GROWTH,     /* Projected to reach capacity within the horizon */
+     TREND_EVENT_JUMP        /* Sudden change */
+ } TrendEventType;
+
+ struct trend_series {
+     uint64_t samples;
+     double ewma;
+     double sw, st, sx, stt, stx;    /* Weighted sums, t = 0 at the latest sample */
+     int growing;                    /* Growth event raised and not cleared */
+ };
+
+ struct trend_event {
+     int type;                       /* TrendEventType */
+     int metric;                     /* TrendMetric */
+     uint64_t wall_ns;
+     double value;                   /* Bytes */
+     double capacity;
+     double rate;                    /* Bytes per second, from the fitted line */
+     double exhaustion;              /* Seconds to capacity, growth events */
+     double delta;                   /* Change from the average, jump events */
+ };
+
+ struct trend {
+     double horizon;                 /* Seconds */
+     double jump;                    /* Fraction of capacity */
+     int have_prev;
+     uint64_t first_ns;
+     uint64_t prev_ns;
+     struct trend_series series[TREND_METRICS];
+ };
+
+ void trend_init(struct trend *tr, double horizon_minutes, double jump_pct);
+ size_t trend_update(struct trend *tr, const struct mem_sample *sample, const struct mem_values *mv,
+                     struct trend_event *events);
+ int trend_hook(const char *command, const struct trend_event *ev);
+ int trend_render(struct outbuf *ob, const struct render_opts *opts, const struct trend_event *ev);
+ const char *trend_metric_name(int metric);
+ const char *trend_event_name(int type);
+
+ #endif /* FREE_TREND_H */